@@ -0,0 +1,255 @@
+#include "alltasksmodel.h"
+#include "databaseworker.h"
+#include "tasklistmodel.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QLocale>
+#include <QSet>
+#include <algorithm>
+#include <limits>
+
+AllTasksModel::AllTasksModel(DatabaseWorker *worker, QObject *parent)
+    : QAbstractListModel(parent), worker(worker)
+{
+}
+
+void AllTasksModel::reload()
+{
+    ++generation;
+    loading = true;
+    pendingTasks.clear();
+    int requestGeneration = generation;
+    worker->post("tasks.all", [](DatabaseSession &session) {
+        auto loaded = std::make_shared<TaskSnapshot>();
+        if (!loaded->load(session)) loaded.reset();
+        return loaded;
+    }, this, [this, requestGeneration](const std::shared_ptr<TaskSnapshot> &loaded) {
+        if (requestGeneration != generation) return;
+        loading = false;
+        if (!loaded) return;
+        snapshot = loaded;
+        rebuildView();
+        emit topicsChanged();
+        if (!pendingTasks.isEmpty()) {
+            QVector<int> taskIds;
+            taskIds.swap(pendingTasks);
+            refreshTasks(taskIds);
+        }
+    });
+}
+
+void AllTasksModel::setFilter(TaskSnapshot::DoneFilter done, const QString &topic)
+{
+    if (done == doneFilter && topic == topicFilter) return;
+    doneFilter = done;
+    topicFilter = topic;
+    rebuildView();
+}
+
+void AllTasksModel::setOrder(TaskSnapshot::SortKey key, bool descending)
+{
+    if (key == order.key && descending == order.descending) return;
+    order.key = key;
+    order.descending = descending;
+    rebuildView();
+}
+
+QStringList AllTasksModel::topicNames() const
+{
+    return snapshot ? snapshot->topicNames() : QStringList();
+}
+
+int AllTasksModel::taskId(int row) const
+{
+    if (row < 0 || row >= int(view.size())) return -1;
+    return snapshot->taskId(view[row]);
+}
+
+// Re-reads the given tasks; ids that no longer come back were deleted.
+void AllTasksModel::refreshTasks(const QVector<int> &taskIds)
+{
+    if (taskIds.isEmpty() || (!snapshot && !loading)) return;
+    if (loading) {
+        pendingTasks += taskIds;
+        return;
+    }
+    int requestGeneration = generation;
+    worker->post(QString(), [taskIds](DatabaseSession &session) {
+        return session.tasks().briefs(taskIds);
+    }, this, [this, requestGeneration, taskIds](const QVector<TaskBrief> &tasks) {
+        if (requestGeneration != generation) return;
+        updateTasks(taskIds, tasks);
+    });
+}
+
+void AllTasksModel::setTaskDone(int taskId, bool done)
+{
+    if (!snapshot) return;
+    int row = snapshot->setDone(taskId, done);
+    if (row >= 0) place(row);
+}
+
+void AllTasksModel::removeTask(int taskId)
+{
+    if (!snapshot) return;
+    int row = snapshot->remove(taskId);
+    if (row >= 0) place(row);
+    if (snapshot->needsCompaction()) {
+        snapshot->compact();
+        rebuildView();
+    }
+}
+
+void AllTasksModel::renameTopic(const QString &currentName, const QString &newName)
+{
+    if (!snapshot) return;
+    snapshot->renameTopic(currentName, newName);
+    if (topicFilter == currentName) topicFilter = newName;
+    if (order.key == TaskSnapshot::ByTopic) {
+        rebuildView();
+    } else if (!view.empty()) {
+        emit dataChanged(index(0), index(int(view.size()) - 1), {Qt::DisplayRole, TaskListModel::TopicNameRole});
+    }
+    emit topicsChanged();
+}
+
+void AllTasksModel::removeTopic(const QString &name)
+{
+    if (!snapshot) return;
+    snapshot->removeTopic(name);
+    if (topicFilter == name) topicFilter.clear();
+    if (snapshot->needsCompaction()) snapshot->compact();
+    rebuildView();
+    emit topicsChanged();
+}
+
+int AllTasksModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(view.size());
+}
+
+QVariant AllTasksModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= int(view.size())) return QVariant();
+    int row = view[index.row()];
+    switch (role) {
+    case Qt::DisplayRole: {
+        qint64 dueAt = snapshot->dueAt(row);
+        if (dueAt == TaskBrief::NoDue) return QString("%1 (%2)").arg(snapshot->name(row), snapshot->topicName(row));
+        QString due = QLocale().toString(QDateTime::fromSecsSinceEpoch(dueAt), QLocale::ShortFormat);
+        return QString("%1 (%2, due %3)").arg(snapshot->name(row), snapshot->topicName(row), due);
+    }
+    case Qt::CheckStateRole:
+        return snapshot->isDone(row) ? Qt::Checked : Qt::Unchecked;
+    case TaskListModel::TaskIdRole:
+        return snapshot->taskId(row);
+    case TaskListModel::TopicNameRole:
+        return snapshot->topicName(row);
+    default:
+        return QVariant();
+    }
+}
+
+bool AllTasksModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::CheckStateRole || !index.isValid() || index.row() >= int(view.size())) return false;
+    bool done = static_cast<Qt::CheckState>(value.toInt()) == Qt::Checked;
+    int taskId = snapshot->taskId(view[index.row()]);
+    if (snapshot->isDone(view[index.row()]) == done) return true;
+    setTaskDone(taskId, done);
+    emit taskCheckStateChanged(taskId, done);
+    return true;
+}
+
+Qt::ItemFlags AllTasksModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+    return QAbstractListModel::flags(index) | Qt::ItemIsUserCheckable;
+}
+
+TaskSnapshot::Filter AllTasksModel::currentFilter() const
+{
+    TaskSnapshot::Filter filter;
+    filter.done = doneFilter;
+    if (!topicFilter.isEmpty()) {
+        int topic = snapshot->topicIndex(topicFilter);
+        filter.topic = topic >= 0 ? topic : std::numeric_limits<int>::max();
+    }
+    return filter;
+}
+
+void AllTasksModel::rebuildView()
+{
+    if (!snapshot) return;
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<int> rows = snapshot->select(currentFilter(), order);
+    beginResetModel();
+    view.swap(rows);
+    endResetModel();
+    qint64 memory = snapshot->memoryUsage() + qint64(view.capacity() * sizeof(int));
+    emit viewUpdated(int(view.size()), timer.elapsed(), memory);
+}
+
+// Moves one snapshot row to its sorted position in the view, or in or out of
+// it when it starts or stops matching the filter.
+void AllTasksModel::place(int row)
+{
+    auto current = std::find(view.begin(), view.end(), row);
+    int from = current == view.end() ? -1 : int(current - view.begin());
+    if (!snapshot->matches(row, currentFilter())) {
+        if (from < 0) return;
+        beginRemoveRows(QModelIndex(), from, from);
+        view.erase(current);
+        endRemoveRows();
+        return;
+    }
+    if (from >= 0) view.erase(current);
+    auto less = [this](int a, int b) { return snapshot->lessThan(a, b, order); };
+    int to = int(std::lower_bound(view.begin(), view.end(), row, less) - view.begin());
+    if (from < 0) {
+        beginInsertRows(QModelIndex(), to, to);
+        view.insert(view.begin() + to, row);
+        endInsertRows();
+        return;
+    }
+    if (to == from) {
+        view.insert(view.begin() + to, row);
+        emit dataChanged(index(to), index(to));
+        return;
+    }
+    view.insert(view.begin() + from, row);
+    beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to);
+    view.erase(view.begin() + from);
+    view.insert(view.begin() + to, row);
+    endMoveRows();
+}
+
+void AllTasksModel::updateTasks(const QVector<int> &taskIds, const QVector<TaskBrief> &tasks)
+{
+    if (!snapshot) return;
+    int topicCount = snapshot->topicNames().size();
+    QSet<int> found;
+    for (const TaskBrief &task : tasks) {
+        found.insert(task.id);
+        int rows = snapshot->rowCount();
+        int row = snapshot->upsert(task);
+        // A task inserted below the last id shifts the rows after it.
+        if (snapshot->rowCount() != rows && row != rows) {
+            for (int &visible : view) {
+                if (visible >= row) ++visible;
+            }
+        }
+        place(row);
+    }
+    for (int taskId : taskIds) {
+        if (found.contains(taskId)) continue;
+        int row = snapshot->remove(taskId);
+        if (row >= 0) place(row);
+    }
+    if (snapshot->needsCompaction()) {
+        snapshot->compact();
+        rebuildView();
+    }
+    if (snapshot->topicNames().size() != topicCount) emit topicsChanged();
+}
@@ -0,0 +1,56 @@
+#ifndef ALLTASKSMODEL_H
+#define ALLTASKSMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <memory>
+#include <vector>
+#include "tasksnapshot.h"
+
+class DatabaseWorker;
+struct TaskBrief;
+
+// Every task across topics, filtered and sorted in memory. The snapshot is
+// built once on the worker; later edits are patched in by task id.
+class AllTasksModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit AllTasksModel(DatabaseWorker *worker, QObject *parent = nullptr);
+    void reload();
+    bool isLoaded() const { return snapshot != nullptr; }
+    void setFilter(TaskSnapshot::DoneFilter done, const QString &topic);
+    void setOrder(TaskSnapshot::SortKey key, bool descending);
+    QString topic() const { return topicFilter; }
+    QStringList topicNames() const;
+    int taskId(int row) const;
+    void refreshTasks(const QVector<int> &taskIds);
+    void setTaskDone(int taskId, bool done);
+    void removeTask(int taskId);
+    void renameTopic(const QString &currentName, const QString &newName);
+    void removeTopic(const QString &name);
+    void updateTasks(const QVector<int> &taskIds, const QVector<TaskBrief> &tasks);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+signals:
+    void taskCheckStateChanged(int taskId, bool done);
+    void topicsChanged();
+    void viewUpdated(int rows, qint64 elapsedMs, qint64 memoryBytes);
+private:
+    TaskSnapshot::Filter currentFilter() const;
+    void rebuildView();
+    void place(int row);
+    DatabaseWorker *worker;
+    std::shared_ptr<TaskSnapshot> snapshot;
+    std::vector<int> view;
+    TaskSnapshot::DoneFilter doneFilter = TaskSnapshot::AnyState;
+    QString topicFilter;
+    TaskSnapshot::Order order;
+    int generation = 0;
+    bool loading = false;
+    QVector<int> pendingTasks;
+};
+
+#endif // ALLTASKSMODEL_H
@@ -0,0 +1,273 @@
+#include "databasegenerator.h"
+#include "databaseworker.h"
+#include "schemamigrator.h"
+#include "syncprotocol.h"
+#include "tasksnapshot.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+namespace {
+
+struct Result
+{
+    QString name;
+    qint64 rows;
+    QVector<qint64> samples;
+};
+
+template <typename Operation>
+Result measure(const QString &name, qint64 rows, int iterations, Operation operation)
+{
+    Result result{name, rows, {}};
+    result.samples.reserve(iterations);
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        operation(i);
+        result.samples.append(timer.nsecsElapsed());
+    }
+    std::fprintf(stderr, "  %-22s %8d iterations\n", qPrintable(name), iterations);
+    return result;
+}
+
+QJsonObject toJson(const Result &result)
+{
+    QVector<qint64> samples = result.samples;
+    std::sort(samples.begin(), samples.end());
+    qint64 total = 0;
+    for (qint64 sample : samples) total += sample;
+    QJsonObject object;
+    object.insert("benchmark", result.name);
+    object.insert("rows", result.rows);
+    object.insert("iterations", samples.size());
+    if (!samples.isEmpty()) {
+        object.insert("mean_ns", total / samples.size());
+        object.insert("min_ns", samples.first());
+        object.insert("median_ns", samples.at(samples.size() / 2));
+        object.insert("p95_ns", samples.at(qMin(samples.size() - 1, samples.size() * 95 / 100)));
+        object.insert("max_ns", samples.last());
+    }
+    return object;
+}
+
+QSqlDatabase openDatabase(const QString &connectionName, const QString &fileName)
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(fileName);
+    if (db.open()) {
+        SchemaMigrator::configureConnection(db);
+        SchemaMigrator migrator(db);
+        migrator.migrate();
+    }
+    return db;
+}
+
+QVector<int> sampleTaskIds(const QSqlDatabase &db, int count, std::mt19937 &random)
+{
+    QVector<int> ids;
+    QSqlQuery query(db);
+    if (!query.exec("SELECT MIN(id), MAX(id) FROM tasks") || !query.next() || query.value(0).isNull()) return ids;
+    std::uniform_int_distribution<int> pick(query.value(0).toInt(), query.value(1).toInt());
+    for (int i = 0; i < count; ++i) ids.append(pick(random));
+    return ids;
+}
+
+void runSuite(const QString &fileName, qint64 rows, int iterations, QVector<Result> &results)
+{
+    results << measure("database.open", rows, qMax(1, iterations / 10), [&](int i) {
+        QString connectionName = QString("bench-open-%1").arg(i);
+        {
+            QSqlDatabase db = openDatabase(connectionName, fileName);
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+    });
+
+    {
+        QSqlDatabase db = openDatabase("bench", fileName);
+        DatabaseSession session(db);
+        std::mt19937 random(7);
+        const QVector<TopicRecord> topics = session.topics().all();
+        const QVector<int> ids = sampleTaskIds(db, 1000, random);
+        qint64 now = QDateTime::currentSecsSinceEpoch();
+        if (!topics.isEmpty() && !ids.isEmpty()) {
+            results << measure("topics.load", rows, iterations, [&](int) {
+                session.topics().all();
+            });
+            results << measure("tasks.first_page", rows, iterations, [&](int i) {
+                session.tasks().page(topics.at(i % topics.size()).id, 0, 256);
+            });
+            results << measure("tasks.topic_scan", rows, qMax(1, iterations / 10), [&](int i) {
+                int topicId = topics.at(i % topics.size()).id;
+                int afterId = 0;
+                forever {
+                    const QVector<TaskRecord> page = session.tasks().page(topicId, afterId, 256);
+                    if (page.isEmpty()) break;
+                    afterId = page.last().id;
+                }
+            });
+            results << measure("tasks.description", rows, iterations * 10, [&](int i) {
+                session.tasks().description(ids.at(i % ids.size()));
+            });
+            results << measure("due.scan", rows, iterations, [&](int) {
+                session.tasks().dueTasks(now);
+            });
+            results << measure("due.deadlines", rows, iterations, [&](int) {
+                session.tasks().pendingDeadlines(1024);
+            });
+            results << measure("tasks.search", rows, iterations, [&](int i) {
+                session.tasks().search(i % 2 ? "rep" : "meeting budget", 100, 0);
+            });
+            TaskSnapshot snapshot;
+            results << measure("snapshot.load", rows, qMax(1, iterations / 10), [&](int) {
+                snapshot.load(session);
+            });
+            results << measure("snapshot.sort", rows, qMax(1, iterations / 10), [&](int i) {
+                TaskSnapshot::Order order;
+                order.key = TaskSnapshot::SortKey(i % 3);
+                snapshot.select(TaskSnapshot::Filter(), order);
+            });
+            results << measure("snapshot.filter", rows, qMax(1, iterations / 10), [&](int i) {
+                TaskSnapshot::Filter filter;
+                filter.done = TaskSnapshot::OpenOnly;
+                filter.topic = i % qMax(1, snapshot.topicNames().size());
+                snapshot.select(filter, TaskSnapshot::Order());
+            });
+            std::fprintf(stderr, "  snapshot memory %lld bytes\n", static_cast<long long>(snapshot.memoryUsage()));
+
+            QSqlQuery cursorQuery(db);
+            qint64 cursor = cursorQuery.exec("SELECT MAX(seq) FROM sync_journal") && cursorQuery.next()
+                                ? cursorQuery.value(0).toLongLong() : 0;
+            QVector<TaskRecord> added;
+            results << measure("tasks.add", rows, iterations, [&](int i) {
+                TaskRecord task;
+                task.topicId = topics.at(i % topics.size()).id;
+                task.name = QString("bench task %1").arg(i);
+                task.description = "benchmark";
+                task.dueDate = QDateTime::fromSecsSinceEpoch(now + 3600);
+                task.id = session.tasks().insert(task);
+                added.append(task);
+            });
+            results << measure("tasks.edit", rows, added.size(), [&](int i) {
+                TaskRecord task = added.at(i);
+                task.name += " edited";
+                task.dueDate = task.dueDate.addSecs(60);
+                session.tasks().update(task);
+            });
+            results << measure("tasks.delete", rows, added.size(), [&](int i) {
+                session.tasks().remove(added.at(i).id);
+            });
+            SyncJournal journal(db);
+            qint64 deltaBytes = 0;
+            results << measure("sync.delta", rows, iterations, [&](int) {
+                SyncMessage message;
+                message.type = SyncMessage::Batch;
+                journal.changesSince("bench-peer", cursor, 2000, message.batch);
+                deltaBytes = SyncProtocol::encode(message).size();
+            });
+            std::fprintf(stderr, "  sync delta %lld bytes\n", static_cast<long long>(deltaBytes));
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("bench");
+}
+
+QString sqliteVersion()
+{
+    QString version;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "bench-version");
+        db.setDatabaseName(":memory:");
+        QSqlQuery query(db);
+        if (db.open() && query.exec("SELECT sqlite_version()") && query.next()) version = query.value(0).toString();
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("bench-version");
+    return version;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationVersion(BENCH_VERSION);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the task database hot paths.\n"
+                                     "Use \"generate FILE\" to only write a synthetic database.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "Optional: generate FILE", "[generate FILE]");
+    parser.addOption({"sizes", "Comma-separated task counts (default 10000,100000,1000000).", "list",
+                      "10000,100000,1000000"});
+    parser.addOption({"tasks", "generate: number of tasks.", "count", "10000"});
+    parser.addOption({"topics", "Number of topics (default: one per thousand tasks, at least 10).", "count"});
+    parser.addOption({"dir", "Directory for generated databases.", "path", QDir::tempPath()});
+    parser.addOption({"iterations", "Iterations per benchmark (default 100).", "count", "100"});
+    parser.addOption({"output", "JSON results file.", "file", "bench-results.json"});
+    parser.addOption({"regenerate", "Regenerate databases even if they exist."});
+    parser.process(app);
+
+    auto topicsFor = [&](qint64 tasks) {
+        return parser.isSet("topics") ? parser.value("topics").toInt() : int(qMax<qint64>(10, tasks / 1000));
+    };
+    const QStringList positional = parser.positionalArguments();
+    if (!positional.isEmpty()) {
+        if (positional.size() != 2 || positional.first() != "generate") parser.showHelp(2);
+        qint64 tasks = parser.value("tasks").toLongLong();
+        DatabaseGenerator generator;
+        if (!generator.generate(positional.at(1), topicsFor(tasks), tasks)) {
+            std::fprintf(stderr, "%s\n", qPrintable(generator.lastError()));
+            return 1;
+        }
+        return 0;
+    }
+
+    int iterations = qMax(1, parser.value("iterations").toInt());
+    QVector<Result> results;
+    const QStringList sizes = parser.value("sizes").split(',', Qt::SkipEmptyParts);
+    for (const QString &size : sizes) {
+        qint64 tasks = size.trimmed().toLongLong();
+        if (tasks <= 0) continue;
+        QString fileName = QDir(parser.value("dir")).filePath(QString("coursework-bench-%1.db").arg(tasks));
+        if (parser.isSet("regenerate") || !QFileInfo::exists(fileName)) {
+            std::fprintf(stderr, "Generating %lld tasks into %s\n", tasks, qPrintable(fileName));
+            DatabaseGenerator generator;
+            if (!generator.generate(fileName, topicsFor(tasks), tasks)) {
+                std::fprintf(stderr, "%s\n", qPrintable(generator.lastError()));
+                return 1;
+            }
+        }
+        std::fprintf(stderr, "Benchmarking %lld tasks\n", tasks);
+        runSuite(fileName, tasks, iterations, results);
+    }
+
+    QJsonArray entries;
+    for (const Result &result : results) entries.append(toJson(result));
+    QJsonObject report;
+    report.insert("timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    report.insert("version", QCoreApplication::applicationVersion());
+    report.insert("qt_version", qVersion());
+    report.insert("sqlite_version", sqliteVersion());
+    report.insert("results", entries);
+    QFile output(parser.value("output"));
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        std::fprintf(stderr, "%s\n", qPrintable(output.errorString()));
+        return 1;
+    }
+    output.write(QJsonDocument(report).toJson());
+    std::fprintf(stderr, "Wrote %s\n", qPrintable(output.fileName()));
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "changelog.h"
+#include "querytrace.h"
+#include <QSet>
+#include <QSqlError>
+
+ChangeLog::ChangeLog(const QSqlDatabase &db)
+    : db(db), versionQuery(db), lastQuery(db), firstQuery(db), changesQuery(db), pruneQuery(db)
+{
+    versionQuery.prepare("PRAGMA data_version");
+    lastQuery.prepare("SELECT MAX(seq) FROM change_log");
+    firstQuery.prepare("SELECT MIN(seq) FROM change_log");
+    changesQuery.setForwardOnly(true);
+    changesQuery.prepare("SELECT seq, entity, row_id FROM change_log WHERE seq > :after ORDER BY seq LIMIT :limit");
+    pruneQuery.prepare("DELETE FROM change_log WHERE seq <= :before");
+}
+
+bool ChangeLog::exec(QSqlQuery &query)
+{
+    if (query.exec()) {
+        error.clear();
+        return true;
+    }
+    error = query.lastError().text();
+    return false;
+}
+
+// Changes only when another connection commits, so an unchanged value means
+// there is nothing new to read.
+qint64 ChangeLog::dataVersion()
+{
+    QuerySpan span(versionQuery);
+    qint64 version = -1;
+    if (exec(versionQuery) && versionQuery.next()) version = versionQuery.value(0).toLongLong();
+    versionQuery.finish();
+    return version;
+}
+
+qint64 ChangeLog::lastSequence()
+{
+    QuerySpan span(lastQuery);
+    qint64 sequence = 0;
+    if (exec(lastQuery) && lastQuery.next()) sequence = lastQuery.value(0).toLongLong();
+    lastQuery.finish();
+    return sequence;
+}
+
+bool ChangeLog::changesSince(qint64 sequence, int limit, ChangeSet &changes)
+{
+    changes.lastSequence = sequence;
+    {
+        QuerySpan span(firstQuery);
+        if (!exec(firstQuery)) return false;
+        // Sequence numbers are never reused, so a hole before the oldest
+        // entry means rows this reader never saw were pruned.
+        if (firstQuery.next() && !firstQuery.value(0).isNull() && firstQuery.value(0).toLongLong() > sequence + 1) {
+            changes.reset = true;
+        }
+        firstQuery.finish();
+    }
+    QuerySpan span(changesQuery);
+    changesQuery.bindValue(":after", sequence);
+    changesQuery.bindValue(":limit", limit);
+    if (!exec(changesQuery)) return false;
+    QSet<int> topics;
+    QSet<int> tasks;
+    int rows = 0;
+    while (changesQuery.next()) {
+        changes.lastSequence = changesQuery.value(0).toLongLong();
+        int id = changesQuery.value(2).toInt();
+        if (changesQuery.value(1).toInt() == TopicEntity) {
+            if (!topics.contains(id)) changes.topicIds.append(id);
+            topics.insert(id);
+        } else {
+            if (!tasks.contains(id)) changes.taskIds.append(id);
+            tasks.insert(id);
+        }
+        ++rows;
+    }
+    span.setRows(rows);
+    changesQuery.finish();
+    if (rows >= limit) changes.reset = true;
+    return true;
+}
+
+// Pruning is itself a write other instances notice, so it only runs once the
+// log has grown to twice the retained size.
+bool ChangeLog::prune(int keep)
+{
+    qint64 last = lastSequence();
+    qint64 first = 0;
+    {
+        QuerySpan span(firstQuery);
+        if (!exec(firstQuery)) return false;
+        if (firstQuery.next()) first = firstQuery.value(0).toLongLong();
+        firstQuery.finish();
+    }
+    if (last - first < 2 * qint64(keep)) return true;
+    QuerySpan span(pruneQuery);
+    pruneQuery.bindValue(":before", last - keep);
+    return exec(pruneQuery);
+}
@@ -0,0 +1,41 @@
+#ifndef CHANGELOG_H
+#define CHANGELOG_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVector>
+
+// Rows touched since a change_log sequence number. reset means the reader
+// fell behind the pruned log or too much changed to patch row by row.
+struct ChangeSet
+{
+    qint64 lastSequence = 0;
+    bool reset = false;
+    QVector<int> topicIds;
+    QVector<int> taskIds;
+};
+
+// Reads the change_log table that triggers fill on every write to topics and
+// tasks, from any connection or process sharing the file.
+class ChangeLog
+{
+public:
+    enum Entity { TopicEntity = 0, TaskEntity = 1 };
+    explicit ChangeLog(const QSqlDatabase &db);
+    qint64 dataVersion();
+    qint64 lastSequence();
+    bool changesSince(qint64 sequence, int limit, ChangeSet &changes);
+    bool prune(int keep);
+    QString lastError() const { return error; }
+private:
+    QSqlDatabase db;
+    QSqlQuery versionQuery;
+    QSqlQuery lastQuery;
+    QSqlQuery firstQuery;
+    QSqlQuery changesQuery;
+    QSqlQuery pruneQuery;
+    QString error;
+    bool exec(QSqlQuery &query);
+};
+
+#endif // CHANGELOG_H
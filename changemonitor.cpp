@@ -0,0 +1,64 @@
+#include "changemonitor.h"
+#include "databaseworker.h"
+#include <QTimer>
+
+namespace {
+const int PollMs = 1000;
+const int MaxChanges = 4096;
+const int KeepChanges = 20000;
+}
+
+ChangeMonitor::ChangeMonitor(DatabaseWorker *worker, QObject *parent)
+    : QObject(parent), worker(worker), timer(new QTimer(this))
+{
+    timer->setSingleShot(true);
+    timer->setInterval(PollMs);
+    connect(timer, &QTimer::timeout, this, &ChangeMonitor::poll);
+}
+
+void ChangeMonitor::start()
+{
+    sequence = -1;
+    poll();
+}
+
+void ChangeMonitor::poll()
+{
+    qint64 since = sequence;
+    qint64 seen = version;
+    worker->post("changes", [since, seen](DatabaseSession &session) {
+        ExternalChanges result;
+        ChangeLog &log = session.changes();
+        // Read before data_version: a commit landing in between moves the
+        // version, so its entries are not skipped on the next poll.
+        qint64 last = log.lastSequence();
+        result.version = log.dataVersion();
+        result.changes.lastSequence = last;
+        if (since < 0 || result.version == seen) {
+            if (since >= 0 && last > since) log.prune(KeepChanges);
+            return result;
+        }
+        if (!log.changesSince(since, MaxChanges, result.changes) || result.changes.reset) {
+            result.changes.reset = true;
+            result.changes.lastSequence = last;
+            session.topics().clearCache();
+            return result;
+        }
+        if (!result.changes.topicIds.isEmpty()) result.topics = session.topics().all();
+        if (!result.changes.taskIds.isEmpty()) result.tasks = session.tasks().briefs(result.changes.taskIds);
+        log.prune(KeepChanges);
+        return result;
+    }, this, [this, since](const ExternalChanges &result) {
+        version = result.version;
+        sequence = result.changes.lastSequence;
+        if (since >= 0) {
+            if (result.changes.reset) {
+                emit reloadNeeded();
+            } else {
+                if (!result.changes.topicIds.isEmpty()) emit topicsChanged(result.topics);
+                if (!result.changes.taskIds.isEmpty()) emit tasksChanged(result.changes.taskIds, result.tasks);
+            }
+        }
+        timer->start();
+    });
+}
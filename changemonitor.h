@@ -0,0 +1,42 @@
+#ifndef CHANGEMONITOR_H
+#define CHANGEMONITOR_H
+
+#include <QObject>
+#include <QVector>
+#include "changelog.h"
+#include "taskrepository.h"
+#include "topicrepository.h"
+
+class QTimer;
+class DatabaseWorker;
+
+struct ExternalChanges
+{
+    qint64 version = -1;
+    ChangeSet changes;
+    QVector<TopicRecord> topics;
+    QVector<TaskBrief> tasks;
+};
+
+// Notices writes made to the database file by other processes. Each poll
+// reads PRAGMA data_version; only when it moved are the change_log entries
+// since the last poll read, together with the current state of those rows.
+class ChangeMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ChangeMonitor(DatabaseWorker *worker, QObject *parent = nullptr);
+    void start();
+signals:
+    void topicsChanged(const QVector<TopicRecord> &topics);
+    void tasksChanged(const QVector<int> &taskIds, const QVector<TaskBrief> &tasks);
+    void reloadNeeded();
+private:
+    void poll();
+    DatabaseWorker *worker;
+    QTimer *timer;
+    qint64 sequence = -1;
+    qint64 version = -1;
+};
+
+#endif // CHANGEMONITOR_H
@@ -0,0 +1,105 @@
+#include "databasegenerator.h"
+#include "databaseworker.h"
+#include "schemamigrator.h"
+#include <QDateTime>
+#include <QFile>
+#include <QSqlError>
+
+namespace {
+const int BatchSize = 20000;
+const char ConnectionName[] = "generator";
+const char *const Vocabulary[] = {
+    "review", "report", "draft", "meeting", "invoice", "deploy", "release", "budget", "client", "update",
+    "schedule", "design", "test", "fix", "call", "email", "plan", "research", "backup", "server",
+    "lecture", "exam", "homework", "project", "paper", "slides", "notes", "summary", "order", "payment"};
+const int VocabularySize = int(sizeof(Vocabulary) / sizeof(Vocabulary[0]));
+}
+
+DatabaseGenerator::DatabaseGenerator(quint32 seed)
+    : random(seed)
+{
+}
+
+QString DatabaseGenerator::words(int count)
+{
+    std::uniform_int_distribution<int> pick(0, VocabularySize - 1);
+    QString text;
+    text.reserve(count * 8);
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) text += (i % 12 == 0) ? QStringLiteral(".\n") : QStringLiteral(" ");
+        text += QLatin1String(Vocabulary[pick(random)]);
+    }
+    return text;
+}
+
+QString DatabaseGenerator::description()
+{
+    std::uniform_int_distribution<int> bucket(0, 999);
+    int roll = bucket(random);
+    if (roll < 150) return QString();
+    if (roll < 900) return words(std::uniform_int_distribution<int>(3, 40)(random));
+    if (roll < 995) return words(std::uniform_int_distribution<int>(150, 600)(random));
+    return words(std::uniform_int_distribution<int>(8000, 20000)(random));
+}
+
+bool DatabaseGenerator::generate(const QString &fileName, int topicCount, qint64 taskCount)
+{
+    error.clear();
+    QFile::remove(fileName);
+    QFile::remove(fileName + "-wal");
+    QFile::remove(fileName + "-shm");
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", ConnectionName);
+        db.setDatabaseName(fileName);
+        if (!db.open()) {
+            error = db.lastError().text();
+        } else {
+            SchemaMigrator::configureConnection(db);
+            SchemaMigrator migrator(db);
+            if (!migrator.migrate()) {
+                error = migrator.lastError();
+            } else {
+                DatabaseSession session(db);
+                QVector<int> topicIds;
+                db.transaction();
+                for (int i = 0; i < topicCount; ++i) {
+                    topicIds.append(session.topics().insert(QString("Topic %1").arg(i + 1)));
+                }
+                qint64 now = QDateTime::currentSecsSinceEpoch();
+                std::uniform_int_distribution<int> topic(0, topicCount - 1);
+                std::uniform_int_distribution<qint64> due(now - 30 * 86400, now + 90 * 86400);
+                std::uniform_int_distribution<int> percent(0, 99);
+                ok = true;
+                for (qint64 i = 0; i < taskCount && ok; ++i) {
+                    TaskRecord task;
+                    task.topicId = topicIds.at(topic(random));
+                    task.name = QString("%1 %2").arg(words(std::uniform_int_distribution<int>(2, 6)(random))).arg(i + 1);
+                    task.description = description();
+                    task.dueDate = QDateTime::fromSecsSinceEpoch(due(random));
+                    task.notify = percent(random) < 20;
+                    task.done = task.dueDate.toSecsSinceEpoch() < now && percent(random) < 70;
+                    task.notified = task.notify && task.done;
+                    if (session.tasks().insert(task) < 0) {
+                        error = session.tasks().lastError();
+                        ok = false;
+                    } else if ((i + 1) % BatchSize == 0) {
+                        ok = db.commit() && db.transaction();
+                        if (!ok) error = db.lastError().text();
+                    }
+                }
+                if (ok) {
+                    ok = db.commit();
+                    if (!ok) error = db.lastError().text();
+                } else {
+                    db.rollback();
+                }
+                QSqlQuery query(db);
+                query.exec("PRAGMA optimize");
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(ConnectionName);
+    return ok;
+}
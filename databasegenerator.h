@@ -0,0 +1,23 @@
+#ifndef DATABASEGENERATOR_H
+#define DATABASEGENERATOR_H
+
+#include <QString>
+#include <random>
+
+// Fills a task database with synthetic topics and tasks for benchmarking.
+// Output is deterministic for a given seed. Description lengths follow a
+// skewed distribution: mostly short notes, some pages, a few very large.
+class DatabaseGenerator
+{
+public:
+    explicit DatabaseGenerator(quint32 seed = 1);
+    bool generate(const QString &fileName, int topicCount, qint64 taskCount);
+    QString lastError() const { return error; }
+private:
+    QString words(int count);
+    QString description();
+    std::mt19937 random;
+    QString error;
+};
+
+#endif // DATABASEGENERATOR_H
@@ -0,0 +1,101 @@
+#include "databaseworker.h"
+#include "schemamigrator.h"
+#include <QSqlError>
+#include <QDebug>
+
+DatabaseSession::DatabaseSession(const QSqlDatabase &db)
+    : db(db), topicRepository(db), taskRepository(db), changeLog(db)
+{
+}
+
+DatabaseWorker::DatabaseWorker(const QString &databaseName, QObject *parent)
+    : QThread(parent), databaseName(databaseName)
+{
+}
+
+DatabaseWorker::~DatabaseWorker()
+{
+    stop();
+}
+
+void DatabaseWorker::cancel(const QString &channel)
+{
+    if (channel.isEmpty()) return;
+    QMutexLocker locker(&mutex);
+    generations.insert(channel, nextGeneration++);
+}
+
+void DatabaseWorker::stop()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+    }
+    wake.wakeAll();
+    wait();
+}
+
+quint64 DatabaseWorker::enqueue(const QString &channel, QObject *receiver, Task task)
+{
+    QMutexLocker locker(&mutex);
+    quint64 generation = nextGeneration++;
+    if (!channel.isEmpty()) generations.insert(channel, generation);
+    queue.push_back({channel, generation, receiver, std::move(task)});
+    wake.wakeOne();
+    return generation;
+}
+
+bool DatabaseWorker::isCurrent(const QString &channel, quint64 generation) const
+{
+    QMutexLocker locker(&mutex);
+    return isCurrentLocked(channel, generation);
+}
+
+bool DatabaseWorker::isCurrentLocked(const QString &channel, quint64 generation) const
+{
+    return channel.isEmpty() || generations.value(channel) == generation;
+}
+
+void DatabaseWorker::run()
+{
+    const QString connectionName = QString("worker-%1").arg(reinterpret_cast<quintptr>(this));
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(databaseName);
+        QString error;
+        bool ok = db.open();
+        if (ok) {
+            SchemaMigrator::configureConnection(db);
+            SchemaMigrator migrator(db);
+            ok = migrator.migrate();
+            error = migrator.lastError();
+        } else {
+            error = db.lastError().text();
+        }
+        emit databaseOpened(ok, error);
+        {
+            DatabaseSession session(db);
+            forever {
+                Request request;
+                {
+                    QMutexLocker locker(&mutex);
+                    while (queue.empty() && !stopping) wake.wait(&mutex);
+                    if (queue.empty()) break;
+                    request = std::move(queue.front());
+                    queue.pop_front();
+                    if (!isCurrentLocked(request.channel, request.generation)) continue;
+                }
+                Continuation continuation = request.task(session);
+                QObject *receiver = request.receiver.data();
+                if (!continuation || !receiver) continue;
+                QString channel = request.channel;
+                quint64 generation = request.generation;
+                QMetaObject::invokeMethod(receiver, [this, channel, generation, continuation]() {
+                    if (isCurrent(channel, generation)) continuation();
+                }, Qt::QueuedConnection);
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
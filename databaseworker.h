@@ -0,0 +1,90 @@
+#ifndef DATABASEWORKER_H
+#define DATABASEWORKER_H
+
+#include <QThread>
+#include <QSqlDatabase>
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QWaitCondition>
+#include "taskrepository.h"
+#include "topicrepository.h"
+#include "changelog.h"
+#include <deque>
+#include <functional>
+
+class DatabaseSession
+{
+public:
+    explicit DatabaseSession(const QSqlDatabase &db);
+    QSqlDatabase database() const { return db; }
+    TopicRepository &topics() { return topicRepository; }
+    TaskRepository &tasks() { return taskRepository; }
+    ChangeLog &changes() { return changeLog; }
+private:
+    QSqlDatabase db;
+    TopicRepository topicRepository;
+    TaskRepository taskRepository;
+    ChangeLog changeLog;
+};
+
+// Runs every SQL request on one background connection. Requests posted on
+// the same non-empty channel supersede each other: a queued request that is
+// no longer the latest on its channel is skipped, and a finished one is not
+// delivered. Requests on the empty channel always run.
+class DatabaseWorker : public QThread
+{
+    Q_OBJECT
+public:
+    explicit DatabaseWorker(const QString &databaseName, QObject *parent = nullptr);
+    ~DatabaseWorker() override;
+    template <typename Job, typename Done>
+    quint64 post(const QString &channel, Job job, QObject *receiver, Done done);
+    template <typename Job>
+    quint64 post(const QString &channel, Job job);
+    void cancel(const QString &channel);
+    void stop();
+signals:
+    void databaseOpened(bool ok, const QString &error);
+protected:
+    void run() override;
+private:
+    using Continuation = std::function<void()>;
+    using Task = std::function<Continuation(DatabaseSession &)>;
+    struct Request {
+        QString channel;
+        quint64 generation;
+        QPointer<QObject> receiver;
+        Task task;
+    };
+    quint64 enqueue(const QString &channel, QObject *receiver, Task task);
+    bool isCurrent(const QString &channel, quint64 generation) const;
+    bool isCurrentLocked(const QString &channel, quint64 generation) const;
+    QString databaseName;
+    mutable QMutex mutex;
+    QWaitCondition wake;
+    std::deque<Request> queue;
+    QHash<QString, quint64> generations;
+    quint64 nextGeneration = 1;
+    bool stopping = false;
+};
+
+template <typename Job, typename Done>
+quint64 DatabaseWorker::post(const QString &channel, Job job, QObject *receiver, Done done)
+{
+    return enqueue(channel, receiver, [job, done](DatabaseSession &session) -> Continuation {
+        auto result = job(session);
+        return [done, result]() { done(result); };
+    });
+}
+
+template <typename Job>
+quint64 DatabaseWorker::post(const QString &channel, Job job)
+{
+    return enqueue(channel, nullptr, [job](DatabaseSession &session) -> Continuation {
+        job(session);
+        return Continuation();
+    });
+}
+
+#endif // DATABASEWORKER_H
@@ -0,0 +1,76 @@
+#include "descriptioncache.h"
+#include "databaseworker.h"
+#include <QHash>
+
+namespace {
+const int CacheBytes = 32 * 1024 * 1024;
+
+int cost(const QString &description)
+{
+    return qMax(1, int(description.size() * sizeof(QChar)));
+}
+}
+
+DescriptionCache::DescriptionCache(DatabaseWorker *worker, QObject *parent)
+    : QObject(parent), worker(worker), cache(CacheBytes)
+{
+}
+
+bool DescriptionCache::lookup(int taskId, QString &description)
+{
+    QString *cached = cache.object(taskId);
+    if (!cached) return false;
+    description = *cached;
+    return true;
+}
+
+void DescriptionCache::request(int taskId)
+{
+    worker->post("description", [taskId](DatabaseSession &session) {
+        return session.tasks().description(taskId);
+    }, this, [this, taskId](const QString &description) {
+        store(taskId, description);
+        emit descriptionReady(taskId, description);
+    });
+}
+
+void DescriptionCache::prefetch(const QVector<int> &taskIds)
+{
+    QVector<int> missing;
+    for (int taskId : taskIds) {
+        if (taskId >= 0 && !cache.contains(taskId)) missing.append(taskId);
+    }
+    // A newer prefetch supersedes the previous one on the same channel.
+    prefetching = QSet<int>(missing.cbegin(), missing.cend());
+    if (missing.isEmpty()) {
+        worker->cancel("description.prefetch");
+        return;
+    }
+    worker->post("description.prefetch", [missing](DatabaseSession &session) {
+        QHash<int, QString> descriptions;
+        for (int taskId : missing) descriptions.insert(taskId, session.tasks().description(taskId));
+        return descriptions;
+    }, this, [this](const QHash<int, QString> &descriptions) {
+        for (auto it = descriptions.cbegin(); it != descriptions.cend(); ++it) {
+            if (prefetching.remove(it.key()) && !cache.contains(it.key())) store(it.key(), it.value());
+        }
+    });
+}
+
+void DescriptionCache::store(int taskId, const QString &description)
+{
+    cache.insert(taskId, new QString(description), cost(description));
+}
+
+void DescriptionCache::invalidate(int taskId)
+{
+    cache.remove(taskId);
+    prefetching.remove(taskId);
+}
+
+void DescriptionCache::clear()
+{
+    cache.clear();
+    prefetching.clear();
+    worker->cancel("description.prefetch");
+}
@@ -0,0 +1,33 @@
+#ifndef DESCRIPTIONCACHE_H
+#define DESCRIPTIONCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QSet>
+#include <QVector>
+
+class DatabaseWorker;
+
+// Size-bounded LRU cache of task descriptions. Misses are fetched on the
+// database worker; neighbours of the selected row are prefetched in one
+// batch so moving the selection normally hits the cache.
+class DescriptionCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DescriptionCache(DatabaseWorker *worker, QObject *parent = nullptr);
+    bool lookup(int taskId, QString &description);
+    void request(int taskId);
+    void prefetch(const QVector<int> &taskIds);
+    void store(int taskId, const QString &description);
+    void invalidate(int taskId);
+    void clear();
+signals:
+    void descriptionReady(int taskId, const QString &description);
+private:
+    DatabaseWorker *worker;
+    QCache<int, QString> cache;
+    QSet<int> prefetching;
+};
+
+#endif // DESCRIPTIONCACHE_H
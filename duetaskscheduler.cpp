@@ -0,0 +1,99 @@
+#include "duetaskscheduler.h"
+#include "databaseworker.h"
+#include <QDateTime>
+#include <QTimer>
+#include <QDebug>
+#include <limits>
+
+namespace {
+const int HeapLimit = 1024;
+const qint64 MaxSleepMs = 60 * 60 * 1000;
+const qint64 MinRefireMs = 1000;
+const qint64 NoDeadline = std::numeric_limits<qint64>::max();
+}
+
+DueTaskScheduler::DueTaskScheduler(DatabaseWorker *worker, QObject *parent)
+    : QObject(parent), worker(worker), reloading(false), horizon(NoDeadline), lastFiredMs(0),
+      timer(new QTimer(this))
+{
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &DueTaskScheduler::onTimeout);
+}
+
+// Only the earliest HeapLimit pending deadlines are held in memory. Every
+// pending task due strictly before horizon is in the heap; once the clock
+// reaches horizon the window is reloaded from the partial due index.
+void DueTaskScheduler::reload()
+{
+    reloading = true;
+    changesDuringReload.clear();
+    worker->post("scheduler.reload", [](DatabaseSession &session) {
+        QVector<TaskDeadline> deadlines = session.tasks().pendingDeadlines(HeapLimit);
+        if (deadlines.isEmpty() && !session.tasks().lastError().isEmpty()) {
+            qDebug() << "Failed to load due tasks:" << session.tasks().lastError();
+        }
+        return deadlines;
+    }, this, [this](const QVector<TaskDeadline> &deadlines) {
+        heap = decltype(heap)();
+        scheduled.clear();
+        horizon = deadlines.size() == HeapLimit ? deadlines.last().dueAt : NoDeadline;
+        for (const TaskDeadline &deadline : deadlines) {
+            heap.push({deadline.dueAt, deadline.taskId});
+            scheduled.insert(deadline.taskId, deadline.dueAt);
+        }
+        reloading = false;
+        for (auto it = changesDuringReload.constBegin(); it != changesDuringReload.constEnd(); ++it) {
+            apply(it.key(), it->dueAt, it->notify);
+        }
+        changesDuringReload.clear();
+        arm();
+    });
+}
+
+void DueTaskScheduler::scheduleTask(int taskId, qint64 dueAt, bool notify)
+{
+    if (reloading) changesDuringReload.insert(taskId, {dueAt, notify});
+    apply(taskId, dueAt, notify);
+    arm();
+}
+
+void DueTaskScheduler::unscheduleTask(int taskId)
+{
+    scheduleTask(taskId, 0, false);
+}
+
+void DueTaskScheduler::apply(int taskId, qint64 dueAt, bool notify)
+{
+    scheduled.remove(taskId);
+    if (notify && dueAt < horizon) {
+        heap.push({dueAt, taskId});
+        scheduled.insert(taskId, dueAt);
+    }
+}
+
+void DueTaskScheduler::onTimeout()
+{
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    if ((!heap.empty() && heap.top().dueAt <= now) || horizon <= now) {
+        lastFiredMs = QDateTime::currentMSecsSinceEpoch();
+        emit tasksDue();
+    } else {
+        arm();
+    }
+}
+
+void DueTaskScheduler::arm()
+{
+    while (!heap.empty() && scheduled.value(heap.top().taskId, -1) != heap.top().dueAt) {
+        heap.pop();
+    }
+    qint64 next = heap.empty() ? horizon : qMin(heap.top().dueAt, horizon);
+    if (next == NoDeadline) {
+        timer->stop();
+        return;
+    }
+    qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    qint64 delay = qMax(next * 1000 - nowMs, lastFiredMs + MinRefireMs - nowMs);
+    timer->start(static_cast<int>(qBound<qint64>(0, delay, MaxSleepMs)));
+}
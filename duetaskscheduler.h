@@ -0,0 +1,50 @@
+#ifndef DUETASKSCHEDULER_H
+#define DUETASKSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <functional>
+#include <queue>
+#include <vector>
+
+class QTimer;
+class DatabaseWorker;
+
+class DueTaskScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DueTaskScheduler(DatabaseWorker *worker, QObject *parent = nullptr);
+    void reload();
+    void scheduleTask(int taskId, qint64 dueAt, bool notify);
+    void unscheduleTask(int taskId);
+signals:
+    void tasksDue();
+private slots:
+    void onTimeout();
+private:
+    struct Entry {
+        qint64 dueAt;
+        int taskId;
+        bool operator>(const Entry &other) const
+        {
+            return dueAt != other.dueAt ? dueAt > other.dueAt : taskId > other.taskId;
+        }
+    };
+    struct Change {
+        qint64 dueAt;
+        bool notify;
+    };
+    void apply(int taskId, qint64 dueAt, bool notify);
+    void arm();
+    DatabaseWorker *worker;
+    bool reloading;
+    QHash<int, Change> changesDuringReload;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    QHash<int, qint64> scheduled;
+    qint64 horizon;
+    qint64 lastFiredMs;
+    QTimer *timer;
+};
+
+#endif // DUETASKSCHEDULER_H
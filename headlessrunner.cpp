@@ -0,0 +1,318 @@
+#include "headlessrunner.h"
+#include "databaseworker.h"
+#include "schemamigrator.h"
+#include "tasktransfer.h"
+#include "recurrence.h"
+#include "syncprotocol.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSettings>
+#include <QSqlError>
+#include <cstdio>
+#include <limits>
+#include <utility>
+
+namespace {
+const char *const Commands[] = {"due", "overdue", "add", "complete", "counts", "import", "export", "sync", "serve",
+                              "vacuum"};
+const char ConnectionName[] = "headless";
+const char PeerConnectionName[] = "headless-peer";
+
+QString openDatabase(QSqlDatabase &db)
+{
+    if (!db.open()) return "Database failed to open: " + db.lastError().text();
+    SchemaMigrator::configureConnection(db);
+    SchemaMigrator migrator(db);
+    if (!migrator.migrate()) return "Database migration failed: " + migrator.lastError();
+    return QString();
+}
+
+QJsonObject taskObject(const TaskRecord &task)
+{
+    QJsonObject object;
+    object.insert("id", task.id);
+    object.insert("topic", task.topicName);
+    object.insert("name", task.name);
+    object.insert("due_date", task.dueDate.toString(Qt::ISODate));
+    object.insert("notify", task.notify);
+    object.insert("notified", task.notified);
+    if (!task.recurrence.isEmpty()) object.insert("recurrence", task.recurrence);
+    return object;
+}
+}
+
+bool HeadlessRunner::wantsHeadless(int argc, char *argv[])
+{
+    if (argc < 2) return false;
+    for (const char *command : Commands) {
+        if (qstrcmp(argv[1], command) == 0) return true;
+    }
+    return false;
+}
+
+int HeadlessRunner::run(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Scripted access to the task database.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "due | overdue | add | complete | counts | import | export | sync | serve | vacuum");
+    parser.addPositionalArgument("args", "add: TOPIC NAME; complete: ID...; import/export: FILE; sync: PEER_DB",
+                                 "[args...]");
+    parser.addOption({"db", "Task database file (default: the one the GUI uses).", "file",
+                      QSettings().value("databasePath", "tasks.db").toString()});
+    parser.addOption({"within", "due: look ahead this many hours (default 24).", "hours", "24"});
+    parser.addOption({"limit", "due/overdue: maximum number of tasks (default 1000).", "count", "1000"});
+    parser.addOption({"description", "add: task description.", "text"});
+    parser.addOption({"due", "add: due date in ISO 8601 (default now).", "datetime"});
+    parser.addOption({"notify", "add: enable the due notification."});
+    parser.addOption({"repeat", "add: recurrence rule, e.g. FREQ=WEEKLY;BYDAY=MO,TH.", "rule"});
+    parser.addOption({"process", "sync: serve the peer database from a separate process."});
+    parser.addOption({"new-replica", "sync: give this database a new replica id, e.g. after copying the file."});
+    parser.process(arguments);
+    QStringList positional = parser.positionalArguments();
+    if (positional.isEmpty()) return fail("missing command", 2);
+    QString command = positional.takeFirst();
+
+    int code = 0;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", ConnectionName);
+        db.setDatabaseName(parser.value("db"));
+        QString error = openDatabase(db);
+        if (!error.isEmpty()) {
+            code = fail(error);
+        } else {
+            DatabaseSession session(db);
+            qint64 now = QDateTime::currentSecsSinceEpoch();
+            int limit = parser.value("limit").toInt();
+            if (command == "due") {
+                code = listDue(session, now, now + qint64(parser.value("within").toDouble() * 3600), limit);
+            } else if (command == "overdue") {
+                code = listDue(session, std::numeric_limits<qint64>::min(), now, limit);
+            } else if (command == "add") {
+                QStringList values = positional;
+                values << parser.value("description") << parser.value("due")
+                       << (parser.isSet("notify") ? "1" : "0") << parser.value("repeat");
+                code = positional.size() == 2 ? addTask(session, values) : fail("usage: add TOPIC NAME", 2);
+            } else if (command == "complete") {
+                code = positional.isEmpty() ? fail("usage: complete ID...", 2) : completeTasks(session, positional);
+            } else if (command == "counts") {
+                code = printCounts(session);
+            } else if (command == "import" || command == "export") {
+                code = positional.size() == 1 ? transfer(session, command, positional.first())
+                                              : fail("usage: " + command + " FILE", 2);
+            } else if (command == "sync") {
+                code = positional.size() <= 1 ? sync(db, positional.value(0), parser.isSet("process"),
+                                                     parser.isSet("new-replica"))
+                                              : fail("usage: sync [--process] [--new-replica] PEER_DB", 2);
+            } else if (command == "serve") {
+                code = serve(db);
+            } else if (command == "vacuum") {
+                code = vacuum(db);
+            } else {
+                code = fail("unknown command: " + command, 2);
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(ConnectionName);
+    return code;
+}
+
+int HeadlessRunner::listDue(DatabaseSession &session, qint64 from, qint64 to, int limit)
+{
+    const QVector<TaskRecord> tasks = session.tasks().openTasksDueBetween(from, to, limit);
+    if (tasks.isEmpty() && !session.tasks().lastError().isEmpty()) return fail(session.tasks().lastError());
+    for (const TaskRecord &task : tasks) print(taskObject(task));
+    return 0;
+}
+
+int HeadlessRunner::addTask(DatabaseSession &session, const QStringList &values)
+{
+    TaskRecord task;
+    task.topicName = values.at(0);
+    task.name = values.at(1);
+    task.description = values.at(2);
+    task.dueDate = values.at(3).isEmpty() ? QDateTime::currentDateTime() : QDateTime::fromString(values.at(3), Qt::ISODate);
+    task.notify = values.at(4) == "1";
+    task.recurrence = Recurrence::fromRule(values.at(5)).toRule();
+    if (!values.at(5).isEmpty() && task.recurrence.isEmpty()) return fail("invalid recurrence rule: " + values.at(5), 2);
+    if (task.topicName.isEmpty() || task.name.isEmpty()) return fail("topic and name must not be empty", 2);
+    if (!task.dueDate.isValid()) return fail("invalid due date: " + values.at(3), 2);
+    task.topicId = session.topics().insert(task.topicName);
+    if (task.topicId < 0) return fail("Failed to add topic: " + session.topics().lastError());
+    task.id = session.tasks().insert(task);
+    if (task.id < 0) return fail("Failed to add task: " + session.tasks().lastError());
+    print(taskObject(task));
+    return 0;
+}
+
+int HeadlessRunner::completeTasks(DatabaseSession &session, const QStringList &ids)
+{
+    QVector<int> taskIds;
+    for (const QString &value : ids) {
+        bool ok = false;
+        taskIds.append(value.toInt(&ok));
+        if (!ok) return fail("invalid task id: " + value, 2);
+    }
+    // Results are printed only once the whole batch is committed, so the
+    // output never reports a change that was rolled back.
+    QSqlDatabase db = session.database();
+    if (!db.transaction()) return fail(db.lastError().text());
+    QVector<QJsonObject> results;
+    for (int taskId : std::as_const(taskIds)) {
+        TaskRecord task;
+        if (!session.tasks().find(taskId, task)) {
+            db.rollback();
+            QString error = session.tasks().lastError();
+            return fail(error.isEmpty() ? QString("no such task: %1").arg(taskId) : error);
+        }
+        if (!session.tasks().setDone(taskId, true)) {
+            db.rollback();
+            return fail("Failed to update task status: " + session.tasks().lastError());
+        }
+        results.append({{"id", taskId}, {"done", true}});
+    }
+    if (!db.commit()) {
+        QString error = db.lastError().text();
+        db.rollback();
+        return fail(error);
+    }
+    for (const QJsonObject &result : std::as_const(results)) print(result);
+    return 0;
+}
+
+int HeadlessRunner::printCounts(DatabaseSession &session)
+{
+    if (!session.topics().advanceClock(QDateTime::currentSecsSinceEpoch())) return fail(session.topics().lastError());
+    const QVector<TopicSummary> summaries = session.topics().summaries();
+    if (summaries.isEmpty() && !session.topics().lastError().isEmpty()) return fail(session.topics().lastError());
+    for (const TopicSummary &summary : summaries) {
+        QJsonObject object{{"topic", summary.name}, {"total", summary.total}, {"done", summary.done},
+                           {"open", summary.total - summary.done}, {"overdue", summary.overdue}};
+        if (summary.nextDue > 0) object.insert("next_due", QDateTime::fromSecsSinceEpoch(summary.nextDue).toString(Qt::ISODate));
+        print(object);
+    }
+    return 0;
+}
+
+int HeadlessRunner::transfer(DatabaseSession &session, const QString &command, const QString &fileName)
+{
+    TaskTransfer transfer(session);
+    TaskTransfer::Format format = TaskTransfer::formatForFile(fileName);
+    TransferProgress progress = command == "import" ? transfer.importFile(fileName, format)
+                                                    : transfer.exportFile(fileName, format);
+    print({{"command", command}, {"file", fileName}, {"ok", progress.ok}, {"rows", progress.rows},
+           {"bytes", progress.bytes}, {"elapsed_ms", progress.elapsedMs},
+           {"rows_per_second", qRound64(progress.rowsPerSecond())}});
+    return progress.ok ? 0 : fail(progress.error);
+}
+
+int HeadlessRunner::sync(const QSqlDatabase &db, const QString &peerFile, bool process, bool newReplica)
+{
+    if (newReplica) {
+        SyncJournal journal(db);
+        if (!journal.resetReplica()) return fail("Failed to reset the replica id: " + journal.lastError());
+        if (peerFile.isEmpty()) {
+            print({{"command", "sync"}, {"replica", journal.replica()}});
+            return 0;
+        }
+    }
+    if (peerFile.isEmpty()) return fail("usage: sync [--process] [--new-replica] PEER_DB", 2);
+    SyncClient client(db);
+    SyncStats stats;
+    if (process) {
+        // Stands in for a sync server: the same executable answering frames
+        // on its standard input and output.
+        QProcess server;
+        server.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        server.start(QCoreApplication::applicationFilePath(), {"serve", "--db", peerFile});
+        if (!server.waitForStarted()) return fail("Failed to start the sync server: " + server.errorString());
+        stats = client.run([&server](const QByteArray &request, QByteArray &reply) {
+            return server.write(request) == request.size() && SyncProtocol::readFrame(&server, reply);
+        });
+        server.closeWriteChannel();
+        server.waitForFinished();
+    } else {
+        {
+            QSqlDatabase peer = QSqlDatabase::addDatabase("QSQLITE", PeerConnectionName);
+            peer.setDatabaseName(peerFile);
+            stats.error = openDatabase(peer);
+            if (stats.error.isEmpty()) {
+                SyncServer server(peer);
+                stats = client.run([&server](const QByteArray &request, QByteArray &reply) {
+                    reply = server.handle(request);
+                    return true;
+                });
+            }
+            peer.close();
+        }
+        QSqlDatabase::removeDatabase(PeerConnectionName);
+    }
+    print({{"command", "sync"}, {"peer_db", peerFile}, {"ok", stats.ok}, {"replica", stats.replica},
+           {"peer", stats.peer}, {"pulled", stats.pulled}, {"pushed", stats.pushed},
+           {"applied", stats.local.applied}, {"skipped", stats.local.skipped},
+           {"peer_applied", stats.remote.applied}, {"peer_skipped", stats.remote.skipped},
+           {"bytes_sent", stats.bytesSent}, {"bytes_received", stats.bytesReceived},
+           {"elapsed_ms", stats.elapsedMs}});
+    return stats.ok ? 0 : fail(stats.error);
+}
+
+int HeadlessRunner::serve(const QSqlDatabase &db)
+{
+    QFile input;
+    QFile output;
+    if (!input.open(stdin, QIODevice::ReadOnly | QIODevice::Unbuffered)
+        || !output.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        return fail("Failed to open the standard streams");
+    }
+    SyncServer server(db);
+    return server.serve(&input, &output) ? 0 : fail("Malformed or truncated sync frame");
+}
+
+// Rebuilds the file once so that deleted topics hand their pages back to the
+// file system afterwards. This rewrites the whole database, so it is left to
+// an explicit command rather than done at startup.
+int HeadlessRunner::vacuum(const QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    QElapsedTimer timer;
+    timer.start();
+    bool converted = false;
+    if (!query.exec("PRAGMA auto_vacuum") || !query.next()) return fail(query.lastError().text());
+    if (query.value(0).toInt() != 2) {
+        query.finish();
+        if (!query.exec("PRAGMA auto_vacuum = INCREMENTAL") || !query.exec("VACUUM")) {
+            return fail("Failed to enable incremental vacuum: " + query.lastError().text());
+        }
+        converted = true;
+    } else {
+        query.finish();
+        if (!query.exec("PRAGMA incremental_vacuum")) return fail(query.lastError().text());
+        while (query.next()) {}
+    }
+    qint64 freePages = 0;
+    if (query.exec("PRAGMA freelist_count") && query.next()) freePages = query.value(0).toLongLong();
+    print({{"command", "vacuum"}, {"converted", converted}, {"free_pages", freePages},
+           {"elapsed_ms", timer.elapsed()}});
+    return 0;
+}
+
+int HeadlessRunner::fail(const QString &message, int code)
+{
+    QByteArray line = QJsonDocument(QJsonObject{{"error", message}}).toJson(QJsonDocument::Compact);
+    std::fprintf(stderr, "%s\n", line.constData());
+    return code;
+}
+
+void HeadlessRunner::print(const QJsonObject &object)
+{
+    QByteArray line = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    std::fwrite(line.constData(), 1, line.size(), stdout);
+    std::fputc('\n', stdout);
+}
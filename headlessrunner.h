@@ -0,0 +1,31 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QStringList>
+#include <QSqlDatabase>
+
+class QJsonObject;
+class DatabaseSession;
+
+// Runs a single scripted command against the task database without creating
+// any widgets, tray icon or worker thread. Records are printed to stdout as
+// JSON Lines; errors go to stderr as a JSON object with a non-zero exit code.
+class HeadlessRunner
+{
+public:
+    static bool wantsHeadless(int argc, char *argv[]);
+    int run(const QStringList &arguments);
+private:
+    int listDue(DatabaseSession &session, qint64 from, qint64 to, int limit);
+    int addTask(DatabaseSession &session, const QStringList &values);
+    int completeTasks(DatabaseSession &session, const QStringList &ids);
+    int printCounts(DatabaseSession &session);
+    int transfer(DatabaseSession &session, const QString &command, const QString &fileName);
+    int sync(const QSqlDatabase &db, const QString &peerFile, bool process, bool newReplica);
+    int serve(const QSqlDatabase &db);
+    int vacuum(const QSqlDatabase &db);
+    int fail(const QString &message, int code = 1);
+    void print(const QJsonObject &object);
+};
+
+#endif // HEADLESSRUNNER_H
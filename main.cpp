@@ -1,9 +1,21 @@
 #include "mainwindow.h"
+#include "headlessrunner.h"
+#include "startupprofiler.h"
 #include <QApplication>
 int main(int argc, char *argv[])
 {
+    StartupProfiler::start();
+    QCoreApplication::setOrganizationName("coursework");
+    QCoreApplication::setApplicationName("coursework");
+    if (HeadlessRunner::wantsHeadless(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        HeadlessRunner runner;
+        return runner.run(app.arguments());
+    }
     QApplication a(argc, argv);
+    StartupProfiler::mark("application created");
     MainWindow w;
+    StartupProfiler::mark("main window constructed");
     w.show();
     return a.exec();
 }
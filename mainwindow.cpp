@@ -1,25 +1,178 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
-#include <QSqlQuery>
-#include <QSqlError>
 #include <QMessageBox>
 #include <QInputDialog>
 #include "taskdialog.h"
+#include "tasklistmodel.h"
+#include "duetaskscheduler.h"
+#include "databaseworker.h"
+#include "searchresultmodel.h"
+#include "tasktransfer.h"
+#include "descriptioncache.h"
+#include "notificationqueue.h"
+#include "performancedock.h"
+#include "startupprofiler.h"
+#include "topicdeleter.h"
+#include "topicbadgedelegate.h"
+#include "topicdashboard.h"
+#include "alltasksmodel.h"
+#include "changemonitor.h"
+#include "topicindex.h"
+#include "topiclistmodel.h"
 #include <QDateTime>
 #include <QDebug>
 #include <QTimer>
 #include <QStyle>
+#include <QScrollBar>
+#include <QFileDialog>
+#include <QPointer>
+#include <QTextCursor>
+#include <QSettings>
+#include <QLocale>
+#include <QSqlError>
+#include <QMenu>
+#include <QSet>
+#include <QPushButton>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QLabel>
+#include <QHBoxLayout>
+#include <QDateTimeEdit>
+#include <QDialogButtonBox>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+const int DescriptionChunk = 64 * 1024;
+const int PrefetchRadius = 8;
+const int ToggleFlushMs = 750;
+const int StatsRefreshMs = 60 * 1000;
+
+struct WriteResult
+{
+    bool ok = false;
+    QString error;
+    int id = -1;
+};
+
+WriteResult writeResult(bool ok, const QString &error, int id = -1)
+{
+    WriteResult result;
+    result.ok = ok;
+    result.error = error;
+    result.id = id;
+    return result;
+}
+
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    performanceDock = new PerformanceDock(this);
+    addDockWidget(Qt::RightDockWidgetArea, performanceDock);
+    performanceDock->hide();
+    ui->menuView->addAction(performanceDock->toggleViewAction());
+    topicDashboard = new TopicDashboard(this);
+    addDockWidget(Qt::RightDockWidgetArea, topicDashboard);
+    topicDashboard->hide();
+    ui->menuView->addAction(topicDashboard->toggleViewAction());
+    connect(topicDashboard, &TopicDashboard::topicActivated, this, &MainWindow::selectTopic);
+    connect(topicDashboard, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) refreshTopicStats();
+    });
+    topicIndex = new TopicIndex(this);
+    topicModel = new TopicListModel(topicIndex, this);
+    ui->listViewTopic->setModel(topicModel);
+    ui->listViewTopic->setItemDelegate(new TopicBadgeDelegate(ui->listViewTopic));
+    statsTimer = new QTimer(this);
+    statsTimer->setInterval(StatsRefreshMs);
+    connect(statsTimer, &QTimer::timeout, this, &MainWindow::advanceTopicStats);
+    statsTimer->start();
     setupDatabase();
-    connect(ui->listWidgetTopic, &QListWidget::currentTextChanged, this, &MainWindow::loadTasks);
-    connect(ui->listWidgetTask, &QListWidget::currentItemChanged, this, &MainWindow::onTaskSelected);
-    connect(ui->listWidgetTask, &QListWidget::itemChanged, this, &MainWindow::onTaskItemChanged);
+    taskModel = new TaskListModel(worker, this);
+    searchModel = new SearchResultModel(worker, this);
+    descriptionCache = new DescriptionCache(worker, this);
+    descriptionTimer = new QTimer(this);
+    descriptionTimer->setInterval(0);
+    connect(descriptionTimer, &QTimer::timeout, this, &MainWindow::appendDescriptionChunk);
+    connect(descriptionCache, &DescriptionCache::descriptionReady, this, &MainWindow::onDescriptionReady);
+    toggleTimer = new QTimer(this);
+    toggleTimer->setSingleShot(true);
+    toggleTimer->setInterval(ToggleFlushMs);
+    connect(toggleTimer, &QTimer::timeout, this, &MainWindow::flushToggles);
+    connect(ui->listViewTask, &QWidget::customContextMenuRequested, this, &MainWindow::onTaskContextMenu);
+    setupAllTasksView();
+    setTaskViewModel(taskModel);
+    connect(ui->listViewTopic->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::onTopicSelected);
+    connect(ui->listViewTopic, &QAbstractItemView::clicked, this, [this] { allTasksAction->setChecked(false); });
+    connect(ui->lineEditTopicFilter, &QLineEdit::textChanged, this, &MainWindow::filterTopics);
+    connect(ui->lineEditTopicFilter, &QLineEdit::returnPressed, this, [this] {
+        if (topicModel->rowCount() > 0) ui->listViewTopic->setCurrentIndex(topicModel->index(0));
+    });
+    connect(ui->lineEditSearch, &QLineEdit::textChanged, this, &MainWindow::onSearchTextChanged);
+    connect(taskModel, &TaskListModel::taskCheckStateChanged, this, &MainWindow::onTaskItemChanged);
+    connect(searchModel, &SearchResultModel::taskCheckStateChanged, this, &MainWindow::onTaskItemChanged);
+    connect(taskModel, &TaskListModel::topicLoaded, this, &MainWindow::onTopicTasksLoaded);
+    connect(taskModel, &QAbstractItemModel::rowsInserted, this, &MainWindow::updateTaskWindow);
+    connect(ui->listViewTask->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::updateTaskWindow);
     connect(ui->actionExit, &QAction::triggered, this, &MainWindow::on_actionExit_triggered);
-    loadTopics();
+    notificationQueue = new NotificationQueue(this);
+    connect(notificationQueue, &NotificationQueue::notificationReady, this, &MainWindow::showNotification);
+    dueScheduler = new DueTaskScheduler(worker, this);
+    connect(dueScheduler, &DueTaskScheduler::tasksDue, this, &MainWindow::checkDueTasks);
+    topicDeleter = new TopicDeleter(worker, this);
+    connect(topicDeleter, &TopicDeleter::topicHidden, this, &MainWindow::onTopicHidden);
+    connect(topicDeleter, &TopicDeleter::progress, this, &MainWindow::onTopicDeletionProgress);
+    connect(topicDeleter, &TopicDeleter::finished, this, &MainWindow::onTopicDeletionFinished);
+    connect(topicDeleter, &TopicDeleter::failed, this, [this](const QString &topicName, const QString &error) {
+        cancelDeletionButton->setVisible(topicDeleter->isBusy());
+        ui->statusbar->showMessage("Deleting topic '" + topicName + "' stopped (" + error
+                                   + "); it continues on the next start", 10000);
+    });
+    cancelDeletionButton = new QPushButton("Cancel deletion", this);
+    cancelDeletionButton->hide();
+    ui->statusbar->addPermanentWidget(cancelDeletionButton);
+    connect(cancelDeletionButton, &QPushButton::clicked, topicDeleter, &TopicDeleter::cancel);
+    changeMonitor = new ChangeMonitor(worker, this);
+    connect(changeMonitor, &ChangeMonitor::topicsChanged, this, &MainWindow::onTopicsChangedExternally);
+    connect(changeMonitor, &ChangeMonitor::tasksChanged, this, &MainWindow::onTasksChangedExternally);
+    connect(changeMonitor, &ChangeMonitor::reloadNeeded, this, &MainWindow::reloadAll);
+
+    // Show the window before any data arrives: the last topic's first page is
+    // requested right behind the topic list, tray and due checks wait for the
+    // first frame.
+    ui->listViewTopic->setEnabled(false);
+    ui->textEditDescriptionDisplay->setPlaceholderText("Loading...");
+    ui->statusbar->showMessage("Loading topics...");
+    QString lastTopic = QSettings().value("lastTopic").toString();
+    advanceTopicStats();
+    loadTopics(lastTopic);
+    taskModel->setTopic(lastTopic);
+}
+
+MainWindow::~MainWindow()
+{
+    QSettings().setValue("lastTopic", taskModel->topic());
+    flushToggles();
+    worker->stop();
+    delete ui;
+}
+
+void MainWindow::paintEvent(QPaintEvent *event)
+{
+    QMainWindow::paintEvent(event);
+    if (firstFramePainted) return;
+    firstFramePainted = true;
+    StartupProfiler::mark("first frame");
+    QTimer::singleShot(0, this, &MainWindow::setupNotifications);
+}
+
+void MainWindow::setupNotifications()
+{
     trayIcon = new QSystemTrayIcon(this);
     QIcon icon = style()->standardIcon(QStyle::SP_ComputerIcon);
     if (icon.isNull()) {
@@ -38,419 +191,958 @@ MainWindow::MainWindow(QWidget *parent)
     } else {
         qDebug() << "Tray icon is null. setVisible will not display the tray icon.";
     }
-    notificationTimer = new QTimer(this);
-    connect(notificationTimer, &QTimer::timeout, this, &MainWindow::checkDueTasks);
-    notificationTimer->start(30000);
-    QTimer::singleShot(5000, this, &MainWindow::checkDueTasks);
+    dueScheduler->reload();
+    StartupProfiler::mark("notifications ready");
 }
 
-MainWindow::~MainWindow()
+void MainWindow::setupDatabase()
 {
-    db.close();
-    delete ui;
+    QString databasePath = QSettings().value("databasePath", "tasks.db").toString();
+    worker = new DatabaseWorker(databasePath, this);
+    connect(worker, &DatabaseWorker::databaseOpened, this, &MainWindow::onDatabaseOpened);
+    worker->start();
 }
 
-void MainWindow::setupDatabase()
+void MainWindow::setupAllTasksView()
 {
-    db = QSqlDatabase::addDatabase("QSQLITE");
-    db.setDatabaseName("tasks.db");
-    if (!db.open()) {
-        QMessageBox::critical(this, "Error", "Database failed to open: " + db.lastError().text());
+    allTasksModel = new AllTasksModel(worker, this);
+    allTasksBar = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(allTasksBar);
+    layout->setContentsMargins(0, 0, 0, 0);
+    QHBoxLayout *controls = new QHBoxLayout();
+    allTasksSort = new QComboBox(allTasksBar);
+    allTasksSort->addItem("Due Date", TaskSnapshot::ByDueDate);
+    allTasksSort->addItem("Topic", TaskSnapshot::ByTopic);
+    allTasksSort->addItem("Status", TaskSnapshot::ByState);
+    allTasksDescending = new QCheckBox("Descending", allTasksBar);
+    allTasksState = new QComboBox(allTasksBar);
+    allTasksState->addItem("All", TaskSnapshot::AnyState);
+    allTasksState->addItem("Open", TaskSnapshot::OpenOnly);
+    allTasksState->addItem("Done", TaskSnapshot::DoneOnly);
+    allTasksTopic = new QComboBox(allTasksBar);
+    allTasksTopic->addItem("All Topics");
+    controls->addWidget(allTasksSort);
+    controls->addWidget(allTasksDescending);
+    controls->addWidget(allTasksState);
+    controls->addWidget(allTasksTopic, 1);
+    layout->addLayout(controls);
+    allTasksStatus = new QLabel(allTasksBar);
+    layout->addWidget(allTasksStatus);
+    ui->verticalLayoutTasks->insertWidget(ui->verticalLayoutTasks->indexOf(ui->listViewTask), allTasksBar);
+    allTasksBar->hide();
+
+    auto applyOrder = [this] {
+        allTasksModel->setOrder(TaskSnapshot::SortKey(allTasksSort->currentData().toInt()),
+                                allTasksDescending->isChecked());
+    };
+    connect(allTasksSort, QOverload<int>::of(&QComboBox::currentIndexChanged), this, applyOrder);
+    connect(allTasksDescending, &QCheckBox::toggled, this, applyOrder);
+    connect(allTasksState, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::applyAllTasksFilter);
+    connect(allTasksTopic, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::applyAllTasksFilter);
+    connect(allTasksModel, &AllTasksModel::topicsChanged, this, &MainWindow::updateAllTasksTopics);
+    connect(allTasksModel, &AllTasksModel::taskCheckStateChanged, this, &MainWindow::onTaskItemChanged);
+    connect(allTasksModel, &AllTasksModel::viewUpdated, this, [this](int rows, qint64 elapsedMs, qint64 memoryBytes) {
+        allTasksStatus->setText(QString("%1 tasks in %2 ms, %3 MB in memory").arg(rows).arg(elapsedMs)
+                                    .arg(double(memoryBytes) / (1024 * 1024), 0, 'f', 1));
+    });
+
+    allTasksAction = ui->menuView->addAction("All Tasks");
+    allTasksAction->setCheckable(true);
+    allTasksAction->setShortcut(QKeySequence("Ctrl+Shift+A"));
+    connect(allTasksAction, &QAction::toggled, this, &MainWindow::showAllTasks);
+}
+
+// The snapshot is only built the first time the view is opened and kept
+// current by the edit paths afterwards.
+void MainWindow::showAllTasks(bool show)
+{
+    if (show && !allTasksModel->isLoaded()) allTasksModel->reload();
+    ui->lineEditSearch->clear();
+    setTaskViewModel(show ? static_cast<QAbstractItemModel *>(allTasksModel) : taskModel);
+    if (!show) updateTaskWindow();
+}
+
+void MainWindow::applyAllTasksFilter()
+{
+    QString topic = allTasksTopic->currentIndex() > 0 ? allTasksTopic->currentText() : QString();
+    allTasksModel->setFilter(TaskSnapshot::DoneFilter(allTasksState->currentData().toInt()), topic);
+}
+
+void MainWindow::updateAllTasksTopics()
+{
+    QSignalBlocker blocker(allTasksTopic);
+    allTasksTopic->clear();
+    allTasksTopic->addItem("All Topics");
+    allTasksTopic->addItems(allTasksModel->topicNames());
+    allTasksTopic->setCurrentIndex(qMax(0, allTasksTopic->findText(allTasksModel->topic())));
+}
+
+void MainWindow::onDatabaseOpened(bool ok, const QString &error)
+{
+    StartupProfiler::mark("database opened");
+    if (!ok) {
+        QMessageBox::critical(this, "Error", "Database failed to open: " + error);
         return;
     }
-    QSqlQuery query;
-    query.exec("PRAGMA foreign_keys = ON;");
-    query.exec("CREATE TABLE IF NOT EXISTS topics (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT UNIQUE)");
-    query.exec("CREATE TABLE IF NOT EXISTS tasks ("
-               "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-               "topic_id INTEGER, "
-               "name TEXT, "
-               "description TEXT, "
-               "due_date TEXT, "
-               "notify INTEGER, "
-               "notified INTEGER DEFAULT 0, "
-               "done INTEGER DEFAULT 0, "
-               "FOREIGN KEY(topic_id) REFERENCES topics(id) ON DELETE CASCADE)");
-    QSqlQuery checkDoneQuery("PRAGMA table_info(tasks)");
-    bool hasDone = false;
-    while (checkDoneQuery.next()) {
-        if (checkDoneQuery.value(1).toString() == "done") {
-            hasDone = true;
-            break;
-        }
-    }
-    if (!hasDone) {
-        QSqlQuery alterDoneQuery("ALTER TABLE tasks ADD COLUMN done INTEGER DEFAULT 0");
-        if (!alterDoneQuery.exec()) {
-            qDebug() << "Failed to add done column:" << alterDoneQuery.lastError().text();
-        }
-    }
-    QSqlQuery checkDescriptionQuery("PRAGMA table_info(tasks)");
-    bool hasDescription = false;
-    while (checkDescriptionQuery.next()) {
-        if (checkDescriptionQuery.value(1).toString() == "description") {
-            hasDescription = true;
-            break;
-        }
-    }
-    if (!hasDescription) {
-        QSqlQuery alterDescriptionQuery("ALTER TABLE tasks ADD COLUMN description TEXT");
-        if (!alterDescriptionQuery.exec()) {
-            qDebug() << "Failed to add description column:" << alterDescriptionQuery.lastError().text();
+    // Deletions interrupted by the last shutdown continue where they stopped.
+    topicDeleter->resume();
+    changeMonitor->start();
+}
+
+void MainWindow::loadTopics(const QString &selectTopic)
+{
+    worker->cancel("topics.stats");
+    worker->post("topics", [](DatabaseSession &session) {
+        return session.topics().summaries();
+    }, this, [this, selectTopic](const QVector<TopicSummary> &topics) {
+        QString currentTopic = selectTopic.isEmpty() ? selectedTopic() : selectTopic;
+        topicIndex->reset(topics);
+        if (topicDashboard->isVisible()) topicDashboard->setSummaries(topics);
+        int row = topicModel->rowForName(currentTopic);
+        if (row < 0 && topicModel->rowCount() > 0) row = 0;
+        if (row >= 0) ui->listViewTopic->setCurrentIndex(topicModel->index(row));
+        if (!topicsLoaded) {
+            topicsLoaded = true;
+            ui->listViewTopic->setEnabled(true);
+            ui->textEditDescriptionDisplay->setPlaceholderText(QString());
+            ui->statusbar->clearMessage();
+            StartupProfiler::mark(QString("topics loaded (%1)").arg(topics.size()));
         }
-    }
+    });
 }
 
-void MainWindow::loadTopics()
+QString MainWindow::selectedTopic() const
 {
-    QString currentTopic = ui->listWidgetTopic->currentItem()
-    ? ui->listWidgetTopic->currentItem()->text()
-    : QString();
-    ui->listWidgetTopic->clear();
-    QSqlQuery query("SELECT name FROM topics");
-    if (query.exec()) {
-        while (query.next()) {
-            ui->listWidgetTopic->addItem(query.value(0).toString());
+    return ui->listViewTopic->currentIndex().data().toString();
+}
+
+// While a filter hides every topic the task list keeps showing the last one;
+// it only empties once there are no topics at all.
+void MainWindow::onTopicSelected(const QModelIndex &current)
+{
+    if (current.isValid() || topicIndex->size() == 0) loadTasks(current.data().toString());
+}
+
+void MainWindow::filterTopics(const QString &text)
+{
+    topicModel->setPrefix(text.trimmed());
+    int row = topicModel->rowForName(taskModel->topic());
+    if (row >= 0) ui->listViewTopic->setCurrentIndex(topicModel->index(row));
+}
+
+void MainWindow::loadTasks(const QString &topic)
+{
+    if (topic == taskModel->topic()) return;
+    showDescription(QString());
+    taskModel->setTopic(topic);
+}
+
+void MainWindow::setTaskViewModel(QAbstractItemModel *model)
+{
+    if (ui->listViewTask->model() == model) return;
+    QItemSelectionModel *oldSelection = ui->listViewTask->selectionModel();
+    ui->listViewTask->setModel(model);
+    delete oldSelection;
+    allTasksBar->setVisible(model == allTasksModel);
+    connect(ui->listViewTask->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::onTaskSelected);
+    onTaskSelected();
+}
+
+void MainWindow::onSearchTextChanged(const QString &text)
+{
+    if (text.trimmed().isEmpty()) {
+        searchModel->setSearchText(QString());
+        if (allTasksAction->isChecked()) {
+            setTaskViewModel(allTasksModel);
+            return;
         }
+        setTaskViewModel(taskModel);
+        updateTaskWindow();
+    } else {
+        searchModel->setSearchText(text);
+        setTaskViewModel(searchModel);
     }
-    if (!currentTopic.isEmpty()) {
-        QList<QListWidgetItem*> items = ui->listWidgetTopic->findItems(currentTopic, Qt::MatchExactly);
-        if (!items.isEmpty()) {
-            ui->listWidgetTopic->setCurrentItem(items.first());
+}
+
+void MainWindow::reloadTaskViews()
+{
+    if (ui->listViewTask->model() == searchModel) searchModel->refresh();
+    if (allTasksModel->isLoaded()) allTasksModel->reload();
+    taskModel->setTopic(taskModel->topic());
+}
+
+// Counters come from topic_stats, so refreshing every badge is one read.
+void MainWindow::refreshTopicStats()
+{
+    worker->post("topics.stats", [](DatabaseSession &session) {
+        return session.topics().summaries();
+    }, this, [this](const QVector<TopicSummary> &topics) {
+        topicIndex->updateCounters(topics);
+        if (topicDashboard->isVisible()) topicDashboard->setSummaries(topics);
+    });
+}
+
+// Overdue counts move with the clock, not with writes: once at startup and
+// then on every timer tick the watermark catches up with tasks that fell due.
+void MainWindow::advanceTopicStats()
+{
+    worker->post("topics.clock", [](DatabaseSession &session) {
+        if (!session.topics().advanceClock(QDateTime::currentSecsSinceEpoch())) {
+            qWarning() << "Failed to update overdue counts:" << session.topics().lastError();
         }
-    }
-    if (ui->listWidgetTopic->count() > 0 && !ui->listWidgetTopic->currentItem()) {
-        ui->listWidgetTopic->setCurrentRow(0);
-    }
+        return session.topics().summaries();
+    }, this, [this](const QVector<TopicSummary> &topics) {
+        topicIndex->updateCounters(topics);
+        if (topicDashboard->isVisible()) topicDashboard->setSummaries(topics);
+    });
 }
 
-void MainWindow::loadTasks(const QString &topic)
+void MainWindow::addTopicItem(const QString &topic, int topicId)
 {
-    ui->listWidgetTask->blockSignals(true);
-    ui->listWidgetTask->clear();
-    ui->textEditDescriptionDisplay->clear();
-    if (topic.isEmpty()) {
-        ui->listWidgetTask->blockSignals(false);
-        return;
+    TopicSummary summary;
+    summary.id = topicId;
+    summary.name = topic;
+    topicIndex->insert(summary);
+    if (!ui->listViewTopic->currentIndex().isValid()) selectTopic(topic);
+}
+
+void MainWindow::selectTopic(const QString &topic)
+{
+    int row = topicModel->rowForName(topic);
+    if (row < 0 && !topicModel->prefix().isEmpty()) {
+        ui->lineEditTopicFilter->clear();
+        row = topicModel->rowForName(topic);
     }
-    QSqlQuery query;
-    query.prepare("SELECT t.id, t.name, t.done FROM tasks t JOIN topics tp ON t.topic_id = tp.id WHERE tp.name = :topic");
-    query.bindValue(":topic", topic);
-    if (query.exec()) {
-        while (query.next()) {
-            QString taskName = query.value(1).toString();
-            bool done = query.value(2).toInt() == 1;
-            QListWidgetItem *item = new QListWidgetItem(taskName);
-            item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
-            item->setCheckState(done ? Qt::Checked : Qt::Unchecked);
-            item->setData(Qt::UserRole, query.value(0).toInt());
-            ui->listWidgetTask->addItem(item);
-        }
+    if (row >= 0) ui->listViewTopic->setCurrentIndex(topicModel->index(row));
+}
+
+void MainWindow::onTopicTasksLoaded()
+{
+    if (!firstTasksLoaded && !taskModel->topic().isEmpty()) {
+        firstTasksLoaded = true;
+        StartupProfiler::mark(QString("first task page (%1 rows)").arg(taskModel->rowCount()));
     }
-    ui->listWidgetTask->blockSignals(false);
-    if (ui->listWidgetTask->count() > 0) {
-        ui->listWidgetTask->setCurrentRow(0);
+    if (ui->listViewTask->model() != taskModel) return;
+    if (taskModel->rowCount() > 0) {
+        ui->listViewTask->setCurrentIndex(taskModel->index(0));
     }
+    updateTaskWindow();
+}
+
+void MainWindow::updateTaskWindow()
+{
+    QAbstractItemView *view = ui->listViewTask;
+    if (view->model() != taskModel || taskModel->rowCount() == 0) return;
+    QModelIndex top = view->indexAt(QPoint(0, 0));
+    QModelIndex bottom = view->indexAt(QPoint(0, view->viewport()->height() - 1));
+    int first = top.isValid() ? top.row() : 0;
+    int last = bottom.isValid() ? bottom.row() : taskModel->rowCount() - 1;
+    taskModel->setVisibleRange(first, last);
 }
 
 void MainWindow::on_pushButtonAddTopic_clicked()
 {
     QString topic = QInputDialog::getText(this, "New Topic", "Enter topic name:");
     if (topic.isEmpty()) return;
-    QSqlQuery query;
-    query.prepare("INSERT OR IGNORE INTO topics (name) VALUES (:name)");
-    query.bindValue(":name", topic);
-    if (query.exec()) {
-        loadTopics();
-        if (ui->listWidgetTopic->count() > 0 && !ui->listWidgetTopic->currentItem()) {
-            ui->listWidgetTopic->setCurrentRow(0);
+    worker->post(QString(), [topic](DatabaseSession &session) {
+        int topicId = session.topics().insert(topic);
+        return writeResult(topicId >= 0, "Failed to add topic: " + session.topics().lastError(), topicId);
+    }, this, [this, topic](const WriteResult &result) {
+        if (result.ok) {
+            addTopicItem(topic, result.id);
+        } else {
+            QMessageBox::warning(this, "Error", result.error);
         }
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to add topic: " + query.lastError().text());
-    }
+    });
 }
 
 void MainWindow::on_pushButtonDeleteTopic_clicked()
 {
-    QListWidgetItem *currentTopic = ui->listWidgetTopic->currentItem();
-    if (!currentTopic) {
+    QString topicName = selectedTopic();
+    if (topicName.isEmpty()) {
         QMessageBox::warning(this, "Warning", "Select a topic to delete");
         return;
     }
-    QString topicName = currentTopic->text();
     QMessageBox::StandardButton confirm = QMessageBox::question(this, "Confirm Delete",
                                                                 "Delete topic '" + topicName + "' and all its tasks?",
                                                                 QMessageBox::Yes | QMessageBox::No);
-    if (confirm == QMessageBox::Yes) {
-        QSqlDatabase::database().transaction();
-        QSqlQuery deleteTasksQuery;
-        deleteTasksQuery.prepare("DELETE FROM tasks WHERE topic_id = (SELECT id FROM topics WHERE name = :topic)");
-        deleteTasksQuery.bindValue(":topic", topicName);
-        QSqlQuery deleteTopicQuery;
-        deleteTopicQuery.prepare("DELETE FROM topics WHERE name = :topic");
-        deleteTopicQuery.bindValue(":topic", topicName);
-        if (deleteTasksQuery.exec() && deleteTopicQuery.exec()) {
-            QSqlDatabase::database().commit();
-            loadTopics();
-            if (ui->listWidgetTopic->count() > 0) {
-                ui->listWidgetTopic->setCurrentRow(0);
-            } else {
-                ui->listWidgetTask->clear();
-            }
+    if (confirm != QMessageBox::Yes) return;
+    topicDeleter->remove(topicName);
+}
+
+void MainWindow::onTopicHidden(const QString &topicName, bool ok, const QString &error)
+{
+    if (!ok) {
+        QMessageBox::critical(this, "Error", "Deletion failed: " + error);
+        return;
+    }
+    topicIndex->remove(topicName);
+    if (taskModel->topic() == topicName) loadTasks(selectedTopic());
+    allTasksModel->removeTopic(topicName);
+    if (ui->listViewTask->model() == searchModel) searchModel->refresh();
+    dueScheduler->reload();
+}
+
+void MainWindow::onTopicDeletionProgress(const QString &topicName, qint64 removed, qint64 total)
+{
+    QString message = QString("Deleting topic '%1': %2 of %3 tasks").arg(topicName).arg(removed).arg(total);
+    ui->statusbar->showMessage(message);
+    // Removed tasks cannot be brought back, so only a deletion that has not
+    // started removing them can be cancelled.
+    cancelDeletionButton->setVisible(removed == 0 && total > 0);
+}
+
+void MainWindow::onTopicDeletionFinished(const QString &topicName, bool cancelled)
+{
+    cancelDeletionButton->setVisible(topicDeleter->isBusy());
+    if (cancelled) {
+        ui->statusbar->showMessage("Deletion of topic '" + topicName + "' was cancelled", 5000);
+        loadTopics();
+        dueScheduler->reload();
+        if (ui->listViewTask->model() == searchModel) searchModel->refresh();
+        if (allTasksModel->isLoaded()) allTasksModel->reload();
+    } else {
+        ui->statusbar->showMessage("Deleted topic '" + topicName + "'", 5000);
+    }
+}
+
+// The monitor sends the whole topic list; entries are matched to the index
+// by id to find the ones another process added, renamed or removed.
+void MainWindow::onTopicsChangedExternally(const QVector<TopicRecord> &topics)
+{
+    QHash<int, QString> names;
+    for (const TopicRecord &topic : topics) names.insert(topic.id, topic.name);
+    QStringList removed;
+    QVector<std::pair<QString, QString>> renamed;
+    for (int position = 0; position < topicIndex->size(); ++position) {
+        const TopicSummary &topic = topicIndex->at(position);
+        auto found = names.find(topic.id);
+        if (found == names.end()) {
+            removed.append(topic.name);
+            continue;
+        }
+        if (found.value() != topic.name) renamed.append({topic.name, found.value()});
+        names.erase(found);
+    }
+    for (const QString &name : std::as_const(removed)) {
+        topicIndex->remove(name);
+        allTasksModel->removeTopic(name);
+        if (taskModel->topic() == name) loadTasks(selectedTopic());
+    }
+    bool consistent = true;
+    for (const auto &rename : std::as_const(renamed)) {
+        if (taskModel->topic() == rename.first) taskModel->renameTopic(rename.second);
+        searchModel->renameTopic(rename.first, rename.second);
+        allTasksModel->renameTopic(rename.first, rename.second);
+        consistent = topicIndex->rename(rename.first, rename.second) && consistent;
+    }
+    for (const TopicRecord &topic : topics) {
+        if (!names.contains(topic.id)) continue;
+        addTopicItem(topic.name, topic.id);
+    }
+    if (!removed.isEmpty() && ui->listViewTask->model() == searchModel) searchModel->refresh();
+    // Names swapped between topics cannot be renamed one at a time.
+    if (!consistent) {
+        loadTopics();
+        return;
+    }
+    refreshTopicStats();
+}
+
+void MainWindow::onTasksChangedExternally(const QVector<int> &taskIds, const QVector<TaskBrief> &tasks)
+{
+    QVector<TaskBrief> current = tasks;
+    QSet<int> present;
+    for (TaskBrief &task : current) {
+        present.insert(task.id);
+        // Toggles not yet written back win over what is on disk.
+        auto pending = pendingToggles.constFind(task.id);
+        if (pending != pendingToggles.constEnd()) task.done = pending.value();
+        if (taskModel->topic() == task.topicName) {
+            taskModel->insertTask(task.id, task.name, task.done);
         } else {
-            QSqlDatabase::database().rollback();
-            QMessageBox::critical(this, "Error", "Deletion failed: " + deleteTopicQuery.lastError().text());
+            taskModel->removeTask(task.id);
         }
+        searchModel->updateTask(task.id, task.name, task.topicName);
+        searchModel->setTaskDone(task.id, task.done);
+        descriptionCache->invalidate(task.id);
     }
+    for (int taskId : taskIds) {
+        if (present.contains(taskId)) continue;
+        taskModel->removeTask(taskId);
+        searchModel->removeTask(taskId);
+        descriptionCache->invalidate(taskId);
+    }
+    allTasksModel->updateTasks(taskIds, current);
+    dueScheduler->reload();
+    refreshTopicStats();
+    QModelIndex currentTask = ui->listViewTask->currentIndex();
+    if (currentTask.isValid() && taskIds.contains(currentTask.data(TaskListModel::TaskIdRole).toInt())) onTaskSelected();
+}
+
+// Used when another process changed more than can be patched row by row.
+void MainWindow::reloadAll()
+{
+    descriptionCache->clear();
+    dueScheduler->reload();
+    loadTopics();
+    reloadTaskViews();
 }
 
 void MainWindow::on_pushButtonAddTask_clicked()
 {
-    QStringList topics;
-    for (int i = 0; i < ui->listWidgetTopic->count(); ++i) {
-        topics << ui->listWidgetTopic->item(i)->text();
+    if (topicIndex->size() > 0) {
+        openNewTaskDialog();
+        return;
     }
-    if (topics.isEmpty()) {
-        QSqlQuery insertTopicQuery;
-        insertTopicQuery.prepare("INSERT INTO topics (name) VALUES (:name)");
-        insertTopicQuery.bindValue(":name", "Default");
-        if (!insertTopicQuery.exec()) {
-            QMessageBox::warning(this, "Error", "Failed to add default topic: " + insertTopicQuery.lastError().text());
+    worker->post(QString(), [](DatabaseSession &session) {
+        int topicId = session.topics().insert("Default");
+        return writeResult(topicId >= 0, "Failed to add default topic: " + session.topics().lastError(), topicId);
+    }, this, [this](const WriteResult &result) {
+        if (!result.ok) {
+            QMessageBox::warning(this, "Error", result.error);
             return;
         }
-        topics << "Default";
-        loadTopics();
-    }
-    TaskDialog dialog(topics, this);
+        addTopicItem("Default", result.id);
+        openNewTaskDialog();
+    });
+}
+
+void MainWindow::openNewTaskDialog()
+{
+    TaskDialog dialog(topicIndex, this);
     if (dialog.exec() != QDialog::Accepted) return;
-    QSqlQuery topicQuery;
-    topicQuery.prepare("SELECT id FROM topics WHERE name = :name");
-    topicQuery.bindValue(":name", dialog.topic());
-    if (!topicQuery.exec() || !topicQuery.next()) {
-        QMessageBox::warning(this, "Error", "Selected topic not found in database.");
-        return;
-    }
-    int topicId = topicQuery.value(0).toInt();
-    QString description = dialog.description();
-    QSqlQuery query;
-    query.prepare("INSERT INTO tasks (topic_id, name, description, due_date, notify, notified, done) "
-                  "VALUES (?, ?, ?, ?, ?, ?, ?)");
-    query.addBindValue(topicId);
-    query.addBindValue(dialog.taskName());
-    query.addBindValue(description);
-    query.addBindValue(dialog.dueDate().toString(Qt::ISODate));
-    query.addBindValue(dialog.notifyEnabled() ? 1 : 0);
-    query.addBindValue(0);
-    query.addBindValue(0);
-    if (query.exec()) {
-        loadTasks(dialog.topic());
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to add task: " + query.lastError().text());
-    }
+    TaskRecord task;
+    task.topicName = dialog.topic();
+    task.name = dialog.taskName();
+    task.description = dialog.description();
+    task.dueDate = dialog.dueDate();
+    task.notify = dialog.notifyEnabled();
+    task.recurrence = dialog.recurrence();
+    worker->post(QString(), [task](DatabaseSession &session) {
+        TaskRecord record = task;
+        record.topicId = session.topics().idForName(record.topicName);
+        if (record.topicId < 0) {
+            return writeResult(false, "Selected topic not found in database.");
+        }
+        int taskId = session.tasks().insert(record);
+        return writeResult(taskId >= 0, "Failed to add task: " + session.tasks().lastError(), taskId);
+    }, this, [this, task](const WriteResult &result) {
+        if (!result.ok) {
+            QMessageBox::warning(this, "Error", result.error);
+            return;
+        }
+        scheduleTask(result.id, task);
+        refreshTopicStats();
+        allTasksModel->refreshTasks({result.id});
+        if (taskModel->topic() == task.topicName) {
+            taskModel->insertTask(result.id, task.name, false);
+        } else if (!allTasksAction->isChecked()) {
+            selectTopic(task.topicName);
+        }
+        if (ui->listViewTask->model() == searchModel) searchModel->refresh();
+    });
 }
 
 void MainWindow::on_pushButtonEditTask_clicked()
 {
-    QListWidgetItem *currentTask = ui->listWidgetTask->currentItem();
-    QListWidgetItem *currentTopic = ui->listWidgetTopic->currentItem();
-    if (!currentTask || !currentTopic) {
+    QModelIndex currentTask = ui->listViewTask->currentIndex();
+    if (!currentTask.isValid()) {
         QMessageBox::warning(this, "Warning", "Select a task to edit");
         return;
     }
-    QString oldTaskName = currentTask->text();
-    QString oldTopicName = currentTopic->text();
-    QSqlQuery query;
-    query.prepare("SELECT t.name, t.description, t.due_date, t.notify, t.done FROM tasks t "
-                  "JOIN topics tp ON t.topic_id = tp.id "
-                  "WHERE t.id = :task_id");
-    int taskId = currentTask->data(Qt::UserRole).toInt();
-    query.bindValue(":task_id", taskId);
-    if (!query.exec() || !query.next()) {
-        QMessageBox::warning(this, "Error", "Failed to load task details");
-        return;
-    }
-    QStringList topics;
-    for (int i = 0; i < ui->listWidgetTopic->count(); ++i)
-        topics << ui->listWidgetTopic->item(i)->text();
-    TaskDialog dialog(topics, this);
-    dialog.setTaskName(query.value(0).toString());
-    dialog.setDescription(query.value(1).toString());
-    dialog.setDueDate(QDateTime::fromString(query.value(2).toString(), Qt::ISODate));
-    dialog.setNotifyEnabled(query.value(3).toBool());
+    QString oldTopicName = currentTask.data(TaskListModel::TopicNameRole).toString();
+    int taskId = currentTask.data(TaskListModel::TaskIdRole).toInt();
+    flushToggles();
+    worker->post("task.details", [taskId](DatabaseSession &session) {
+        TaskRecord task;
+        session.tasks().find(taskId, task);
+        return task;
+    }, this, [this, oldTopicName](const TaskRecord &task) {
+        if (task.id < 0) {
+            QMessageBox::warning(this, "Error", "Failed to load task details");
+            return;
+        }
+        editTask(task, oldTopicName);
+    });
+}
+
+void MainWindow::editTask(const TaskRecord &original, const QString &oldTopicName)
+{
+    TaskDialog dialog(topicIndex, this);
+    dialog.setTaskName(original.name);
+    dialog.setDescription(original.description);
+    dialog.setDueDate(original.dueDate);
+    dialog.setNotifyEnabled(original.notify);
+    dialog.setRecurrence(original.recurrence);
     dialog.setTopic(oldTopicName);
     if (dialog.exec() != QDialog::Accepted) return;
-    QString newName = dialog.taskName();
-    QString newDescription = dialog.description();
-    QString newTopic = dialog.topic();
-    QDateTime newDueDate = dialog.dueDate();
-    bool newNotify = dialog.notifyEnabled();
-    QSqlQuery topicQuery;
-    topicQuery.prepare("SELECT id FROM topics WHERE name = :topic");
-    topicQuery.bindValue(":topic", newTopic);
-    if (!topicQuery.exec() || !topicQuery.next()) {
-        QMessageBox::warning(this, "Error", "Invalid topic selected");
-        return;
-    }
-    int newTopicId = topicQuery.value(0).toInt();
-    QSqlQuery updateQuery;
-    updateQuery.prepare("UPDATE tasks SET "
-                        "name = :name, "
-                        "topic_id = :topic_id, "
-                        "description = :description, "
-                        "due_date = :due_date, "
-                        "notify = :notify "
-                        "WHERE id = :task_id");
-    updateQuery.bindValue(":name", newName);
-    updateQuery.bindValue(":topic_id", newTopicId);
-    updateQuery.bindValue(":description", newDescription);
-    updateQuery.bindValue(":due_date", newDueDate.toString(Qt::ISODate));
-    updateQuery.bindValue(":notify", newNotify ? 1 : 0);
-    updateQuery.bindValue(":task_id", taskId);
-    if (updateQuery.exec()) {
-        if (newTopic == oldTopicName) {
-            loadTasks(oldTopicName);
+    TaskRecord task = original;
+    task.name = dialog.taskName();
+    task.description = dialog.description();
+    task.topicName = dialog.topic();
+    task.dueDate = dialog.dueDate();
+    task.notify = dialog.notifyEnabled();
+    task.recurrence = dialog.recurrence();
+    worker->post(QString(), [task](DatabaseSession &session) {
+        TaskRecord record = task;
+        record.topicId = session.topics().idForName(record.topicName);
+        if (record.topicId < 0) {
+            return writeResult(false, "Invalid topic selected");
+        }
+        bool ok = session.tasks().update(record);
+        return writeResult(ok, "Failed to update task: " + session.tasks().lastError(), task.id);
+    }, this, [this, task](const WriteResult &result) {
+        if (!result.ok) {
+            QMessageBox::warning(this, "Error", result.error);
+            return;
+        }
+        scheduleTask(task.id, task);
+        refreshTopicStats();
+        if (taskModel->topic() == task.topicName) {
+            // The edit does not touch done; keep whatever the list shows now.
+            int row = taskModel->rowForTask(task.id);
+            bool done = row < 0 ? task.done
+                                : taskModel->index(row).data(Qt::CheckStateRole).toInt() == Qt::Checked;
+            taskModel->insertTask(task.id, task.name, done);
         } else {
-            loadTopics();
-            loadTasks(newTopic);
+            taskModel->removeTask(task.id);
         }
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to update task: " + updateQuery.lastError().text());
-    }
+        searchModel->updateTask(task.id, task.name, task.topicName);
+        allTasksModel->refreshTasks({task.id});
+        descriptionCache->store(task.id, task.description);
+        onTaskSelected();
+    });
 }
 
 void MainWindow::on_pushButtonDeleteTask_clicked()
 {
-    QListWidgetItem *currentTask = ui->listWidgetTask->currentItem();
-    QListWidgetItem *currentTopic = ui->listWidgetTopic->currentItem();
-    if (!currentTask || !currentTopic) return;
-    QString taskName = currentTask->text();
-    QString topicName = currentTopic->text();
+    QVector<int> taskIds = selectedTaskIds();
+    if (taskIds.size() > 1) {
+        deleteSelectedTasks(taskIds);
+        return;
+    }
+    QModelIndex currentTask = ui->listViewTask->currentIndex();
+    if (!currentTask.isValid()) return;
+    QString taskName = currentTask.data().toString();
+    QString topicName = currentTask.data(TaskListModel::TopicNameRole).toString();
     QMessageBox::StandardButton confirm = QMessageBox::question(this, "Confirm Delete",
                                                                 "Delete task '" + taskName + "' from topic '" + topicName + "'?",
                                                                 QMessageBox::Yes | QMessageBox::No);
     if (confirm != QMessageBox::Yes) return;
-    QSqlQuery query;
-    query.prepare("DELETE FROM tasks WHERE id = :task_id");
-    int taskId = currentTask->data(Qt::UserRole).toInt();
-    query.bindValue(":task_id", taskId);
-    if (query.exec()) {
-        loadTasks(topicName);
-        if (ui->listWidgetTask->count() > 0) {
-            ui->listWidgetTask->setCurrentRow(0);
+    int taskId = currentTask.data(TaskListModel::TaskIdRole).toInt();
+    flushToggles();
+    worker->post(QString(), [taskId](DatabaseSession &session) {
+        bool ok = session.tasks().remove(taskId);
+        return writeResult(ok, "Failed to delete task: " + session.tasks().lastError(), taskId);
+    }, this, [this, taskId](const WriteResult &result) {
+        if (!result.ok) {
+            QMessageBox::warning(this, "Error", result.error);
+            return;
         }
-    } else {
-        QMessageBox::warning(this, "Error", "Failed to delete task: " + query.lastError().text());
-    }
+        dueScheduler->unscheduleTask(taskId);
+        taskModel->removeTask(taskId);
+        searchModel->removeTask(taskId);
+        allTasksModel->removeTask(taskId);
+        descriptionCache->invalidate(taskId);
+        refreshTopicStats();
+    });
 }
 
 void MainWindow::on_pushButtonEditTopic_clicked()
 {
-    QListWidgetItem *currentItem = ui->listWidgetTopic->currentItem();
-    if (!currentItem) {
+    QString currentName = selectedTopic();
+    if (currentName.isEmpty()) {
         QMessageBox::warning(this, "Warning", "Select a topic to edit");
         return;
     }
-    QString currentName = currentItem->text();
     bool ok;
     QString newName = QInputDialog::getText(this, "Edit Topic", "Enter new topic name:", QLineEdit::Normal, currentName, &ok);
     if (!ok || newName.isEmpty() || newName == currentName) {
         return;
     }
-    QSqlQuery query;
-    query.prepare("UPDATE topics SET name = :newName WHERE name = :currentName");
-    query.bindValue(":newName", newName);
-    query.bindValue(":currentName", currentName);
-    if (query.exec()) {
-        loadTopics();
-        QList<QListWidgetItem*> items = ui->listWidgetTopic->findItems(newName, Qt::MatchExactly);
-        if (!items.isEmpty()) {
-            ui->listWidgetTopic->setCurrentItem(items.first());
+    worker->post(QString(), [currentName, newName](DatabaseSession &session) {
+        if (session.topics().rename(currentName, newName)) {
+            return writeResult(true, QString());
         }
-    } else {
-        if (query.lastError().text().contains("UNIQUE constraint failed")) {
-            QMessageBox::warning(this, "Error", "Topic name already exists.");
+        QString error = session.topics().lastError();
+        if (error.contains("UNIQUE constraint failed")) {
+            return writeResult(false, "Topic name already exists.");
+        }
+        return writeResult(false, "Failed to update topic: " + error);
+    }, this, [this, currentName, newName](const WriteResult &result) {
+        if (result.ok) {
+            if (taskModel->topic() == currentName) taskModel->renameTopic(newName);
+            searchModel->renameTopic(currentName, newName);
+            allTasksModel->renameTopic(currentName, newName);
+            topicIndex->rename(currentName, newName);
         } else {
-            QMessageBox::warning(this, "Error", "Failed to update topic: " + query.lastError().text());
+            QMessageBox::warning(this, "Error", result.error);
         }
-    }
+    });
 }
 
 void MainWindow::onTaskSelected()
 {
-    QListWidgetItem *currentTask = ui->listWidgetTask->currentItem();
-    QListWidgetItem *currentTopic = ui->listWidgetTopic->currentItem();
-    if (!currentTask || !currentTopic) {
-        ui->textEditDescriptionDisplay->clear();
+    QModelIndex currentTask = ui->listViewTask->currentIndex();
+    if (!currentTask.isValid()) {
+        worker->cancel("description");
+        showDescription(QString());
         return;
     }
-    QString taskName = currentTask->text();
-    QString topicName = currentTopic->text();
-    int taskId = currentTask->data(Qt::UserRole).toInt();
-    QSqlQuery query;
-    query.prepare("SELECT t.description FROM tasks t "
-                  "JOIN topics tp ON t.topic_id = tp.id "
-                  "WHERE t.id = :task_id AND tp.name = :topic");
-    query.bindValue(":task_id", taskId);
-    query.bindValue(":topic", topicName);
-    if (query.exec() && query.next()) {
-        ui->textEditDescriptionDisplay->setPlainText(query.value(0).toString());
+    int taskId = currentTask.data(TaskListModel::TaskIdRole).toInt();
+    QString description;
+    if (descriptionCache->lookup(taskId, description)) {
+        worker->cancel("description");
+        showDescription(description);
+    } else {
+        showDescription(QString());
+        descriptionCache->request(taskId);
+    }
+    QAbstractItemModel *model = ui->listViewTask->model();
+    QVector<int> neighbours;
+    int first = qMax(0, currentTask.row() - PrefetchRadius);
+    int last = qMin(model->rowCount() - 1, currentTask.row() + PrefetchRadius);
+    for (int row = first; row <= last; ++row) {
+        if (row != currentTask.row()) neighbours.append(model->index(row, 0).data(TaskListModel::TaskIdRole).toInt());
+    }
+    descriptionCache->prefetch(neighbours);
+}
+
+void MainWindow::onDescriptionReady(int taskId, const QString &description)
+{
+    QModelIndex currentTask = ui->listViewTask->currentIndex();
+    if (currentTask.isValid() && currentTask.data(TaskListModel::TaskIdRole).toInt() == taskId) {
+        showDescription(description);
+    }
+}
+
+void MainWindow::showDescription(const QString &description)
+{
+    descriptionTimer->stop();
+    pendingDescription = description;
+    descriptionOffset = 0;
+    ui->textEditDescriptionDisplay->clear();
+    appendDescriptionChunk();
+    if (descriptionOffset < pendingDescription.size()) descriptionTimer->start();
+}
+
+void MainWindow::appendDescriptionChunk()
+{
+    int length = qMin(DescriptionChunk, pendingDescription.size() - descriptionOffset);
+    if (length < pendingDescription.size() - descriptionOffset
+        && pendingDescription.at(descriptionOffset + length - 1).isHighSurrogate()) {
+        ++length;
+    }
+    if (length > 0) {
+        QTextCursor cursor(ui->textEditDescriptionDisplay->document());
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(pendingDescription.mid(descriptionOffset, length));
+        descriptionOffset += length;
+    }
+    if (descriptionOffset >= pendingDescription.size()) {
+        descriptionTimer->stop();
+        pendingDescription.clear();
+        descriptionOffset = 0;
+    }
+}
+
+void MainWindow::onTaskItemChanged(int taskId, bool done)
+{
+    taskModel->setTaskDone(taskId, done);
+    searchModel->setTaskDone(taskId, done);
+    allTasksModel->setTaskDone(taskId, done);
+    pendingToggles.insert(taskId, done);
+    if (!toggleTimer->isActive()) toggleTimer->start();
+}
+
+void MainWindow::flushToggles()
+{
+    toggleTimer->stop();
+    if (pendingToggles.isEmpty()) return;
+    QVector<int> doneIds;
+    QVector<int> openIds;
+    for (auto it = pendingToggles.cbegin(); it != pendingToggles.cend(); ++it) {
+        (it.value() ? doneIds : openIds).append(it.key());
+    }
+    pendingToggles.clear();
+    auto advanced = std::make_shared<QVector<int>>();
+    postTransaction([doneIds, openIds, advanced](DatabaseSession &session) {
+        if (!doneIds.isEmpty() && !session.tasks().setDone(doneIds, true)) return false;
+        *advanced = session.tasks().advancedSeries();
+        return openIds.isEmpty() || session.tasks().setDone(openIds, false);
+    }, "Failed to update task status", [this, advanced] { reopenSeries(*advanced); });
+}
+
+void MainWindow::scheduleTask(int taskId, const TaskRecord &task)
+{
+    // The next occurrence of a series is only known to the repository.
+    if (task.recurrence.isEmpty()) {
+        dueScheduler->scheduleTask(taskId, task.dueDate.toSecsSinceEpoch(), task.notify);
     } else {
-        ui->textEditDescriptionDisplay->clear();
+        dueScheduler->reload();
     }
 }
 
-void MainWindow::onTaskItemChanged(QListWidgetItem *item)
+// Completing or skipping an occurrence leaves the series open for the next one.
+void MainWindow::reopenSeries(const QVector<int> &taskIds)
 {
-    if (!item) return;
-    Qt::CheckState state = item->checkState();
-    int done = (state == Qt::Checked) ? 1 : 0;
-    int taskId = item->data(Qt::UserRole).toInt();
-    QSqlQuery updateQuery;
-    updateQuery.prepare("UPDATE tasks SET done = :done WHERE id = :task_id");
-    updateQuery.bindValue(":done", done);
-    updateQuery.bindValue(":task_id", taskId);
-    if (!updateQuery.exec()) {
-        QMessageBox::warning(this, "Error", "Failed to update task status: " + updateQuery.lastError().text());
+    if (taskIds.isEmpty()) return;
+    for (int taskId : taskIds) {
+        taskModel->setTaskDone(taskId, false);
+        searchModel->setTaskDone(taskId, false);
     }
+    // The series moved on to its next occurrence, so its due date changed too.
+    allTasksModel->refreshTasks(taskIds);
+    dueScheduler->reload();
+}
+
+QVector<int> MainWindow::selectedTaskIds() const
+{
+    QVector<int> taskIds;
+    const QModelIndexList indexes = ui->listViewTask->selectionModel()->selectedIndexes();
+    for (const QModelIndex &index : indexes) taskIds.append(index.data(TaskListModel::TaskIdRole).toInt());
+    std::sort(taskIds.begin(), taskIds.end());
+    return taskIds;
+}
+
+void MainWindow::postTransaction(const std::function<bool(DatabaseSession &)> &operation, const QString &errorText,
+                                 const std::function<void()> &applied)
+{
+    worker->post(QString(), [operation, errorText](DatabaseSession &session) {
+        QSqlDatabase db = session.database();
+        db.transaction();
+        if (operation(session) && db.commit()) return writeResult(true, QString());
+        QString error = session.tasks().lastError().isEmpty() ? db.lastError().text() : session.tasks().lastError();
+        db.rollback();
+        return writeResult(false, errorText + ": " + error);
+    }, this, [this, applied](const WriteResult &result) {
+        if (!result.ok) {
+            QMessageBox::warning(this, "Error", result.error);
+            return;
+        }
+        applied();
+        refreshTopicStats();
+    });
+}
+
+void MainWindow::onTaskContextMenu(const QPoint &pos)
+{
+    if (selectedTaskIds().isEmpty()) return;
+    QMenu menu(this);
+    menu.addAction("Mark Done", this, [this] { markSelectedTasks(true); });
+    menu.addAction("Mark Not Done", this, [this] { markSelectedTasks(false); });
+    menu.addAction("Skip Occurrence", this, &MainWindow::skipSelectedOccurrences);
+    menu.addAction("Move to Topic...", this, &MainWindow::moveSelectedTasks);
+    menu.addAction("Reschedule...", this, &MainWindow::rescheduleSelectedTasks);
+    menu.addSeparator();
+    menu.addAction("Delete", this, &MainWindow::on_pushButtonDeleteTask_clicked);
+    menu.exec(ui->listViewTask->viewport()->mapToGlobal(pos));
+}
+
+void MainWindow::markSelectedTasks(bool done)
+{
+    QVector<int> taskIds = selectedTaskIds();
+    if (taskIds.isEmpty()) return;
+    flushToggles();
+    auto advanced = std::make_shared<QVector<int>>();
+    postTransaction([taskIds, done, advanced](DatabaseSession &session) {
+        if (!session.tasks().setDone(taskIds, done)) return false;
+        *advanced = session.tasks().advancedSeries();
+        return true;
+    }, "Failed to update task status", [this, taskIds, done, advanced] {
+        for (int taskId : taskIds) {
+            taskModel->setTaskDone(taskId, done);
+            searchModel->setTaskDone(taskId, done);
+            allTasksModel->setTaskDone(taskId, done);
+        }
+        reopenSeries(*advanced);
+    });
+}
+
+void MainWindow::skipSelectedOccurrences()
+{
+    QVector<int> taskIds = selectedTaskIds();
+    if (taskIds.isEmpty()) return;
+    flushToggles();
+    auto advanced = std::make_shared<QVector<int>>();
+    postTransaction([taskIds, advanced](DatabaseSession &session) {
+        if (!session.tasks().skipOccurrence(taskIds)) return false;
+        *advanced = session.tasks().advancedSeries();
+        return true;
+    }, "Failed to skip occurrences", [this, advanced] {
+        if (advanced->isEmpty()) {
+            ui->statusbar->showMessage("Only recurring tasks have occurrences to skip", 5000);
+            return;
+        }
+        reopenSeries(*advanced);
+    });
+}
+
+void MainWindow::deleteSelectedTasks(const QVector<int> &taskIds)
+{
+    QMessageBox::StandardButton confirm = QMessageBox::question(this, "Confirm Delete",
+                                                                QString("Delete %1 selected tasks?").arg(taskIds.size()),
+                                                                QMessageBox::Yes | QMessageBox::No);
+    if (confirm != QMessageBox::Yes) return;
+    flushToggles();
+    postTransaction([taskIds](DatabaseSession &session) {
+        return session.tasks().remove(taskIds);
+    }, "Failed to delete tasks", [this, taskIds] {
+        for (int taskId : taskIds) {
+            dueScheduler->unscheduleTask(taskId);
+            taskModel->removeTask(taskId);
+            searchModel->removeTask(taskId);
+            allTasksModel->removeTask(taskId);
+            descriptionCache->invalidate(taskId);
+        }
+    });
+}
+
+void MainWindow::moveSelectedTasks()
+{
+    QVector<int> taskIds = selectedTaskIds();
+    if (taskIds.isEmpty()) return;
+    bool ok;
+    QString topic = QInputDialog::getItem(this, "Move Tasks", QString("Move %1 tasks to topic:").arg(taskIds.size()),
+                                          topicIndex->names(), qMax(0, topicIndex->find(taskModel->topic())), false, &ok);
+    if (!ok || topic.isEmpty()) return;
+    flushToggles();
+    postTransaction([taskIds, topic](DatabaseSession &session) {
+        int topicId = session.topics().idForName(topic);
+        return topicId >= 0 && session.tasks().moveToTopic(taskIds, topicId);
+    }, "Failed to move tasks", [this, taskIds, topic] {
+        allTasksModel->refreshTasks(taskIds);
+        if (taskModel->topic() == topic) {
+            reloadTaskViews();
+            return;
+        }
+        for (int taskId : taskIds) taskModel->removeTask(taskId);
+        if (ui->listViewTask->model() == searchModel) searchModel->refresh();
+    });
+}
+
+void MainWindow::rescheduleSelectedTasks()
+{
+    QVector<int> taskIds = selectedTaskIds();
+    if (taskIds.isEmpty()) return;
+    QDialog dialog(this);
+    dialog.setWindowTitle(QString("Reschedule %1 Tasks").arg(taskIds.size()));
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    QDateTimeEdit *dueEdit = new QDateTimeEdit(QDateTime::currentDateTime().addDays(1), &dialog);
+    dueEdit->setCalendarPopup(true);
+    layout->addWidget(dueEdit);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons);
+    if (dialog.exec() != QDialog::Accepted) return;
+    QDateTime dueDate = dueEdit->dateTime();
+    flushToggles();
+    postTransaction([taskIds, dueDate](DatabaseSession &session) {
+        return session.tasks().reschedule(taskIds, dueDate);
+    }, "Failed to reschedule tasks", [this, taskIds] {
+        allTasksModel->refreshTasks(taskIds);
+        dueScheduler->reload();
+    });
 }
 
 void MainWindow::checkDueTasks()
 {
-    QDateTime currentTime = QDateTime::currentDateTime();
-    QSqlQuery query;
-    query.prepare("SELECT t.id, t.name, tp.name, t.due_date FROM tasks t "
-                  "JOIN topics tp ON t.topic_id = tp.id "
-                  "WHERE t.notify = 1 AND t.notified = 0 AND datetime(t.due_date) <= datetime(?)");
-    query.bindValue(0, currentTime.toString(Qt::ISODate));
-    if (query.exec()) {
-        while (query.next()) {
-            int taskId = query.value(0).toInt();
-            QString taskName = query.value(1).toString();
-            QString topicName = query.value(2).toString();
-            QDateTime dueDate = QDateTime::fromString(query.value(3).toString(), Qt::ISODate);
-            showNotification(
-                tr("Task Due: %1").arg(taskName),
-                tr("Task '%1' in topic '%2' is due!\nDue time: %3")
-                    .arg(taskName)
-                    .arg(topicName)
-                    .arg(dueDate.toString("dd.MM.yyyy HH:mm"))
-                );
-            QSqlQuery updateQuery;
-            updateQuery.prepare("UPDATE tasks SET notified = 1 WHERE id = :task_id");
-            updateQuery.bindValue(":task_id", taskId);
-            updateQuery.exec();
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    worker->post(QString(), [now](DatabaseSession &session) {
+        QSqlDatabase db = session.database();
+        db.transaction();
+        QVector<TaskRecord> dueTasks = session.tasks().dueTasks(now);
+        if (dueTasks.isEmpty() || session.tasks().markDueNotified(now)) {
+            db.commit();
+        } else {
+            db.rollback();
+            dueTasks.clear();
         }
-    }
+        return dueTasks;
+    }, this, [this](const QVector<TaskRecord> &dueTasks) {
+        notificationQueue->enqueue(dueTasks);
+        dueScheduler->reload();
+        refreshTopicStats();
+    });
 }
 
 void MainWindow::showNotification(const QString &title, const QString &message)
 {
-    if (QSystemTrayIcon::supportsMessages()) {
+    if (trayIcon && QSystemTrayIcon::supportsMessages()) {
         trayIcon->showMessage(title, message, QSystemTrayIcon::Information, 10000);
     }
-    else {
-        QMessageBox::information(this, title, message);
+    else if (notificationBox) {
+        notificationBox->setWindowTitle(title);
+        notificationBox->setText(message);
+    } else {
+        notificationBox = new QMessageBox(QMessageBox::Information, title, message, QMessageBox::Ok, this);
+        notificationBox->setAttribute(Qt::WA_DeleteOnClose);
+        notificationBox->setModal(false);
+        notificationBox->show();
+    }
+}
+
+void MainWindow::on_actionImport_triggered()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Import Tasks", QString(),
+                                                    "Task files (*.csv *.jsonl *.json);;All files (*)");
+    if (fileName.isEmpty()) return;
+    ui->actionImport->setEnabled(false);
+    QPointer<MainWindow> window(this);
+    worker->post(QString(), [fileName, window](DatabaseSession &session) {
+        TaskTransfer transfer(session);
+        transfer.setProgressCallback([window](const TransferProgress &progress) {
+            if (!window) return;
+            QMetaObject::invokeMethod(window.data(), [window, progress]() {
+                if (window) window->showTransferProgress("Imported", progress);
+            }, Qt::QueuedConnection);
+        });
+        return transfer.importFile(fileName, TaskTransfer::formatForFile(fileName));
+    }, this, [this](const TransferProgress &progress) {
+        ui->actionImport->setEnabled(true);
+        if (!progress.ok) {
+            QMessageBox::warning(this, "Import Failed", progress.error + QString("\n%1 rows were imported before the error.").arg(progress.rows));
+        }
+        dueScheduler->reload();
+        loadTopics();
+        reloadTaskViews();
+    });
+}
+
+void MainWindow::on_actionExport_triggered()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Tasks", "tasks.csv",
+                                                    "CSV files (*.csv);;JSON Lines (*.jsonl)");
+    if (fileName.isEmpty()) return;
+    ui->actionExport->setEnabled(false);
+    QPointer<MainWindow> window(this);
+    worker->post(QString(), [fileName, window](DatabaseSession &session) {
+        TaskTransfer transfer(session);
+        transfer.setProgressCallback([window](const TransferProgress &progress) {
+            if (!window) return;
+            QMetaObject::invokeMethod(window.data(), [window, progress]() {
+                if (window) window->showTransferProgress("Exported", progress);
+            }, Qt::QueuedConnection);
+        });
+        return transfer.exportFile(fileName, TaskTransfer::formatForFile(fileName));
+    }, this, [this](const TransferProgress &progress) {
+        ui->actionExport->setEnabled(true);
+        if (!progress.ok) {
+            QMessageBox::warning(this, "Export Failed", progress.error);
+        }
+    });
+}
+
+void MainWindow::showTransferProgress(const QString &action, const TransferProgress &progress)
+{
+    QString message = QString("%1 %2 rows (%3 rows/s)").arg(action).arg(progress.rows)
+                          .arg(qRound64(progress.rowsPerSecond()));
+    if (!progress.finished && progress.totalBytes > 0) {
+        message += QString(", %1%").arg(progress.bytes * 100 / progress.totalBytes);
     }
+    ui->statusbar->showMessage(message, progress.finished ? 10000 : 0);
 }
 
 void MainWindow::on_actionExit_triggered()
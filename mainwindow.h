@@ -2,10 +2,41 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QSqlDatabase>
 #include <QSystemTrayIcon>
 #include <QTimer>
-#include <QListWidgetItem>
+#include <QDateTime>
+#include <QPointer>
+#include <QHash>
+#include <QVector>
+#include <functional>
+
+class TaskListModel;
+class DueTaskScheduler;
+class DatabaseWorker;
+class SearchResultModel;
+class DescriptionCache;
+class NotificationQueue;
+class PerformanceDock;
+class TopicDeleter;
+class TopicDashboard;
+class AllTasksModel;
+class TopicIndex;
+class TopicListModel;
+class ChangeMonitor;
+struct TopicSummary;
+class DatabaseSession;
+class QMessageBox;
+class QAbstractItemModel;
+class QModelIndex;
+class QPushButton;
+class QAction;
+class QComboBox;
+class QCheckBox;
+class QLabel;
+struct TransferProgress;
+struct TaskRecord;
+struct TaskBrief;
+struct TopicRecord;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -17,6 +48,8 @@ class MainWindow : public QMainWindow
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
+protected:
+    void paintEvent(QPaintEvent *event) override;
 private slots:
     void on_pushButtonAddTopic_clicked();
     void on_pushButtonAddTask_clicked();
@@ -25,16 +58,88 @@ private slots:
     void on_pushButtonEditTask_clicked();
     void on_pushButtonEditTopic_clicked();
     void onTaskSelected();
-    void onTaskItemChanged(QListWidgetItem *item);
+    void onTaskItemChanged(int taskId, bool done);
+    void onTopicTasksLoaded();
+    void onDatabaseOpened(bool ok, const QString &error);
+    void onSearchTextChanged(const QString &text);
+    void onDescriptionReady(int taskId, const QString &description);
+    void appendDescriptionChunk();
+    void onTaskContextMenu(const QPoint &pos);
+    void flushToggles();
+    void onTopicHidden(const QString &topicName, bool ok, const QString &error);
+    void onTopicDeletionProgress(const QString &topicName, qint64 removed, qint64 total);
+    void onTopicDeletionFinished(const QString &topicName, bool cancelled);
+    void on_actionImport_triggered();
+    void on_actionExport_triggered();
+    void updateTaskWindow();
     void on_actionExit_triggered();
 private:
     Ui::MainWindow *ui;
-    QSqlDatabase db;
-    QSystemTrayIcon* trayIcon;
-    QTimer* notificationTimer;
+    DatabaseWorker *worker;
+    TaskListModel *taskModel;
+    SearchResultModel *searchModel;
+    AllTasksModel *allTasksModel;
+    QAction *allTasksAction;
+    QWidget *allTasksBar;
+    QComboBox *allTasksSort;
+    QCheckBox *allTasksDescending;
+    QComboBox *allTasksState;
+    QComboBox *allTasksTopic;
+    QLabel *allTasksStatus;
+    DescriptionCache *descriptionCache;
+    QTimer *descriptionTimer;
+    QString pendingDescription;
+    int descriptionOffset = 0;
+    QSystemTrayIcon* trayIcon = nullptr;
+    DueTaskScheduler *dueScheduler;
+    NotificationQueue *notificationQueue;
+    PerformanceDock *performanceDock;
+    TopicDeleter *topicDeleter;
+    TopicDashboard *topicDashboard;
+    ChangeMonitor *changeMonitor;
+    TopicIndex *topicIndex;
+    TopicListModel *topicModel;
+    QTimer *statsTimer;
+    QPushButton *cancelDeletionButton;
+    QTimer *toggleTimer;
+    QHash<int, bool> pendingToggles;
+    bool firstFramePainted = false;
+    bool topicsLoaded = false;
+    bool firstTasksLoaded = false;
+    QPointer<QMessageBox> notificationBox;
     void setupDatabase();
-    void loadTopics();
+    void setupAllTasksView();
+    void showAllTasks(bool show);
+    void applyAllTasksFilter();
+    void updateAllTasksTopics();
+    void loadTopics(const QString &selectTopic = QString());
+    void refreshTopicStats();
+    void advanceTopicStats();
+    void onTopicsChangedExternally(const QVector<TopicRecord> &topics);
+    void onTasksChangedExternally(const QVector<int> &taskIds, const QVector<TaskBrief> &tasks);
+    void reloadAll();
+    QString selectedTopic() const;
+    void onTopicSelected(const QModelIndex &current);
+    void filterTopics(const QString &text);
     void loadTasks(const QString &topic);
+    void setTaskViewModel(QAbstractItemModel *model);
+    void reloadTaskViews();
+    void showDescription(const QString &description);
+    QVector<int> selectedTaskIds() const;
+    void postTransaction(const std::function<bool(DatabaseSession &)> &operation, const QString &errorText,
+                         const std::function<void()> &applied);
+    void markSelectedTasks(bool done);
+    void deleteSelectedTasks(const QVector<int> &taskIds);
+    void moveSelectedTasks();
+    void rescheduleSelectedTasks();
+    void skipSelectedOccurrences();
+    void scheduleTask(int taskId, const TaskRecord &task);
+    void reopenSeries(const QVector<int> &taskIds);
+    void addTopicItem(const QString &topic, int topicId);
+    void selectTopic(const QString &topic);
+    void showTransferProgress(const QString &action, const TransferProgress &progress);
+    void openNewTaskDialog();
+    void editTask(const TaskRecord &original, const QString &oldTopicName);
     void setupNotifications();
     void checkDueTasks();
     void showNotification(const QString &title, const QString &message);
@@ -0,0 +1,76 @@
+#include "notificationqueue.h"
+#include "taskrepository.h"
+#include <QTimer>
+#include <utility>
+
+namespace {
+const int MinIntervalMs = 3000;
+const int MaxNamesListed = 5;
+const int MaxQueuedSummaries = 5;
+}
+
+NotificationQueue::NotificationQueue(QObject *parent)
+    : QObject(parent), timer(new QTimer(this))
+{
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, this, &NotificationQueue::deliverNext);
+}
+
+void NotificationQueue::enqueue(const QVector<TaskRecord> &tasks)
+{
+    for (const TaskRecord &task : tasks) {
+        auto it = summaries.find(task.topicName);
+        if (it == summaries.end()) {
+            order << task.topicName;
+            it = summaries.insert(task.topicName, Summary());
+        }
+        Summary &summary = it.value();
+        if (summary.names.size() < MaxNamesListed) summary.names << task.name;
+        if (summary.count == 0 || task.dueDate < summary.earliest) summary.earliest = task.dueDate;
+        ++summary.count;
+    }
+    if (order.isEmpty() || timer->isActive()) return;
+    qint64 wait = lastDelivery.isValid() ? MinIntervalMs - lastDelivery.elapsed() : 0;
+    timer->start(int(qMax<qint64>(0, wait)));
+}
+
+void NotificationQueue::deliverNext()
+{
+    if (order.isEmpty()) return;
+    lastDelivery.start();
+    if (order.size() > MaxQueuedSummaries) {
+        deliverAll();
+        return;
+    }
+    QString topic = order.takeFirst();
+    Summary summary = summaries.take(topic);
+    if (summary.count == 1) {
+        emit notificationReady(tr("Task Due: %1").arg(summary.names.first()),
+                               tr("Task '%1' in topic '%2' is due!\nDue time: %3")
+                                   .arg(summary.names.first())
+                                   .arg(topic)
+                                   .arg(summary.earliest.toString("dd.MM.yyyy HH:mm")));
+    } else {
+        QString message = summary.names.join('\n');
+        if (summary.count > summary.names.size()) {
+            message += tr("\n...and %1 more").arg(summary.count - summary.names.size());
+        }
+        emit notificationReady(tr("%1 tasks due in '%2'").arg(summary.count).arg(topic), message);
+    }
+    if (!order.isEmpty()) timer->start(MinIntervalMs);
+}
+
+void NotificationQueue::deliverAll()
+{
+    int count = 0;
+    QStringList lines;
+    for (const QString &topic : std::as_const(order)) {
+        int topicCount = summaries.value(topic).count;
+        count += topicCount;
+        if (lines.size() < MaxNamesListed) lines << tr("%1: %2").arg(topic).arg(topicCount);
+    }
+    if (order.size() > lines.size()) lines << tr("...and %1 more topics").arg(order.size() - lines.size());
+    emit notificationReady(tr("%1 tasks due in %2 topics").arg(count).arg(order.size()), lines.join('\n'));
+    order.clear();
+    summaries.clear();
+}
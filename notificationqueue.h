@@ -0,0 +1,40 @@
+#ifndef NOTIFICATIONQUEUE_H
+#define NOTIFICATIONQUEUE_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+class QTimer;
+struct TaskRecord;
+
+// Merges due tasks into one summary per topic and hands them out no more
+// often than once per interval. A large backlog collapses into a single
+// summary instead of a flood of messages.
+class NotificationQueue : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NotificationQueue(QObject *parent = nullptr);
+    void enqueue(const QVector<TaskRecord> &tasks);
+signals:
+    void notificationReady(const QString &title, const QString &message);
+private slots:
+    void deliverNext();
+private:
+    struct Summary {
+        QStringList names;
+        int count = 0;
+        QDateTime earliest;
+    };
+    void deliverAll();
+    QStringList order;
+    QHash<QString, Summary> summaries;
+    QElapsedTimer lastDelivery;
+    QTimer *timer;
+};
+
+#endif // NOTIFICATIONQUEUE_H
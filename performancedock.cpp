@@ -0,0 +1,142 @@
+#include "performancedock.h"
+#include "querytrace.h"
+#include <QCheckBox>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QListWidget>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <algorithm>
+
+namespace {
+const int RefreshMs = 1000;
+
+QString formatNs(qint64 ns)
+{
+    return ns >= 1000000 ? QString::number(ns / 1000000.0, 'f', 1) + " ms"
+                         : QString::number(ns / 1000.0, 'f', 0) + " us";
+}
+}
+
+PerformanceDock::PerformanceDock(QWidget *parent)
+    : QDockWidget("Performance", parent), timer(new QTimer(this))
+{
+    setObjectName("performanceDock");
+    QWidget *content = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(content);
+
+    QHBoxLayout *controls = new QHBoxLayout();
+    enableBox = new QCheckBox("Trace queries", content);
+    enableBox->setChecked(QueryTrace::isEnabled());
+    thresholdBox = new QSpinBox(content);
+    thresholdBox->setRange(1, 60000);
+    thresholdBox->setSuffix(" ms");
+    thresholdBox->setPrefix("Slow above ");
+    thresholdBox->setValue(QueryTrace::instance().slowThresholdMs());
+    QPushButton *resetButton = new QPushButton("Reset", content);
+    QPushButton *exportButton = new QPushButton("Export Trace...", content);
+    controls->addWidget(enableBox);
+    controls->addWidget(thresholdBox);
+    controls->addStretch();
+    controls->addWidget(resetButton);
+    controls->addWidget(exportButton);
+    layout->addLayout(controls);
+
+    summaryLabel = new QLabel(content);
+    layout->addWidget(summaryLabel);
+
+    statsTable = new QTableWidget(0, 7, content);
+    statsTable->setHorizontalHeaderLabels({"Statement", "Calls", "Mean", "p50", "p95", "Max", "Rows"});
+    statsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    statsTable->verticalHeader()->hide();
+    statsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    statsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    layout->addWidget(statsTable, 3);
+
+    layout->addWidget(new QLabel("Slow queries", content));
+    slowList = new QListWidget(content);
+    layout->addWidget(slowList, 1);
+    setWidget(content);
+
+    connect(enableBox, &QCheckBox::toggled, this, [](bool on) { QueryTrace::instance().setEnabled(on); });
+    connect(thresholdBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [](int ms) {
+        QueryTrace::instance().setSlowThresholdMs(ms);
+    });
+    connect(resetButton, &QPushButton::clicked, this, &PerformanceDock::resetTrace);
+    connect(exportButton, &QPushButton::clicked, this, &PerformanceDock::exportTrace);
+    connect(timer, &QTimer::timeout, this, &PerformanceDock::refresh);
+    connect(this, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) {
+            refresh();
+            timer->start(RefreshMs);
+        } else {
+            timer->stop();
+        }
+    });
+}
+
+void PerformanceDock::refresh()
+{
+    QVector<QueryStats> stats = QueryTrace::instance().statistics();
+    std::sort(stats.begin(), stats.end(), [](const QueryStats &a, const QueryStats &b) {
+        return a.totalNs > b.totalNs;
+    });
+    qint64 calls = 0;
+    qint64 totalNs = 0;
+    statsTable->setRowCount(stats.size());
+    for (int row = 0; row < stats.size(); ++row) {
+        const QueryStats &entry = stats.at(row);
+        calls += entry.count;
+        totalNs += entry.totalNs;
+        const QStringList cells = {
+            entry.statement.simplified(),
+            QString::number(entry.count),
+            formatNs(entry.count ? entry.totalNs / entry.count : 0),
+            formatNs(entry.percentileNs(0.5)),
+            formatNs(entry.percentileNs(0.95)),
+            formatNs(entry.maxNs),
+            QString::number(entry.rows)};
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *item = statsTable->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem();
+                statsTable->setItem(row, column, item);
+            }
+            item->setText(cells.at(column));
+            if (column == 0) item->setToolTip(entry.statement);
+        }
+    }
+    const QVector<SlowQuery> slow = QueryTrace::instance().slowQueries();
+    summaryLabel->setText(QString("%1 statements, %2 calls, %3 total, %4 slow")
+                              .arg(stats.size()).arg(calls).arg(formatNs(totalNs)).arg(slow.size()));
+    slowList->clear();
+    for (int i = slow.size() - 1; i >= 0; --i) {
+        const SlowQuery &query = slow.at(i);
+        slowList->addItem(QString("%1  %2  %3 rows  %4")
+                              .arg(query.when.toString("HH:mm:ss"), formatNs(query.durationNs))
+                              .arg(query.rows)
+                              .arg(query.statement.simplified()));
+    }
+}
+
+void PerformanceDock::exportTrace()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Trace", "trace.json", "Chrome trace (*.json)");
+    if (fileName.isEmpty()) return;
+    QString error;
+    if (!QueryTrace::instance().exportChromeTrace(fileName, error)) {
+        QMessageBox::warning(this, "Error", "Failed to export trace: " + error);
+    }
+}
+
+void PerformanceDock::resetTrace()
+{
+    QueryTrace::instance().reset();
+    refresh();
+}
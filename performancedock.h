@@ -0,0 +1,31 @@
+#ifndef PERFORMANCEDOCK_H
+#define PERFORMANCEDOCK_H
+
+#include <QDockWidget>
+
+class QCheckBox;
+class QLabel;
+class QListWidget;
+class QSpinBox;
+class QTableWidget;
+class QTimer;
+
+class PerformanceDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit PerformanceDock(QWidget *parent = nullptr);
+private slots:
+    void refresh();
+    void exportTrace();
+    void resetTrace();
+private:
+    QCheckBox *enableBox;
+    QSpinBox *thresholdBox;
+    QLabel *summaryLabel;
+    QTableWidget *statsTable;
+    QListWidget *slowList;
+    QTimer *timer;
+};
+
+#endif // PERFORMANCEDOCK_H
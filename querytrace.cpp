@@ -0,0 +1,167 @@
+#include "querytrace.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlQuery>
+#include <QThread>
+#include <QDebug>
+
+namespace {
+const int MaxSpans = 65536;
+const int MaxSlowQueries = 200;
+const int DefaultSlowThresholdMs = 50;
+}
+
+qint64 QueryStats::percentileNs(double fraction) const
+{
+    if (count == 0) return 0;
+    qint64 target = qMax<qint64>(1, qint64(count * fraction + 0.5));
+    qint64 seen = 0;
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= target) return qMin(maxNs, (qint64(1) << bucket) * 1000);
+    }
+    return maxNs;
+}
+
+QueryTrace &QueryTrace::instance()
+{
+    static QueryTrace trace;
+    return trace;
+}
+
+QueryTrace::QueryTrace()
+    : slowThresholdNs(qint64(DefaultSlowThresholdMs) * 1000000)
+{
+    clock.start();
+}
+
+void QueryTrace::setEnabled(bool on)
+{
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+void QueryTrace::setSlowThresholdMs(int ms)
+{
+    QMutexLocker locker(&mutex);
+    slowThresholdNs = qint64(ms) * 1000000;
+}
+
+int QueryTrace::slowThresholdMs() const
+{
+    QMutexLocker locker(&mutex);
+    return int(slowThresholdNs / 1000000);
+}
+
+void QueryTrace::record(const QString &statement, qint64 startNs, qint64 durationNs, qint64 rows)
+{
+    quintptr thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    QMutexLocker locker(&mutex);
+    auto it = statementIds.constFind(statement);
+    int id;
+    if (it == statementIds.constEnd()) {
+        id = stats.size();
+        statementIds.insert(statement, id);
+        QueryStats entry;
+        entry.statement = statement;
+        stats.append(entry);
+    } else {
+        id = it.value();
+    }
+    QueryStats &entry = stats[id];
+    ++entry.count;
+    entry.totalNs += durationNs;
+    entry.maxNs = qMax(entry.maxNs, durationNs);
+    if (rows > 0) entry.rows += rows;
+    int bucket = 0;
+    for (qint64 us = durationNs / 1000; us > 0 && bucket < QueryStats::BucketCount - 1; us >>= 1) ++bucket;
+    ++entry.buckets[bucket];
+
+    Span span{id, startNs, durationNs, rows, thread};
+    if (spans.size() < MaxSpans) {
+        spans.append(span);
+    } else {
+        spans[nextSpan] = span;
+    }
+    nextSpan = (nextSpan + 1) % MaxSpans;
+
+    if (durationNs >= slowThresholdNs) {
+        if (slow.size() >= MaxSlowQueries) slow.removeFirst();
+        slow.append({statement, QDateTime::currentDateTime(), durationNs, rows});
+        qWarning() << "Slow query" << durationNs / 1000000.0 << "ms" << rows << "rows:" << statement;
+    }
+}
+
+QVector<QueryStats> QueryTrace::statistics() const
+{
+    QMutexLocker locker(&mutex);
+    return stats;
+}
+
+QVector<SlowQuery> QueryTrace::slowQueries() const
+{
+    QMutexLocker locker(&mutex);
+    return slow;
+}
+
+bool QueryTrace::exportChromeTrace(const QString &fileName, QString &error) const
+{
+    QVector<Span> ordered;
+    QStringList statements;
+    {
+        QMutexLocker locker(&mutex);
+        int first = spans.size() < MaxSpans ? 0 : nextSpan;
+        ordered.reserve(spans.size());
+        for (int i = 0; i < spans.size(); ++i) ordered.append(spans.at((first + i) % spans.size()));
+        for (const QueryStats &entry : stats) statements << entry.statement;
+    }
+    QHash<quintptr, int> threads;
+    QJsonArray events;
+    for (const Span &span : ordered) {
+        auto thread = threads.constFind(span.thread);
+        if (thread == threads.constEnd()) thread = threads.insert(span.thread, threads.size() + 1);
+        QJsonObject event;
+        event.insert("name", statements.value(span.statement).simplified().left(80));
+        event.insert("cat", "sql");
+        event.insert("ph", "X");
+        event.insert("ts", span.startNs / 1000.0);
+        event.insert("dur", span.durationNs / 1000.0);
+        event.insert("pid", 1);
+        event.insert("tid", thread.value());
+        event.insert("args", QJsonObject{{"sql", statements.value(span.statement)}, {"rows", span.rows}});
+        events.append(event);
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error = file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(QJsonObject{{"traceEvents", events}, {"displayTimeUnit", "ms"}}).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+void QueryTrace::reset()
+{
+    QMutexLocker locker(&mutex);
+    statementIds.clear();
+    stats.clear();
+    spans.clear();
+    nextSpan = 0;
+    slow.clear();
+}
+
+QuerySpan::QuerySpan(const QSqlQuery &query)
+    : query(QueryTrace::isEnabled() ? &query : nullptr)
+{
+    if (this->query) startNs = QueryTrace::instance().now();
+}
+
+QuerySpan::~QuerySpan()
+{
+    if (!query) return;
+    QueryTrace &trace = QueryTrace::instance();
+    qint64 durationNs = trace.now() - startNs;
+    if (rows < 0 && !query->isSelect()) rows = query->numRowsAffected();
+    trace.record(query->lastQuery(), startNs, durationNs, rows);
+}
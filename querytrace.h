@@ -0,0 +1,88 @@
+#ifndef QUERYTRACE_H
+#define QUERYTRACE_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <array>
+#include <atomic>
+
+class QSqlQuery;
+
+struct QueryStats
+{
+    static const int BucketCount = 24;
+    QString statement;
+    qint64 count = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+    qint64 rows = 0;
+    // Bucket 0 holds spans under 1 us, bucket i spans under 2^i us.
+    std::array<qint64, BucketCount> buckets{};
+    qint64 percentileNs(double fraction) const;
+};
+
+struct SlowQuery
+{
+    QString statement;
+    QDateTime when;
+    qint64 durationNs;
+    qint64 rows;
+};
+
+// Process-wide recorder for SQL statement timings. Keeps a latency histogram
+// per statement, a bounded slow-query log and a ring buffer of recent spans
+// for Chrome trace export. Tracing is off by default, and a QuerySpan created
+// while it is off costs a single relaxed atomic load.
+class QueryTrace
+{
+public:
+    static QueryTrace &instance();
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool on);
+    void setSlowThresholdMs(int ms);
+    int slowThresholdMs() const;
+    qint64 now() const { return clock.nsecsElapsed(); }
+    void record(const QString &statement, qint64 startNs, qint64 durationNs, qint64 rows);
+    QVector<QueryStats> statistics() const;
+    QVector<SlowQuery> slowQueries() const;
+    bool exportChromeTrace(const QString &fileName, QString &error) const;
+    void reset();
+private:
+    QueryTrace();
+    struct Span {
+        int statement;
+        qint64 startNs;
+        qint64 durationNs;
+        qint64 rows;
+        quintptr thread;
+    };
+    static inline std::atomic<bool> enabled{false};
+    QElapsedTimer clock;
+    mutable QMutex mutex;
+    QHash<QString, int> statementIds;
+    QVector<QueryStats> stats;
+    QVector<Span> spans;
+    int nextSpan = 0;
+    QVector<SlowQuery> slow;
+    qint64 slowThresholdNs;
+};
+
+// Times one statement from construction to destruction and reports it to
+// QueryTrace. Writes report the affected row count unless setRows() is used.
+class QuerySpan
+{
+public:
+    explicit QuerySpan(const QSqlQuery &query);
+    ~QuerySpan();
+    void setRows(qint64 count) { rows = count; }
+private:
+    const QSqlQuery *query;
+    qint64 startNs = 0;
+    qint64 rows = -1;
+};
+
+#endif // QUERYTRACE_H
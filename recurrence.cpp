@@ -0,0 +1,179 @@
+#include "recurrence.h"
+#include <QStringList>
+
+namespace {
+const char *const DayCodes[] = {"MO", "TU", "WE", "TH", "FR", "SA", "SU"};
+const char *const DayNames[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+// The period containing a point in time is estimated one period early, and
+// the next occurrence lies at most one period past it.
+const int MaxPeriodScan = 4;
+
+QDate weekStart(const QDate &date)
+{
+    return date.addDays(1 - date.dayOfWeek());
+}
+
+int bitCount(int mask)
+{
+    int count = 0;
+    for (; mask; mask &= mask - 1) ++count;
+    return count;
+}
+}
+
+Recurrence Recurrence::fromRule(const QString &rule)
+{
+    Recurrence recurrence;
+    const QStringList parts = rule.split(';', Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        const QString key = part.section('=', 0, 0).trimmed().toUpper();
+        const QString value = part.section('=', 1).trimmed().toUpper();
+        if (key == "FREQ") {
+            if (value == "DAILY") recurrence.freq = Daily;
+            else if (value == "WEEKLY") recurrence.freq = Weekly;
+            else if (value == "MONTHLY") recurrence.freq = Monthly;
+            else if (value == "YEARLY") recurrence.freq = Yearly;
+        } else if (key == "INTERVAL") {
+            recurrence.setInterval(value.toInt());
+        } else if (key == "COUNT") {
+            recurrence.setCount(value.toInt());
+        } else if (key == "UNTIL") {
+            recurrence.lastDate = QDate::fromString(value.left(8), "yyyyMMdd");
+        } else if (key == "BYDAY") {
+            const QStringList codes = value.split(',', Qt::SkipEmptyParts);
+            for (const QString &code : codes) {
+                for (int day = 0; day < 7; ++day) {
+                    if (code.endsWith(DayCodes[day])) recurrence.days |= 1 << day;
+                }
+            }
+        }
+    }
+    return recurrence;
+}
+
+QString Recurrence::toRule() const
+{
+    static const char *const Frequencies[] = {"", "DAILY", "WEEKLY", "MONTHLY", "YEARLY"};
+    if (freq == None) return QString();
+    QStringList parts;
+    parts << QString("FREQ=%1").arg(Frequencies[freq]);
+    if (step > 1) parts << QString("INTERVAL=%1").arg(step);
+    if (freq == Weekly && days) {
+        QStringList codes;
+        for (int day = 0; day < 7; ++day) {
+            if (days & (1 << day)) codes << DayCodes[day];
+        }
+        parts << "BYDAY=" + codes.join(',');
+    }
+    if (limit > 0) parts << QString("COUNT=%1").arg(limit);
+    if (lastDate.isValid()) parts << "UNTIL=" + lastDate.toString("yyyyMMdd");
+    return parts.join(';');
+}
+
+QString Recurrence::describe() const
+{
+    static const char *const Units[] = {"", "day", "week", "month", "year"};
+    if (freq == None) return "Does not repeat";
+    QString text = step == 1 ? QString("Every %1").arg(Units[freq])
+                             : QString("Every %1 %2s").arg(step).arg(Units[freq]);
+    if (freq == Weekly && days) {
+        QStringList names;
+        for (int day = 0; day < 7; ++day) {
+            if (days & (1 << day)) names << DayNames[day];
+        }
+        text += " on " + names.join(", ");
+    }
+    if (limit > 0) text += QString(", %1 times").arg(limit);
+    if (lastDate.isValid()) text += ", until " + lastDate.toString(Qt::ISODate);
+    return text;
+}
+
+QDateTime Recurrence::next(const QDateTime &start, const QDateTime &from) const
+{
+    if (!start.isValid()) return QDateTime();
+    if (freq == None) return start >= from ? start : QDateTime();
+    QDateTime at = qMax(from, start);
+    qint64 period = qMax<qint64>(0, periodOf(start, at) - 1);
+    int perPeriod = (freq == Weekly && days) ? bitCount(days) : 1;
+    int skipped = slotsBeforeStart(start);
+    for (int scanned = 0; scanned < MaxPeriodScan; ++scanned, ++period) {
+        const QVector<QDateTime> candidates = occurrencesIn(start, period);
+        for (int i = 0; i < candidates.size(); ++i) {
+            const QDateTime &candidate = candidates.at(i);
+            if (candidate < start) continue;
+            qint64 index = period * perPeriod + i - skipped;
+            if (limit > 0 && index >= limit) return QDateTime();
+            if (lastDate.isValid() && candidate.date() > lastDate) return QDateTime();
+            if (candidate >= at) return candidate;
+        }
+    }
+    return QDateTime();
+}
+
+QVector<QDateTime> Recurrence::between(const QDateTime &start, const QDateTime &from, const QDateTime &to, int max) const
+{
+    QVector<QDateTime> occurrences;
+    QDateTime at = next(start, from);
+    while (at.isValid() && at < to && occurrences.size() < max) {
+        occurrences.append(at);
+        if (freq == None) break;
+        at = next(start, at.addSecs(1));
+    }
+    return occurrences;
+}
+
+QVector<QDateTime> Recurrence::occurrencesIn(const QDateTime &start, qint64 period) const
+{
+    QVector<QDateTime> occurrences;
+    switch (freq) {
+    case Daily:
+        occurrences.append(start.addDays(period * step));
+        break;
+    case Weekly:
+        if (!days) {
+            occurrences.append(start.addDays(7 * period * step));
+            break;
+        }
+        for (int day = 0; day < 7; ++day) {
+            if (!(days & (1 << day))) continue;
+            QDateTime occurrence = start;
+            occurrence.setDate(weekStart(start.date()).addDays(7 * period * step + day));
+            occurrences.append(occurrence);
+        }
+        break;
+    case Monthly:
+        occurrences.append(start.addMonths(int(period * step)));
+        break;
+    case Yearly:
+        occurrences.append(start.addYears(int(period * step)));
+        break;
+    case None:
+        break;
+    }
+    return occurrences;
+}
+
+qint64 Recurrence::periodOf(const QDateTime &start, const QDateTime &at) const
+{
+    const QDate first = start.date();
+    const QDate date = at.date();
+    switch (freq) {
+    case Daily:
+        return first.daysTo(date) / step;
+    case Weekly:
+        return weekStart(first).daysTo(date) / (7 * step);
+    case Monthly:
+        return ((date.year() - first.year()) * 12 + date.month() - first.month()) / step;
+    case Yearly:
+        return (date.year() - first.year()) / step;
+    case None:
+        break;
+    }
+    return 0;
+}
+
+int Recurrence::slotsBeforeStart(const QDateTime &start) const
+{
+    if (freq != Weekly || !days) return 0;
+    return bitCount(days & ((1 << (start.date().dayOfWeek() - 1)) - 1));
+}
@@ -0,0 +1,46 @@
+#ifndef RECURRENCE_H
+#define RECURRENCE_H
+
+#include <QDate>
+#include <QDateTime>
+#include <QString>
+#include <QVector>
+
+// A subset of the iCalendar RRULE: FREQ (DAILY, WEEKLY, MONTHLY, YEARLY),
+// INTERVAL, BYDAY for weekly rules, and COUNT or UNTIL. Occurrences are never
+// stored; they are computed from the series start on demand, and finding the
+// next one after any point in time costs the same however far the series
+// runs. Monthly and yearly rules clamp to the last day of shorter months.
+class Recurrence
+{
+public:
+    enum Frequency { None, Daily, Weekly, Monthly, Yearly };
+    static Recurrence fromRule(const QString &rule);
+    QString toRule() const;
+    QString describe() const;
+    bool isRecurring() const { return freq != None; }
+    Frequency frequency() const { return freq; }
+    void setFrequency(Frequency frequency) { freq = frequency; }
+    int interval() const { return step; }
+    void setInterval(int interval) { step = qMax(1, interval); }
+    // Bit (day - 1) is set for each Qt::DayOfWeek; only used by weekly rules.
+    int weekdays() const { return days; }
+    void setWeekdays(int mask) { days = mask & 0x7f; }
+    int count() const { return limit; }
+    void setCount(int count) { limit = qMax(0, count); }
+    QDate until() const { return lastDate; }
+    void setUntil(const QDate &date) { lastDate = date; }
+    QDateTime next(const QDateTime &start, const QDateTime &from) const;
+    QVector<QDateTime> between(const QDateTime &start, const QDateTime &from, const QDateTime &to, int max) const;
+private:
+    QVector<QDateTime> occurrencesIn(const QDateTime &start, qint64 period) const;
+    qint64 periodOf(const QDateTime &start, const QDateTime &at) const;
+    int slotsBeforeStart(const QDateTime &start) const;
+    Frequency freq = None;
+    int step = 1;
+    int days = 0;
+    int limit = 0;
+    QDate lastDate;
+};
+
+#endif // RECURRENCE_H
@@ -0,0 +1,358 @@
+#include "schemamigrator.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QSet>
+#include <iterator>
+#include <QDebug>
+
+namespace {
+
+struct Migration
+{
+    int version;
+    const char *name;
+    bool (*apply)(QSqlQuery &query);
+};
+
+QSet<QString> columnNames(QSqlQuery &query, const QString &table)
+{
+    QSet<QString> columns;
+    if (query.exec("PRAGMA table_info(" + table + ")")) {
+        while (query.next()) columns.insert(query.value(1).toString());
+    }
+    return columns;
+}
+
+bool execAll(QSqlQuery &query, const QStringList &statements)
+{
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) return false;
+    }
+    return true;
+}
+
+bool createBaseSchema(QSqlQuery &query)
+{
+    if (!execAll(query, {
+            "CREATE TABLE IF NOT EXISTS topics (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT UNIQUE)",
+            "CREATE TABLE IF NOT EXISTS tasks ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "topic_id INTEGER, "
+            "name TEXT, "
+            "description TEXT, "
+            "due_date TEXT, "
+            "due_at INTEGER, "
+            "notify INTEGER, "
+            "notified INTEGER DEFAULT 0, "
+            "done INTEGER DEFAULT 0, "
+            "FOREIGN KEY(topic_id) REFERENCES topics(id) ON DELETE CASCADE)"})) {
+        return false;
+    }
+    QSet<QString> columns = columnNames(query, "tasks");
+    if (!columns.contains("done") && !query.exec("ALTER TABLE tasks ADD COLUMN done INTEGER DEFAULT 0")) return false;
+    if (!columns.contains("description") && !query.exec("ALTER TABLE tasks ADD COLUMN description TEXT")) return false;
+    if (!columns.contains("due_at")) {
+        if (!query.exec("ALTER TABLE tasks ADD COLUMN due_at INTEGER")) return false;
+        if (!query.exec("UPDATE tasks SET due_at = CAST(strftime('%s', due_date, 'utc') AS INTEGER) "
+                        "WHERE due_date IS NOT NULL")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool createTaskIndexes(QSqlQuery &query)
+{
+    return execAll(query, {
+        "CREATE INDEX IF NOT EXISTS idx_tasks_topic_id ON tasks(topic_id)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_done ON tasks(done)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_due_at ON tasks(due_at)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_pending_due ON tasks(due_at) "
+        "WHERE notify = 1 AND notified = 0"});
+}
+
+bool createFullTextIndex(QSqlQuery &query)
+{
+    if (!query.exec("CREATE VIRTUAL TABLE IF NOT EXISTS tasks_fts USING fts5("
+                    "name, description, content='tasks', content_rowid='id', "
+                    "prefix='2 3', tokenize='unicode61 remove_diacritics 2')")) {
+        qDebug() << "FTS5 unavailable, task search falls back to LIKE:" << query.lastError().text();
+        return true;
+    }
+    return execAll(query, {
+        "CREATE TRIGGER IF NOT EXISTS tasks_fts_insert AFTER INSERT ON tasks BEGIN "
+        "INSERT INTO tasks_fts (rowid, name, description) VALUES (new.id, new.name, new.description); "
+        "END",
+        "CREATE TRIGGER IF NOT EXISTS tasks_fts_delete AFTER DELETE ON tasks BEGIN "
+        "INSERT INTO tasks_fts (tasks_fts, rowid, name, description) VALUES ('delete', old.id, old.name, old.description); "
+        "END",
+        "CREATE TRIGGER IF NOT EXISTS tasks_fts_update AFTER UPDATE OF name, description ON tasks BEGIN "
+        "INSERT INTO tasks_fts (tasks_fts, rowid, name, description) VALUES ('delete', old.id, old.name, old.description); "
+        "INSERT INTO tasks_fts (rowid, name, description) VALUES (new.id, new.name, new.description); "
+        "END",
+        "INSERT INTO tasks_fts (tasks_fts, rank) VALUES ('rank', 'bm25(10.0, 1.0)')",
+        "INSERT INTO tasks_fts (tasks_fts) VALUES ('rebuild')"});
+}
+
+bool addTopicTombstones(QSqlQuery &query)
+{
+    if (!columnNames(query, "topics").contains("deleted")
+        && !query.exec("ALTER TABLE topics ADD COLUMN deleted INTEGER NOT NULL DEFAULT 0")) {
+        return false;
+    }
+    return query.exec("CREATE INDEX IF NOT EXISTS idx_topics_deleted ON topics(deleted) WHERE deleted = 1");
+}
+
+// Recurring tasks keep their rule on the task row; only completed or skipped
+// occurrences get a row of their own.
+bool addRecurrence(QSqlQuery &query)
+{
+    if (!columnNames(query, "tasks").contains("recurrence")
+        && !query.exec("ALTER TABLE tasks ADD COLUMN recurrence TEXT")) {
+        return false;
+    }
+    return query.exec("CREATE TABLE IF NOT EXISTS task_occurrences ("
+                      "task_id INTEGER NOT NULL, "
+                      "occurs_at INTEGER NOT NULL, "
+                      "state INTEGER NOT NULL, "
+                      "PRIMARY KEY(task_id, occurs_at), "
+                      "FOREIGN KEY(task_id) REFERENCES tasks(id) ON DELETE CASCADE) WITHOUT ROWID");
+}
+
+// Per-topic counters kept current by triggers. Overdue depends on the time,
+// so it is counted against the watermark in stats_clock, which
+// TopicRepository::advanceClock moves forward in one range scan.
+bool createTopicStats(QSqlQuery &query)
+{
+    const QString clock = "(SELECT now FROM stats_clock)";
+    const QString late = "CASE WHEN %1.done = 0 AND %1.due_at <= " + clock + " THEN 1 ELSE 0 END";
+    const QString done = "CASE WHEN %1.done = 1 THEN 1 ELSE 0 END";
+    const QString nextDue = "(SELECT MIN(due_at) FROM tasks WHERE topic_id = %1 AND done = 0 AND due_at > " + clock + ")";
+    return execAll(query, {
+        "CREATE TABLE IF NOT EXISTS stats_clock (id INTEGER PRIMARY KEY CHECK (id = 1), now INTEGER NOT NULL)",
+        "INSERT OR IGNORE INTO stats_clock (id, now) VALUES (1, CAST(strftime('%s', 'now') AS INTEGER))",
+        "CREATE TABLE IF NOT EXISTS topic_stats ("
+        "topic_id INTEGER PRIMARY KEY REFERENCES topics(id) ON DELETE CASCADE, "
+        "total INTEGER NOT NULL DEFAULT 0, "
+        "done INTEGER NOT NULL DEFAULT 0, "
+        "overdue INTEGER NOT NULL DEFAULT 0, "
+        "next_due INTEGER)",
+        "CREATE INDEX IF NOT EXISTS idx_tasks_topic_open_due ON tasks(topic_id, due_at) WHERE done = 0",
+        "CREATE INDEX IF NOT EXISTS idx_topic_stats_next_due ON topic_stats(next_due)",
+        "DELETE FROM topic_stats",
+        "INSERT INTO topic_stats (topic_id, total, done, overdue, next_due) "
+        "SELECT tp.id, COUNT(t.id), "
+        "COALESCE(SUM(t.done = 1), 0), "
+        "COALESCE(SUM(t.done = 0 AND t.due_at <= c.now), 0), "
+        "MIN(CASE WHEN t.done = 0 AND t.due_at > c.now THEN t.due_at END) "
+        "FROM topics tp CROSS JOIN stats_clock c LEFT JOIN tasks t ON t.topic_id = tp.id "
+        "GROUP BY tp.id",
+        "CREATE TRIGGER IF NOT EXISTS topics_stats_insert AFTER INSERT ON topics BEGIN "
+        "INSERT OR IGNORE INTO topic_stats (topic_id) VALUES (new.id); END",
+        "CREATE TRIGGER IF NOT EXISTS tasks_stats_insert AFTER INSERT ON tasks BEGIN "
+        "INSERT OR IGNORE INTO topic_stats (topic_id) VALUES (new.topic_id); "
+        "UPDATE topic_stats SET total = total + 1, "
+        "done = done + " + done.arg("new") + ", "
+        "overdue = overdue + " + late.arg("new") + ", "
+        "next_due = CASE WHEN new.done = 0 AND new.due_at > " + clock + " "
+        "AND (next_due IS NULL OR new.due_at < next_due) THEN new.due_at ELSE next_due END "
+        "WHERE topic_id = new.topic_id; END",
+        "CREATE TRIGGER IF NOT EXISTS tasks_stats_delete AFTER DELETE ON tasks BEGIN "
+        "UPDATE topic_stats SET total = total - 1, "
+        "done = done - " + done.arg("old") + ", "
+        "overdue = overdue - " + late.arg("old") + ", "
+        "next_due = CASE WHEN old.due_at = next_due THEN " + nextDue.arg("old.topic_id") + " ELSE next_due END "
+        "WHERE topic_id = old.topic_id; END",
+        "CREATE TRIGGER IF NOT EXISTS tasks_stats_update AFTER UPDATE OF topic_id, done, due_at ON tasks BEGIN "
+        "INSERT OR IGNORE INTO topic_stats (topic_id) VALUES (new.topic_id); "
+        "UPDATE topic_stats SET total = total - 1, "
+        "done = done - " + done.arg("old") + ", "
+        "overdue = overdue - " + late.arg("old") + " "
+        "WHERE topic_id = old.topic_id; "
+        "UPDATE topic_stats SET total = total + 1, "
+        "done = done + " + done.arg("new") + ", "
+        "overdue = overdue + " + late.arg("new") + " "
+        "WHERE topic_id = new.topic_id; "
+        "UPDATE topic_stats SET next_due = " + nextDue.arg("topic_stats.topic_id") + " "
+        "WHERE topic_id IN (old.topic_id, new.topic_id); END"});
+}
+
+// Every write to topics or tasks leaves its row id in change_log, so other
+// connections sharing the file can re-read just those rows. Tasks removed
+// behind a topic tombstone are covered by the topic's own entry.
+bool createChangeLog(QSqlQuery &query)
+{
+    const QString log = "INSERT INTO change_log (entity, row_id) VALUES (%1, %2); END";
+    return execAll(query, {
+        "CREATE TABLE IF NOT EXISTS change_log ("
+        "seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "entity INTEGER NOT NULL, "
+        "row_id INTEGER NOT NULL)",
+        "CREATE TRIGGER IF NOT EXISTS topics_log_insert AFTER INSERT ON topics BEGIN " + log.arg(0).arg("new.id"),
+        "CREATE TRIGGER IF NOT EXISTS topics_log_update AFTER UPDATE OF name, deleted ON topics BEGIN "
+        + log.arg(0).arg("new.id"),
+        "CREATE TRIGGER IF NOT EXISTS topics_log_delete AFTER DELETE ON topics BEGIN " + log.arg(0).arg("old.id"),
+        "CREATE TRIGGER IF NOT EXISTS tasks_log_insert AFTER INSERT ON tasks BEGIN " + log.arg(1).arg("new.id"),
+        "CREATE TRIGGER IF NOT EXISTS tasks_log_update "
+        "AFTER UPDATE OF topic_id, name, description, due_date, due_at, done, recurrence ON tasks BEGIN "
+        + log.arg(1).arg("new.id"),
+        "CREATE TRIGGER IF NOT EXISTS tasks_log_delete AFTER DELETE ON tasks "
+        "WHEN NOT EXISTS (SELECT 1 FROM topics WHERE id = old.topic_id AND deleted = 1) BEGIN "
+        + log.arg(1).arg("old.id")});
+}
+
+// Sync identity and journal. Rows get a random uuid that stays the same on
+// every replica. Each local write bumps the replica's Lamport clock and
+// leaves (clock, origin) in sync_journal, keyed by row so only the latest
+// entry per row is kept; seq order is what a peer's cursor follows.
+// Writes made while applying a peer's batch set sync_state.applying and
+// are journaled by the sync code itself with their original clock.
+bool createSyncJournal(QSqlQuery &query)
+{
+    if (!columnNames(query, "topics").contains("uuid") && !query.exec("ALTER TABLE topics ADD COLUMN uuid BLOB")) {
+        return false;
+    }
+    if (!columnNames(query, "tasks").contains("uuid") && !query.exec("ALTER TABLE tasks ADD COLUMN uuid BLOB")) {
+        return false;
+    }
+    const QString journal = "UPDATE sync_state SET clock = clock + 1 WHERE applying = 0; "
+                            "INSERT OR REPLACE INTO sync_journal (entity, uuid, clock, origin) "
+                            "SELECT %1, %2, clock, replica FROM sync_state WHERE applying = 0; END";
+    const QString applying = "(SELECT applying FROM sync_state) = 0";
+    return execAll(query, {
+        "UPDATE topics SET uuid = randomblob(16) WHERE uuid IS NULL",
+        "UPDATE tasks SET uuid = randomblob(16) WHERE uuid IS NULL",
+        "CREATE UNIQUE INDEX IF NOT EXISTS idx_topics_uuid ON topics(uuid)",
+        "CREATE UNIQUE INDEX IF NOT EXISTS idx_tasks_uuid ON tasks(uuid)",
+        "CREATE TABLE IF NOT EXISTS sync_state ("
+        "id INTEGER PRIMARY KEY CHECK (id = 1), "
+        "replica TEXT NOT NULL, "
+        "clock INTEGER NOT NULL, "
+        "applying INTEGER NOT NULL DEFAULT 0)",
+        "INSERT OR IGNORE INTO sync_state (id, replica, clock) VALUES (1, lower(hex(randomblob(8))), 1)",
+        "CREATE TABLE IF NOT EXISTS sync_journal ("
+        "seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "entity INTEGER NOT NULL, "
+        "uuid BLOB NOT NULL, "
+        "clock INTEGER NOT NULL, "
+        "origin TEXT NOT NULL, "
+        "source TEXT, "
+        "UNIQUE(entity, uuid))",
+        "CREATE TABLE IF NOT EXISTS sync_peers ("
+        "peer TEXT PRIMARY KEY, "
+        "sent INTEGER NOT NULL DEFAULT 0, "
+        "received INTEGER NOT NULL DEFAULT 0)",
+        "INSERT OR IGNORE INTO sync_journal (entity, uuid, clock, origin) "
+        "SELECT 0, tp.uuid, s.clock, s.replica FROM topics tp CROSS JOIN sync_state s WHERE tp.deleted = 0",
+        "INSERT OR IGNORE INTO sync_journal (entity, uuid, clock, origin) "
+        "SELECT 1, t.uuid, s.clock, s.replica FROM tasks t "
+        "JOIN topics tp ON tp.id = t.topic_id AND tp.deleted = 0 CROSS JOIN sync_state s",
+        "CREATE TRIGGER IF NOT EXISTS topics_sync_insert AFTER INSERT ON topics BEGIN "
+        "UPDATE topics SET uuid = randomblob(16) WHERE id = new.id AND uuid IS NULL; "
+        + journal.arg(0).arg("(SELECT uuid FROM topics WHERE id = new.id)"),
+        "CREATE TRIGGER IF NOT EXISTS topics_sync_update AFTER UPDATE OF name, deleted ON topics "
+        "WHEN " + applying + " BEGIN " + journal.arg(0).arg("new.uuid"),
+        "CREATE TRIGGER IF NOT EXISTS topics_sync_delete AFTER DELETE ON topics "
+        "WHEN old.deleted = 0 AND " + applying + " BEGIN " + journal.arg(0).arg("old.uuid"),
+        "CREATE TRIGGER IF NOT EXISTS tasks_sync_insert AFTER INSERT ON tasks BEGIN "
+        "UPDATE tasks SET uuid = randomblob(16) WHERE id = new.id AND uuid IS NULL; "
+        + journal.arg(1).arg("(SELECT uuid FROM tasks WHERE id = new.id)"),
+        "CREATE TRIGGER IF NOT EXISTS tasks_sync_update "
+        "AFTER UPDATE OF topic_id, name, description, due_date, due_at, notify, done, recurrence ON tasks "
+        "WHEN " + applying + " BEGIN " + journal.arg(1).arg("new.uuid"),
+        "CREATE TRIGGER IF NOT EXISTS tasks_sync_delete AFTER DELETE ON tasks "
+        "WHEN " + applying + " AND NOT EXISTS (SELECT 1 FROM topics WHERE id = old.topic_id AND deleted = 1) BEGIN "
+        + journal.arg(1).arg("old.uuid")});
+}
+
+const Migration migrations[] = {
+    {1, "base schema", createBaseSchema},
+    {2, "task indexes", createTaskIndexes},
+    {3, "full-text search", createFullTextIndex},
+    {4, "topic tombstones", addTopicTombstones},
+    {5, "recurring tasks", addRecurrence},
+    {6, "topic counters", createTopicStats},
+    {7, "change log", createChangeLog},
+    {8, "sync journal", createSyncJournal},
+};
+
+}
+
+SchemaMigrator::SchemaMigrator(const QSqlDatabase &db)
+    : db(db)
+{
+}
+
+void SchemaMigrator::configureConnection(const QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    // auto_vacuum only takes effect on a file that has no tables yet, and has
+    // to come before the switch to WAL. Existing files are converted by the
+    // headless vacuum command.
+    const QStringList pragmas = {
+        "PRAGMA auto_vacuum = INCREMENTAL",
+        "PRAGMA foreign_keys = ON",
+        "PRAGMA journal_mode = WAL",
+        "PRAGMA synchronous = NORMAL",
+        "PRAGMA cache_size = -65536",
+        "PRAGMA mmap_size = 268435456",
+        "PRAGMA temp_store = MEMORY"};
+    for (const QString &pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qDebug() << "Failed to apply" << pragma << ":" << query.lastError().text();
+        }
+    }
+}
+
+int SchemaMigrator::latestVersion()
+{
+    return migrations[std::size(migrations) - 1].version;
+}
+
+int SchemaMigrator::currentVersion() const
+{
+    QSqlQuery query(db);
+    if (query.exec("PRAGMA user_version") && query.next()) return query.value(0).toInt();
+    return 0;
+}
+
+bool SchemaMigrator::migrate()
+{
+    applied.clear();
+    error.clear();
+    int version = currentVersion();
+    for (const Migration &migration : migrations) {
+        if (migration.version <= version) continue;
+        QElapsedTimer timer;
+        timer.start();
+        if (!db.transaction()) {
+            error = db.lastError().text();
+            return false;
+        }
+        QSqlQuery query(db);
+        if (!migration.apply(query)
+            || !query.exec(QString("PRAGMA user_version = %1").arg(migration.version))) {
+            error = QString("Migration %1 (%2) failed: %3")
+                        .arg(migration.version)
+                        .arg(migration.name)
+                        .arg(query.lastError().text());
+            db.rollback();
+            return false;
+        }
+        if (!db.commit()) {
+            error = db.lastError().text();
+            db.rollback();
+            return false;
+        }
+        applied.append({migration.version, migration.name, timer.elapsed()});
+        qDebug() << "Applied migration" << migration.version << migration.name
+                 << "in" << timer.elapsed() << "ms";
+        version = migration.version;
+    }
+    if (!applied.isEmpty()) {
+        QSqlQuery query(db);
+        query.exec("PRAGMA optimize");
+    }
+    return true;
+}
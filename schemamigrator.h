@@ -0,0 +1,31 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+
+struct MigrationReport
+{
+    int version;
+    QString name;
+    qint64 elapsedMs;
+};
+
+class SchemaMigrator
+{
+public:
+    explicit SchemaMigrator(const QSqlDatabase &db);
+    static void configureConnection(const QSqlDatabase &db);
+    static int latestVersion();
+    int currentVersion() const;
+    bool migrate();
+    QVector<MigrationReport> reports() const { return applied; }
+    QString lastError() const { return error; }
+private:
+    QSqlDatabase db;
+    QVector<MigrationReport> applied;
+    QString error;
+};
+
+#endif // SCHEMAMIGRATOR_H
@@ -0,0 +1,158 @@
+#include "searchresultmodel.h"
+#include "databaseworker.h"
+#include "tasklistmodel.h"
+#include <QTimer>
+
+namespace {
+const int PageSize = 100;
+const int DebounceMs = 150;
+}
+
+SearchResultModel::SearchResultModel(DatabaseWorker *worker, QObject *parent)
+    : QAbstractListModel(parent), worker(worker), debounceTimer(new QTimer(this))
+{
+    debounceTimer->setSingleShot(true);
+    debounceTimer->setInterval(DebounceMs);
+    connect(debounceTimer, &QTimer::timeout, this, &SearchResultModel::runSearch);
+}
+
+void SearchResultModel::setSearchText(const QString &searchText)
+{
+    if (searchText == text) return;
+    text = searchText;
+    worker->cancel("search");
+    debounceTimer->start();
+}
+
+void SearchResultModel::refresh()
+{
+    debounceTimer->stop();
+    runSearch();
+}
+
+void SearchResultModel::runSearch()
+{
+    beginResetModel();
+    ++generation;
+    results.clear();
+    exhausted = text.trimmed().isEmpty();
+    fetching = false;
+    endResetModel();
+    if (exhausted) {
+        worker->cancel("search");
+        emit resultsReady();
+        return;
+    }
+    fetchMore(QModelIndex());
+}
+
+int SearchResultModel::rowForTask(int taskId) const
+{
+    for (int row = 0; row < results.size(); ++row) {
+        if (results.at(row).id == taskId) return row;
+    }
+    return -1;
+}
+
+void SearchResultModel::updateTask(int taskId, const QString &name, const QString &topicName)
+{
+    int row = rowForTask(taskId);
+    if (row < 0) return;
+    results[row].name = name;
+    results[row].topicName = topicName;
+    emit dataChanged(index(row), index(row), {Qt::DisplayRole, TaskListModel::TopicNameRole});
+}
+
+void SearchResultModel::setTaskDone(int taskId, bool done)
+{
+    int row = rowForTask(taskId);
+    if (row < 0 || results.at(row).done == done) return;
+    results[row].done = done;
+    emit dataChanged(index(row), index(row), {Qt::CheckStateRole});
+}
+
+void SearchResultModel::removeTask(int taskId)
+{
+    int row = rowForTask(taskId);
+    if (row < 0) return;
+    beginRemoveRows(QModelIndex(), row, row);
+    results.remove(row);
+    endRemoveRows();
+}
+
+void SearchResultModel::renameTopic(const QString &currentName, const QString &newName)
+{
+    for (int row = 0; row < results.size(); ++row) {
+        if (results.at(row).topicName != currentName) continue;
+        results[row].topicName = newName;
+        emit dataChanged(index(row), index(row), {Qt::DisplayRole, TaskListModel::TopicNameRole});
+    }
+}
+
+int SearchResultModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : results.size();
+}
+
+QVariant SearchResultModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= results.size()) return QVariant();
+    const TaskRecord &task = results.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString("%1 (%2)").arg(task.name, task.topicName);
+    case Qt::CheckStateRole:
+        return task.done ? Qt::Checked : Qt::Unchecked;
+    case TaskListModel::TaskIdRole:
+        return task.id;
+    case TaskListModel::TopicNameRole:
+        return task.topicName;
+    default:
+        return QVariant();
+    }
+}
+
+bool SearchResultModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::CheckStateRole || !index.isValid() || index.row() >= results.size()) return false;
+    bool done = static_cast<Qt::CheckState>(value.toInt()) == Qt::Checked;
+    TaskRecord &task = results[index.row()];
+    if (task.done == done) return true;
+    task.done = done;
+    emit dataChanged(index, index, {Qt::CheckStateRole});
+    emit taskCheckStateChanged(task.id, done);
+    return true;
+}
+
+Qt::ItemFlags SearchResultModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+    return QAbstractListModel::flags(index) | Qt::ItemIsUserCheckable;
+}
+
+bool SearchResultModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !exhausted && !fetching;
+}
+
+void SearchResultModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || exhausted || fetching) return;
+    fetching = true;
+    int requestGeneration = generation;
+    int offset = results.size();
+    QString searchText = text;
+    worker->post("search", [searchText, offset](DatabaseSession &session) {
+        return session.tasks().search(searchText, PageSize, offset);
+    }, this, [this, requestGeneration, offset](const QVector<TaskRecord> &page) {
+        if (requestGeneration != generation) return;
+        fetching = false;
+        if (page.size() < PageSize) exhausted = true;
+        if (!page.isEmpty()) {
+            beginInsertRows(QModelIndex(), results.size(), results.size() + page.size() - 1);
+            results += page;
+            endInsertRows();
+        }
+        if (offset == 0) emit resultsReady();
+    });
+}
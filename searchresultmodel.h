@@ -0,0 +1,44 @@
+#ifndef SEARCHRESULTMODEL_H
+#define SEARCHRESULTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include "taskrepository.h"
+
+class QTimer;
+class DatabaseWorker;
+
+class SearchResultModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit SearchResultModel(DatabaseWorker *worker, QObject *parent = nullptr);
+    void setSearchText(const QString &text);
+    QString searchText() const { return text; }
+    void refresh();
+    void updateTask(int taskId, const QString &name, const QString &topicName);
+    void setTaskDone(int taskId, bool done);
+    void removeTask(int taskId);
+    void renameTopic(const QString &currentName, const QString &newName);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+signals:
+    void taskCheckStateChanged(int taskId, bool done);
+    void resultsReady();
+private:
+    void runSearch();
+    int rowForTask(int taskId) const;
+    DatabaseWorker *worker;
+    QTimer *debounceTimer;
+    QString text;
+    int generation = 0;
+    bool exhausted = true;
+    bool fetching = false;
+    QVector<TaskRecord> results;
+};
+
+#endif // SEARCHRESULTMODEL_H
@@ -0,0 +1,26 @@
+#include "startupprofiler.h"
+#include <QElapsedTimer>
+#include <QDebug>
+
+namespace {
+QElapsedTimer &startupClock()
+{
+    static QElapsedTimer clock;
+    return clock;
+}
+}
+
+void StartupProfiler::start()
+{
+    startupClock().start();
+}
+
+qint64 StartupProfiler::elapsedMs()
+{
+    return startupClock().isValid() ? startupClock().elapsed() : 0;
+}
+
+void StartupProfiler::mark(const QString &stage)
+{
+    qInfo().noquote() << QString("startup: %1 at %2 ms").arg(stage).arg(elapsedMs());
+}
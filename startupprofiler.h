@@ -0,0 +1,16 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QString>
+
+// Logs "startup: <stage> at <ms> ms" markers measured from process start so
+// time-to-first-frame can be checked from the application log.
+class StartupProfiler
+{
+public:
+    static void start();
+    static void mark(const QString &stage);
+    static qint64 elapsedMs();
+};
+
+#endif // STARTUPPROFILER_H
@@ -0,0 +1,410 @@
+#include "syncjournal.h"
+#include "querytrace.h"
+#include <QSet>
+#include <QSqlError>
+
+namespace {
+QString suffixed(const QString &name, const QByteArray &uuid)
+{
+    return name + " (" + QString::fromLatin1(uuid.toHex().left(6)) + ")";
+}
+}
+
+SyncJournal::SyncJournal(const QSqlDatabase &db)
+    : db(db), stateQuery(db), resetQuery(db), cursorQuery(db), addPeerQuery(db), sentQuery(db), receivedQuery(db),
+      changesQuery(db), applyingQuery(db), clockQuery(db), latestQuery(db), recordQuery(db), topicQuery(db),
+      clashQuery(db), insertTopicQuery(db), updateTopicQuery(db), taskQuery(db), insertTaskQuery(db),
+      updateTaskQuery(db), deleteTaskQuery(db)
+{
+    stateQuery.prepare("SELECT replica FROM sync_state");
+    resetQuery.prepare("UPDATE sync_state SET replica = lower(hex(randomblob(8)))");
+    cursorQuery.prepare("SELECT sent, received FROM sync_peers WHERE peer = :peer");
+    addPeerQuery.prepare("INSERT OR IGNORE INTO sync_peers (peer) VALUES (:peer)");
+    sentQuery.prepare("UPDATE sync_peers SET sent = :sequence WHERE peer = :peer");
+    receivedQuery.prepare("UPDATE sync_peers SET received = :sequence WHERE peer = :peer");
+    // The journal keeps one entry per row, so the rows behind a page of
+    // entries are read in the same pass through their uuid indexes, along
+    // with the journal entry of each task's topic.
+    changesQuery.setForwardOnly(true);
+    changesQuery.prepare("SELECT j.seq, j.entity, j.uuid, j.clock, j.origin, j.source, "
+                         "tp.name, tp.deleted, "
+                         "t.id, tt.uuid, t.name, t.description, t.due_date, t.due_at, t.notify, t.done, t.recurrence, "
+                         "tj.seq, tj.clock, tj.origin, tj.source, tt.name, tt.deleted "
+                         "FROM sync_journal j "
+                         "LEFT JOIN topics tp ON j.entity = 0 AND tp.uuid = j.uuid "
+                         "LEFT JOIN tasks t ON j.entity = 1 AND t.uuid = j.uuid "
+                         "LEFT JOIN topics tt ON tt.id = t.topic_id "
+                         "LEFT JOIN sync_journal tj ON tj.entity = 0 AND tj.uuid = tt.uuid "
+                         "WHERE j.seq > :after ORDER BY j.seq LIMIT :limit");
+    applyingQuery.prepare("UPDATE sync_state SET applying = :applying");
+    clockQuery.prepare("UPDATE sync_state SET clock = MAX(clock, :clock)");
+    latestQuery.prepare("SELECT clock, origin FROM sync_journal WHERE entity = :entity AND uuid = :uuid");
+    recordQuery.prepare("INSERT OR REPLACE INTO sync_journal (entity, uuid, clock, origin, source) "
+                        "VALUES (:entity, :uuid, :clock, :origin, :source)");
+    topicQuery.prepare("SELECT id, deleted FROM topics WHERE uuid = :uuid");
+    clashQuery.prepare("SELECT id, uuid, deleted FROM topics WHERE name = :name AND uuid <> :uuid");
+    insertTopicQuery.prepare("INSERT INTO topics (uuid, name) VALUES (:uuid, :name)");
+    updateTopicQuery.prepare("UPDATE topics SET name = COALESCE(:name, name), deleted = :deleted WHERE id = :topic_id");
+    taskQuery.prepare("SELECT id FROM tasks WHERE uuid = :uuid");
+    insertTaskQuery.prepare("INSERT INTO tasks (uuid, topic_id, name, description, due_date, due_at, notify, notified, "
+                            "done, recurrence) "
+                            "VALUES (:uuid, :topic_id, :name, :description, :due_date, :due_at, :notify, :notified, "
+                            ":done, :recurrence)");
+    updateTaskQuery.prepare("UPDATE tasks SET "
+                            "topic_id = :topic_id, "
+                            "name = :name, "
+                            "description = :description, "
+                            "due_date = :due_date, "
+                            "notified = CASE WHEN due_at = :new_due_at THEN notified ELSE 0 END, "
+                            "due_at = :due_at, "
+                            "notify = :notify, "
+                            "done = :done, "
+                            "recurrence = :recurrence "
+                            "WHERE id = :task_id");
+    deleteTaskQuery.prepare("DELETE FROM tasks WHERE id = :task_id");
+}
+
+bool SyncJournal::exec(QSqlQuery &query)
+{
+    if (query.exec()) {
+        error.clear();
+        return true;
+    }
+    error = query.lastError().text();
+    return false;
+}
+
+QString SyncJournal::replica()
+{
+    QuerySpan span(stateQuery);
+    QString replica;
+    if (exec(stateQuery) && stateQuery.next()) replica = stateQuery.value(0).toString();
+    stateQuery.finish();
+    return replica;
+}
+
+// A copied database file carries its replica id along; the copy needs a
+// new one before it can sync with the original.
+bool SyncJournal::resetReplica()
+{
+    QuerySpan span(resetQuery);
+    return exec(resetQuery);
+}
+
+bool SyncJournal::cursor(const QString &peer, qint64 &sent, qint64 &received)
+{
+    sent = 0;
+    received = 0;
+    QuerySpan span(cursorQuery);
+    cursorQuery.bindValue(":peer", peer);
+    if (!exec(cursorQuery)) return false;
+    if (cursorQuery.next()) {
+        sent = cursorQuery.value(0).toLongLong();
+        received = cursorQuery.value(1).toLongLong();
+    }
+    cursorQuery.finish();
+    return true;
+}
+
+bool SyncJournal::addPeer(const QString &peer)
+{
+    QuerySpan span(addPeerQuery);
+    addPeerQuery.bindValue(":peer", peer);
+    return exec(addPeerQuery);
+}
+
+bool SyncJournal::setSent(const QString &peer, qint64 sequence)
+{
+    if (!addPeer(peer)) return false;
+    QuerySpan span(sentQuery);
+    sentQuery.bindValue(":sequence", sequence);
+    sentQuery.bindValue(":peer", peer);
+    return exec(sentQuery);
+}
+
+bool SyncJournal::setReceived(const QString &peer, qint64 sequence)
+{
+    if (!addPeer(peer)) return false;
+    QuerySpan span(receivedQuery);
+    receivedQuery.bindValue(":sequence", sequence);
+    receivedQuery.bindValue(":peer", peer);
+    return exec(receivedQuery);
+}
+
+bool SyncJournal::changesSince(const QString &peer, qint64 sequence, int limit, SyncBatch &batch)
+{
+    batch.replica = replica();
+    if (batch.replica.isEmpty()) return false;
+    batch.lastSequence = sequence;
+    batch.more = false;
+    batch.records.clear();
+    QuerySpan span(changesQuery);
+    changesQuery.bindValue(":after", sequence);
+    changesQuery.bindValue(":limit", limit);
+    if (!exec(changesQuery)) return false;
+    int rows = 0;
+    QSet<QByteArray> topicsSent;
+    while (changesQuery.next()) {
+        ++rows;
+        batch.lastSequence = changesQuery.value(0).toLongLong();
+        // The peer already has what it wrote itself or forwarded to us.
+        QString origin = changesQuery.value(4).toString();
+        if (origin == peer || changesQuery.value(5).toString() == peer) continue;
+        SyncRecord record;
+        record.entity = changesQuery.value(1).toInt();
+        record.uuid = changesQuery.value(2).toByteArray();
+        record.clock = changesQuery.value(3).toLongLong();
+        record.origin = origin;
+        if (record.entity == ChangeLog::TopicEntity) {
+            if (topicsSent.contains(record.uuid)) continue;
+            record.removed = changesQuery.value(6).isNull() || changesQuery.value(7).toInt() == 1;
+            record.name = changesQuery.value(6).toString();
+        } else {
+            record.removed = changesQuery.value(8).isNull();
+            record.topicUuid = changesQuery.value(9).toByteArray();
+            record.name = changesQuery.value(10).toString();
+            record.description = changesQuery.value(11).toString();
+            QDateTime dueDate = QDateTime::fromString(changesQuery.value(12).toString(), Qt::ISODate);
+            if (dueDate.isValid()) record.dueDate = dueDate.toSecsSinceEpoch();
+            if (!changesQuery.value(13).isNull()) record.dueAt = changesQuery.value(13).toLongLong();
+            record.notify = changesQuery.value(14).toInt() == 1;
+            record.done = changesQuery.value(15).toInt() == 1;
+            record.recurrence = changesQuery.value(16).toString();
+            // Rewriting a topic's entry moves it behind its tasks, possibly
+            // into a later batch, so such a topic travels with its first task.
+            if (!record.removed && changesQuery.value(17).toLongLong() > batch.lastSequence
+                && !topicsSent.contains(record.topicUuid)) {
+                topicsSent.insert(record.topicUuid);
+                QString topicOrigin = changesQuery.value(19).toString();
+                if (topicOrigin != peer && changesQuery.value(20).toString() != peer) {
+                    SyncRecord topic;
+                    topic.entity = ChangeLog::TopicEntity;
+                    topic.uuid = record.topicUuid;
+                    topic.clock = changesQuery.value(18).toLongLong();
+                    topic.origin = topicOrigin;
+                    topic.removed = changesQuery.value(22).toInt() == 1;
+                    if (!topic.removed) topic.name = changesQuery.value(21).toString();
+                    batch.records.append(topic);
+                }
+            }
+        }
+        if (record.removed) {
+            record.topicUuid.clear();
+            record.name.clear();
+            record.description.clear();
+        }
+        batch.records.append(record);
+    }
+    span.setRows(rows);
+    changesQuery.finish();
+    batch.more = rows >= limit;
+    return true;
+}
+
+// Entries are applied in one transaction with sync_state.applying set, so
+// the journal triggers stay quiet and each entry is recorded with the clock
+// and origin it was written with. The local clock then moves past the
+// newest clock seen, as Lamport clocks do on receive.
+bool SyncJournal::apply(const SyncBatch &batch, SyncResult &result)
+{
+    if (!db.transaction()) {
+        error = db.lastError().text();
+        return false;
+    }
+    applyingQuery.bindValue(":applying", 1);
+    bool ok = exec(applyingQuery);
+    qint64 clock = 0;
+    // Topics go first so tasks in the same batch find their topic.
+    for (int pass = ChangeLog::TopicEntity; ok && pass <= ChangeLog::TaskEntity; ++pass) {
+        for (const SyncRecord &entry : batch.records) {
+            if (entry.entity != pass) continue;
+            clock = qMax(clock, entry.clock);
+            bool newer = false;
+            if (!isNewer(entry, newer)) {
+                ok = false;
+                break;
+            }
+            if (!newer) {
+                ++result.skipped;
+                continue;
+            }
+            bool placed = true;
+            ok = pass == ChangeLog::TopicEntity ? applyTopic(entry) : applyTask(entry, placed);
+            if (ok && placed) ok = record(entry, batch.replica);
+            if (!ok) break;
+            if (placed) {
+                ++result.applied;
+            } else {
+                ++result.skipped;
+            }
+        }
+    }
+    if (ok) {
+        clockQuery.bindValue(":clock", clock);
+        ok = exec(clockQuery);
+    }
+    if (ok) {
+        applyingQuery.bindValue(":applying", 0);
+        ok = exec(applyingQuery);
+    }
+    if (ok && !db.commit()) {
+        error = db.lastError().text();
+        ok = false;
+    }
+    if (!ok) db.rollback();
+    return ok;
+}
+
+bool SyncJournal::isNewer(const SyncRecord &entry, bool &newer)
+{
+    QuerySpan span(latestQuery);
+    latestQuery.bindValue(":entity", entry.entity);
+    latestQuery.bindValue(":uuid", entry.uuid);
+    if (!exec(latestQuery)) return false;
+    newer = true;
+    if (latestQuery.next()) {
+        qint64 clock = latestQuery.value(0).toLongLong();
+        newer = entry.clock > clock || (entry.clock == clock && entry.origin > latestQuery.value(1).toString());
+    }
+    latestQuery.finish();
+    return true;
+}
+
+int SyncJournal::topicId(const QByteArray &uuid, bool &deleted)
+{
+    QuerySpan span(topicQuery);
+    topicQuery.bindValue(":uuid", uuid);
+    int id = -1;
+    if (exec(topicQuery) && topicQuery.next()) {
+        id = topicQuery.value(0).toInt();
+        deleted = topicQuery.value(1).toInt() == 1;
+    }
+    topicQuery.finish();
+    return id;
+}
+
+bool SyncJournal::setTopic(int topicId, const QVariant &name, bool deleted)
+{
+    QuerySpan span(updateTopicQuery);
+    updateTopicQuery.bindValue(":name", name);
+    updateTopicQuery.bindValue(":deleted", deleted ? 1 : 0);
+    updateTopicQuery.bindValue(":topic_id", topicId);
+    return exec(updateTopicQuery);
+}
+
+// A removed topic is only tombstoned; TopicDeleter clears out its tasks in
+// batches the next time the window starts.
+bool SyncJournal::applyTopic(const SyncRecord &entry)
+{
+    bool deleted = false;
+    int id = topicId(entry.uuid, deleted);
+    if (id < 0 && !error.isEmpty()) return false;
+    if (entry.removed) return id < 0 || setTopic(id, QVariant(), true);
+    int clashId = -1;
+    QByteArray clashUuid;
+    bool clashDeleted = false;
+    {
+        QuerySpan span(clashQuery);
+        clashQuery.bindValue(":name", entry.name);
+        clashQuery.bindValue(":uuid", entry.uuid);
+        if (!exec(clashQuery)) return false;
+        if (clashQuery.next()) {
+            clashId = clashQuery.value(0).toInt();
+            clashUuid = clashQuery.value(1).toByteArray();
+            clashDeleted = clashQuery.value(2).toInt() == 1;
+        }
+        clashQuery.finish();
+    }
+    // Two replicas created the same name independently. The topic with the
+    // greater uuid takes a suffix, so every replica ends up with the same
+    // names without writing anything back.
+    QString name = entry.name;
+    if (clashId >= 0) {
+        if (clashUuid > entry.uuid) {
+            if (!setTopic(clashId, suffixed(name, clashUuid), clashDeleted)) return false;
+        } else {
+            name = suffixed(name, entry.uuid);
+        }
+    }
+    if (id >= 0) return setTopic(id, name, false);
+    QuerySpan span(insertTopicQuery);
+    insertTopicQuery.bindValue(":uuid", entry.uuid);
+    insertTopicQuery.bindValue(":name", name);
+    return exec(insertTopicQuery);
+}
+
+bool SyncJournal::applyTask(const SyncRecord &entry, bool &placed)
+{
+    int id = -1;
+    {
+        QuerySpan span(taskQuery);
+        taskQuery.bindValue(":uuid", entry.uuid);
+        if (!exec(taskQuery)) return false;
+        if (taskQuery.next()) id = taskQuery.value(0).toInt();
+        taskQuery.finish();
+    }
+    if (entry.removed) {
+        if (id < 0) return true;
+        QuerySpan span(deleteTaskQuery);
+        deleteTaskQuery.bindValue(":task_id", id);
+        return exec(deleteTaskQuery);
+    }
+    bool deleted = false;
+    int topic = topicId(entry.topicUuid, deleted);
+    if (topic < 0 && !error.isEmpty()) return false;
+    // Senders put a task's topic in the same batch unless it reached us
+    // earlier, so a topic this replica has never journaled means the batch
+    // is incomplete. Failing keeps the cursor where it is instead of
+    // dropping the task; a topic that was purged here still has its entry.
+    if (topic < 0) {
+        QuerySpan span(latestQuery);
+        latestQuery.bindValue(":entity", ChangeLog::TopicEntity);
+        latestQuery.bindValue(":uuid", entry.topicUuid);
+        if (!exec(latestQuery)) return false;
+        deleted = latestQuery.next();
+        latestQuery.finish();
+        if (!deleted) {
+            error = "sync batch has a task whose topic is unknown";
+            return false;
+        }
+    }
+    // Removing the topic here wins over edits to its tasks elsewhere.
+    if (deleted) {
+        placed = false;
+        return true;
+    }
+    QVariant dueAt = entry.dueAt == TaskBrief::NoDue ? QVariant() : QVariant(entry.dueAt);
+    QSqlQuery &query = id < 0 ? insertTaskQuery : updateTaskQuery;
+    QuerySpan span(query);
+    if (id < 0) {
+        query.bindValue(":uuid", entry.uuid);
+        // Tasks already past due arrive as notified, so a first sync does not
+        // raise a burst of stale reminders.
+        query.bindValue(":notified", entry.dueAt <= QDateTime::currentSecsSinceEpoch() ? 1 : 0);
+    } else {
+        query.bindValue(":new_due_at", dueAt);
+        query.bindValue(":task_id", id);
+    }
+    query.bindValue(":topic_id", topic);
+    query.bindValue(":name", entry.name);
+    query.bindValue(":description", entry.description);
+    query.bindValue(":due_date", entry.dueDate == TaskBrief::NoDue
+                                     ? QVariant()
+                                     : QVariant(QDateTime::fromSecsSinceEpoch(entry.dueDate).toString(Qt::ISODate)));
+    query.bindValue(":due_at", dueAt);
+    query.bindValue(":notify", entry.notify ? 1 : 0);
+    query.bindValue(":done", entry.done ? 1 : 0);
+    query.bindValue(":recurrence", entry.recurrence.isEmpty() ? QVariant() : QVariant(entry.recurrence));
+    return exec(query);
+}
+
+bool SyncJournal::record(const SyncRecord &entry, const QString &source)
+{
+    QuerySpan span(recordQuery);
+    recordQuery.bindValue(":entity", entry.entity);
+    recordQuery.bindValue(":uuid", entry.uuid);
+    recordQuery.bindValue(":clock", entry.clock);
+    recordQuery.bindValue(":origin", entry.origin);
+    recordQuery.bindValue(":source", source);
+    return exec(recordQuery);
+}
@@ -0,0 +1,94 @@
+#ifndef SYNCJOURNAL_H
+#define SYNCJOURNAL_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVector>
+#include "changelog.h"
+#include "taskrepository.h"
+
+// The state of one topic or task as of its latest journal entry. Rows are
+// identified by uuid across replicas; a task names its topic by uuid too.
+struct SyncRecord
+{
+    int entity = ChangeLog::TaskEntity;
+    QByteArray uuid;
+    qint64 clock = 0;
+    QString origin;
+    bool removed = false;
+    QByteArray topicUuid;
+    QString name;
+    QString description;
+    qint64 dueDate = TaskBrief::NoDue;
+    qint64 dueAt = TaskBrief::NoDue;
+    bool notify = false;
+    bool done = false;
+    QString recurrence;
+};
+
+// Journal entries of one replica after a cursor. lastSequence is the
+// sender's position to resume from and more is set when the limit was hit.
+// A task whose topic entry comes later brings a copy of that entry along.
+struct SyncBatch
+{
+    QString replica;
+    qint64 lastSequence = 0;
+    bool more = false;
+    QVector<SyncRecord> records;
+};
+
+struct SyncResult
+{
+    int applied = 0;
+    int skipped = 0;
+};
+
+// Reads and applies the sync journal that migration 8 keeps for every write
+// to topics and tasks. Conflicts are settled per row by last writer wins on
+// the Lamport clock, with the origin replica id breaking ties, so every
+// replica picks the same version whatever order batches arrive in.
+class SyncJournal
+{
+public:
+    explicit SyncJournal(const QSqlDatabase &db);
+    QString replica();
+    bool resetReplica();
+    bool cursor(const QString &peer, qint64 &sent, qint64 &received);
+    bool setSent(const QString &peer, qint64 sequence);
+    bool setReceived(const QString &peer, qint64 sequence);
+    bool changesSince(const QString &peer, qint64 sequence, int limit, SyncBatch &batch);
+    bool apply(const SyncBatch &batch, SyncResult &result);
+    QString lastError() const { return error; }
+private:
+    QSqlDatabase db;
+    QSqlQuery stateQuery;
+    QSqlQuery resetQuery;
+    QSqlQuery cursorQuery;
+    QSqlQuery addPeerQuery;
+    QSqlQuery sentQuery;
+    QSqlQuery receivedQuery;
+    QSqlQuery changesQuery;
+    QSqlQuery applyingQuery;
+    QSqlQuery clockQuery;
+    QSqlQuery latestQuery;
+    QSqlQuery recordQuery;
+    QSqlQuery topicQuery;
+    QSqlQuery clashQuery;
+    QSqlQuery insertTopicQuery;
+    QSqlQuery updateTopicQuery;
+    QSqlQuery taskQuery;
+    QSqlQuery insertTaskQuery;
+    QSqlQuery updateTaskQuery;
+    QSqlQuery deleteTaskQuery;
+    QString error;
+    bool exec(QSqlQuery &query);
+    bool isNewer(const SyncRecord &entry, bool &newer);
+    int topicId(const QByteArray &uuid, bool &deleted);
+    bool setTopic(int topicId, const QVariant &name, bool deleted);
+    bool applyTopic(const SyncRecord &entry);
+    bool applyTask(const SyncRecord &entry, bool &placed);
+    bool record(const SyncRecord &entry, const QString &source);
+    bool addPeer(const QString &peer);
+};
+
+#endif // SYNCJOURNAL_H
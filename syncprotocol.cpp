@@ -0,0 +1,339 @@
+#include "syncprotocol.h"
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QIODevice>
+
+namespace {
+const quint32 Magic = 0x54535931;
+const quint32 MaxFrame = 64 * 1024 * 1024;
+const int BatchLimit = 2000;
+
+enum RecordFlag : quint8 {
+    TaskFlag = 0x01,
+    RemovedFlag = 0x02,
+    NotifyFlag = 0x04,
+    DoneFlag = 0x08,
+    DueDateFlag = 0x10,
+    DueAtFlag = 0x20,
+    DescriptionFlag = 0x40,
+    RecurrenceFlag = 0x80
+};
+
+QString readText(QDataStream &stream)
+{
+    QByteArray text;
+    stream >> text;
+    return QString::fromUtf8(text);
+}
+
+void writeBatch(QDataStream &stream, const SyncBatch &batch)
+{
+    QStringList origins;
+    QHash<QString, quint16> originIndex;
+    for (const SyncRecord &record : batch.records) {
+        if (originIndex.contains(record.origin)) continue;
+        originIndex.insert(record.origin, quint16(origins.size()));
+        origins.append(record.origin);
+    }
+    stream << batch.replica.toUtf8() << batch.lastSequence << batch.more << quint32(origins.size());
+    for (const QString &origin : std::as_const(origins)) stream << origin.toUtf8();
+    stream << quint32(batch.records.size());
+    for (const SyncRecord &record : batch.records) {
+        quint8 flags = 0;
+        if (record.entity == ChangeLog::TaskEntity) flags |= TaskFlag;
+        if (record.removed) flags |= RemovedFlag;
+        if (record.notify) flags |= NotifyFlag;
+        if (record.done) flags |= DoneFlag;
+        if (record.dueDate != TaskBrief::NoDue) flags |= DueDateFlag;
+        if (record.dueAt != TaskBrief::NoDue) flags |= DueAtFlag;
+        if (!record.description.isEmpty()) flags |= DescriptionFlag;
+        if (!record.recurrence.isEmpty()) flags |= RecurrenceFlag;
+        stream << flags << record.uuid << record.clock << originIndex.value(record.origin);
+        if (record.removed) continue;
+        if (flags & TaskFlag) stream << record.topicUuid;
+        stream << record.name.toUtf8();
+        if (flags & DescriptionFlag) stream << record.description.toUtf8();
+        if (flags & DueDateFlag) stream << record.dueDate;
+        if (flags & DueAtFlag) stream << record.dueAt;
+        if (flags & RecurrenceFlag) stream << record.recurrence.toUtf8();
+    }
+}
+
+bool readBatch(QDataStream &stream, SyncBatch &batch)
+{
+    quint32 count = 0;
+    batch.replica = readText(stream);
+    stream >> batch.lastSequence >> batch.more >> count;
+    QStringList origins;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) origins.append(readText(stream));
+    stream >> count;
+    if (stream.status() != QDataStream::Ok) return false;
+    batch.records.reserve(int(qMin<quint32>(count, BatchLimit)));
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        SyncRecord record;
+        quint8 flags = 0;
+        quint16 origin = 0;
+        stream >> flags >> record.uuid >> record.clock >> origin;
+        if (origin >= origins.size()) return false;
+        record.origin = origins.at(origin);
+        record.entity = (flags & TaskFlag) ? ChangeLog::TaskEntity : ChangeLog::TopicEntity;
+        record.removed = flags & RemovedFlag;
+        record.notify = flags & NotifyFlag;
+        record.done = flags & DoneFlag;
+        if (!record.removed) {
+            if (flags & TaskFlag) stream >> record.topicUuid;
+            record.name = readText(stream);
+            if (flags & DescriptionFlag) record.description = readText(stream);
+            if (flags & DueDateFlag) stream >> record.dueDate;
+            if (flags & DueAtFlag) stream >> record.dueAt;
+            if (flags & RecurrenceFlag) record.recurrence = readText(stream);
+        }
+        batch.records.append(record);
+    }
+    return stream.status() == QDataStream::Ok;
+}
+}
+
+QByteArray SyncProtocol::encode(const SyncMessage &message)
+{
+    QByteArray body;
+    {
+        QDataStream stream(&body, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_12);
+        stream << Magic << quint8(message.type);
+        switch (message.type) {
+        case SyncMessage::Hello:
+            stream << message.replica.toUtf8();
+            break;
+        case SyncMessage::Pull:
+            stream << message.sequence;
+            break;
+        case SyncMessage::Batch:
+            writeBatch(stream, message.batch);
+            break;
+        case SyncMessage::Ack:
+            stream << message.sequence << qint32(message.result.applied) << qint32(message.result.skipped);
+            break;
+        case SyncMessage::Error:
+            stream << message.error.toUtf8();
+            break;
+        }
+    }
+    QByteArray compressed = qCompress(body);
+    QByteArray frame;
+    QDataStream stream(&frame, QIODevice::WriteOnly);
+    stream << quint32(compressed.size());
+    stream.writeRawData(compressed.constData(), compressed.size());
+    return frame;
+}
+
+bool SyncProtocol::decode(const QByteArray &frame, SyncMessage &message)
+{
+    message = SyncMessage();
+    if (frame.size() < 4) return false;
+    quint32 size = 0;
+    {
+        QDataStream stream(frame);
+        stream >> size;
+    }
+    if (quint32(frame.size() - 4) != size) return false;
+    QByteArray body = qUncompress(frame.mid(4));
+    if (body.isEmpty()) return false;
+    QDataStream stream(body);
+    stream.setVersion(QDataStream::Qt_5_12);
+    quint32 magic = 0;
+    quint8 type = 0;
+    stream >> magic >> type;
+    if (magic != Magic) return false;
+    switch (type) {
+    case SyncMessage::Hello:
+        message.replica = readText(stream);
+        break;
+    case SyncMessage::Pull:
+        stream >> message.sequence;
+        break;
+    case SyncMessage::Batch:
+        if (!readBatch(stream, message.batch)) return false;
+        break;
+    case SyncMessage::Ack: {
+        qint32 applied = 0;
+        qint32 skipped = 0;
+        stream >> message.sequence >> applied >> skipped;
+        message.result.applied = applied;
+        message.result.skipped = skipped;
+        break;
+    }
+    case SyncMessage::Error:
+        message.error = readText(stream);
+        break;
+    default:
+        return false;
+    }
+    message.type = SyncMessage::Type(type);
+    return stream.status() == QDataStream::Ok;
+}
+
+// Returns false at end of input, on timeout, or on a frame too large to be
+// one of ours; frame is left empty only in the first case.
+bool SyncProtocol::readFrame(QIODevice *device, QByteArray &frame, int msecs)
+{
+    frame.clear();
+    qint64 size = 4;
+    while (frame.size() < size) {
+        QByteArray chunk = device->read(size - frame.size());
+        if (chunk.isEmpty()) {
+            if (!device->waitForReadyRead(msecs)) return false;
+            continue;
+        }
+        frame += chunk;
+        if (size == 4 && frame.size() == 4) {
+            quint32 length = 0;
+            QDataStream stream(frame);
+            stream >> length;
+            if (length > MaxFrame) return false;
+            size += length;
+        }
+    }
+    return true;
+}
+
+SyncServer::SyncServer(const QSqlDatabase &db)
+    : journal(db)
+{
+}
+
+QByteArray SyncServer::handle(const QByteArray &frame)
+{
+    SyncMessage request;
+    if (!SyncProtocol::decode(frame, request)) {
+        SyncMessage message;
+        message.error = "malformed sync frame";
+        return SyncProtocol::encode(message);
+    }
+    return SyncProtocol::encode(reply(request));
+}
+
+SyncMessage SyncServer::reply(const SyncMessage &request)
+{
+    SyncMessage message;
+    if (request.type != SyncMessage::Hello && peer.isEmpty()) {
+        message.error = "expected Hello";
+        return message;
+    }
+    switch (request.type) {
+    case SyncMessage::Hello:
+        peer = request.replica;
+        message.replica = journal.replica();
+        if (!message.replica.isEmpty()) message.type = SyncMessage::Hello;
+        break;
+    case SyncMessage::Pull:
+        if (journal.changesSince(peer, request.sequence, BatchLimit, message.batch)) message.type = SyncMessage::Batch;
+        break;
+    case SyncMessage::Batch:
+        if (journal.apply(request.batch, message.result)) {
+            message.type = SyncMessage::Ack;
+            message.sequence = request.batch.lastSequence;
+        }
+        break;
+    default:
+        message.error = "unexpected sync message";
+        return message;
+    }
+    if (message.type == SyncMessage::Error) message.error = journal.lastError();
+    return message;
+}
+
+bool SyncServer::serve(QIODevice *input, QIODevice *output)
+{
+    QByteArray frame;
+    while (SyncProtocol::readFrame(input, frame, -1)) {
+        QByteArray response = handle(frame);
+        if (output->write(response) != response.size()) return false;
+    }
+    return frame.isEmpty();
+}
+
+SyncClient::SyncClient(const QSqlDatabase &db)
+    : journal(db)
+{
+}
+
+bool SyncClient::request(const Transport &transport, const SyncMessage &message, SyncMessage::Type expected,
+                         SyncMessage &reply, SyncStats &stats)
+{
+    QByteArray frame = SyncProtocol::encode(message);
+    QByteArray response;
+    stats.bytesSent += frame.size();
+    if (!transport(frame, response)) {
+        stats.error = "sync peer did not answer";
+        return false;
+    }
+    stats.bytesReceived += response.size();
+    if (!SyncProtocol::decode(response, reply)) {
+        stats.error = "malformed reply from sync peer";
+        return false;
+    }
+    if (reply.type != expected) {
+        stats.error = reply.type == SyncMessage::Error ? reply.error : "unexpected reply from sync peer";
+        return false;
+    }
+    return true;
+}
+
+SyncStats SyncClient::run(const Transport &transport)
+{
+    QElapsedTimer timer;
+    timer.start();
+    SyncStats stats;
+    auto finish = [&](const QString &error) {
+        stats.ok = error.isEmpty();
+        stats.error = error;
+        stats.elapsedMs = timer.elapsed();
+        return stats;
+    };
+    stats.replica = journal.replica();
+    if (stats.replica.isEmpty()) return finish(journal.lastError());
+    SyncMessage message;
+    SyncMessage reply;
+    message.type = SyncMessage::Hello;
+    message.replica = stats.replica;
+    if (!request(transport, message, SyncMessage::Hello, reply, stats)) return finish(stats.error);
+    stats.peer = reply.replica;
+    if (stats.peer == stats.replica) {
+        return finish("both databases are replica " + stats.replica + "; give the copy a new id with --new-replica");
+    }
+    qint64 sent = 0;
+    qint64 received = 0;
+    if (!journal.cursor(stats.peer, sent, received)) return finish(journal.lastError());
+
+    message.type = SyncMessage::Pull;
+    do {
+        message.sequence = received;
+        if (!request(transport, message, SyncMessage::Batch, reply, stats)) return finish(stats.error);
+        if (!journal.apply(reply.batch, stats.local) || !journal.setReceived(stats.peer, reply.batch.lastSequence)) {
+            return finish(journal.lastError());
+        }
+        stats.pulled += reply.batch.records.size();
+        received = reply.batch.lastSequence;
+    } while (reply.batch.more);
+
+    message.type = SyncMessage::Batch;
+    forever {
+        if (!journal.changesSince(stats.peer, sent, BatchLimit, message.batch)) return finish(journal.lastError());
+        if (message.batch.lastSequence == sent) break;
+        // Entries the peer wrote or forwarded only move the cursor.
+        if (message.batch.records.isEmpty()) {
+            sent = message.batch.lastSequence;
+        } else {
+            if (!request(transport, message, SyncMessage::Ack, reply, stats)) return finish(stats.error);
+            stats.pushed += message.batch.records.size();
+            stats.remote.applied += reply.result.applied;
+            stats.remote.skipped += reply.result.skipped;
+            sent = reply.sequence;
+        }
+        if (!journal.setSent(stats.peer, sent)) return finish(journal.lastError());
+        if (!message.batch.more) break;
+    }
+    return finish(QString());
+}
@@ -0,0 +1,77 @@
+#ifndef SYNCPROTOCOL_H
+#define SYNCPROTOCOL_H
+
+#include <QSqlDatabase>
+#include "syncjournal.h"
+#include <functional>
+
+class QIODevice;
+
+// One request or reply between two replicas. A client says Hello, pulls
+// Batches after its cursor until none are left, then pushes its own and
+// gets an Ack for each.
+struct SyncMessage
+{
+    enum Type : quint8 { Hello = 1, Pull, Batch, Ack, Error };
+    Type type = Error;
+    QString replica;
+    qint64 sequence = 0;
+    SyncResult result;
+    SyncBatch batch;
+    QString error;
+};
+
+// Messages travel as frames: a 32-bit length, then a zlib-compressed
+// QDataStream body. Uuids go as raw bytes, strings as UTF-8, and origin ids
+// once per batch with records pointing into that table.
+namespace SyncProtocol {
+QByteArray encode(const SyncMessage &message);
+bool decode(const QByteArray &frame, SyncMessage &message);
+bool readFrame(QIODevice *device, QByteArray &frame, int msecs = 30000);
+}
+
+struct SyncStats
+{
+    bool ok = false;
+    QString error;
+    QString replica;
+    QString peer;
+    int pulled = 0;
+    int pushed = 0;
+    SyncResult local;
+    SyncResult remote;
+    qint64 bytesSent = 0;
+    qint64 bytesReceived = 0;
+    qint64 elapsedMs = 0;
+};
+
+// Answers sync requests against one database. It keeps no state per client
+// beyond the journal: every cursor lives with the client.
+class SyncServer
+{
+public:
+    explicit SyncServer(const QSqlDatabase &db);
+    QByteArray handle(const QByteArray &frame);
+    bool serve(QIODevice *input, QIODevice *output);
+private:
+    SyncJournal journal;
+    QString peer;
+    SyncMessage reply(const SyncMessage &request);
+};
+
+// Runs one exchange with a peer over a transport that sends a request frame
+// and returns the reply frame: pull the peer's changes since the last
+// received cursor, then push ours since the last sent one.
+class SyncClient
+{
+public:
+    using Transport = std::function<bool(const QByteArray &request, QByteArray &reply)>;
+    explicit SyncClient(const QSqlDatabase &db);
+    SyncStats run(const Transport &transport);
+private:
+    SyncJournal journal;
+    bool request(const Transport &transport, const SyncMessage &message, SyncMessage::Type expected,
+                 SyncMessage &reply, SyncStats &stats);
+};
+
+#endif // SYNCPROTOCOL_H
@@ -1,12 +1,54 @@
 #include "taskdialog.h"
 #include "ui_taskdialog.h"
+#include "topiclistmodel.h"
+#include "topicindex.h"
+#include <QCheckBox>
+#include <QCompleter>
+#include <QLineEdit>
+#include <QListView>
+#include <QLocale>
+#include <QMessageBox>
+#include <utility>
 
-TaskDialog::TaskDialog(const QStringList &topics, QWidget *parent)
-    : QDialog(parent), ui(new Ui::TaskDialog)
+namespace {
+const int PreviewCount = 3;
+enum EndMode { EndNever, EndAfterCount, EndOnDate };
+}
+
+TaskDialog::TaskDialog(TopicIndex *topics, QWidget *parent)
+    : QDialog(parent), ui(new Ui::TaskDialog), topics(topics), topicModel(new TopicListModel(topics, this)),
+      completionModel(new TopicListModel(topics, this))
 {
     ui->setupUi(this);
-    ui->comboBoxTopic->addItems(topics);
+    // The combo reads the shared index instead of copying every topic name,
+    // and completion narrows a second view of it with a binary search.
+    ui->comboBoxTopic->setModel(topicModel);
+    ui->comboBoxTopic->setEditable(true);
+    ui->comboBoxTopic->setInsertPolicy(QComboBox::NoInsert);
+    ui->comboBoxTopic->setSizeAdjustPolicy(QComboBox::AdjustToMinimumContentsLengthWithIcon);
+    ui->comboBoxTopic->setMinimumContentsLength(20);
+    if (QListView *view = qobject_cast<QListView *>(ui->comboBoxTopic->view())) view->setUniformItemSizes(true);
+    connect(ui->comboBoxTopic->lineEdit(), &QLineEdit::textEdited, completionModel, &TopicListModel::setPrefix);
+    QCompleter *completer = new QCompleter(completionModel, this);
+    completer->setCaseSensitivity(Qt::CaseInsensitive);
+    completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    ui->comboBoxTopic->setCompleter(completer);
     ui->dateTimeEditDue->setDateTime(QDateTime::currentDateTime());
+    const QStringList dayNames = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+    for (const QString &name : dayNames) {
+        QCheckBox *box = new QCheckBox(name, this);
+        ui->horizontalLayoutDays->addWidget(box);
+        dayBoxes.append(box);
+        connect(box, &QCheckBox::toggled, this, &TaskDialog::updateRecurrenceControls);
+    }
+    ui->dateEditUntil->setDate(QDate::currentDate().addMonths(3));
+    connect(ui->comboBoxRepeat, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &TaskDialog::updateRecurrenceControls);
+    connect(ui->comboBoxEnds, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &TaskDialog::updateRecurrenceControls);
+    connect(ui->spinBoxInterval, QOverload<int>::of(&QSpinBox::valueChanged), this, &TaskDialog::updateRecurrenceControls);
+    connect(ui->spinBoxCount, QOverload<int>::of(&QSpinBox::valueChanged), this, &TaskDialog::updateRecurrenceControls);
+    connect(ui->dateEditUntil, &QDateEdit::dateChanged, this, &TaskDialog::updateRecurrenceControls);
+    connect(ui->dateTimeEditDue, &QDateTimeEdit::dateTimeChanged, this, &TaskDialog::updateRecurrenceControls);
+    updateRecurrenceControls();
 }
 
 TaskDialog::~TaskDialog()
@@ -24,15 +66,103 @@ bool TaskDialog::notifyEnabled() const { return ui->checkBoxNotify->isChecked();
 
 QString TaskDialog::description() const { return ui->textEditDescription->toPlainText(); }
 
+QString TaskDialog::recurrence() const { return currentRule().toRule(); }
+
 void TaskDialog::setTaskName(const QString &name) { ui->lineEditTaskName->setText(name); }
 
 void TaskDialog::setTopic(const QString &topic) {
-    int index = ui->comboBoxTopic->findText(topic);
+    int index = topicModel->rowForName(topic);
     if (index >= 0) ui->comboBoxTopic->setCurrentIndex(index);
 }
 
+// The combo is editable, so its text may differ from every topic only in case
+// or be a prefix the completer was still narrowing; both resolve to the one
+// topic they can mean.
+QString TaskDialog::resolveTopic(const QString &text) const
+{
+    if (topics->find(text) >= 0) return text;
+    std::pair<int, int> range = topics->prefixRange(text);
+    if (range.first == range.second) return QString();
+    // A name equal to the prefix sorts first among those starting with it.
+    const QString &first = topics->at(range.first).name;
+    if (first.compare(text, Qt::CaseInsensitive) == 0 || range.second - range.first == 1) return first;
+    return QString();
+}
+
+void TaskDialog::accept()
+{
+    QString text = ui->comboBoxTopic->currentText();
+    QString name = text.trimmed().isEmpty() ? QString() : resolveTopic(text);
+    if (name.isEmpty()) {
+        QMessageBox::warning(this, "Warning", text.isEmpty() ? QString("Choose a topic for the task")
+                                                             : "There is no topic named '" + text + "'");
+        ui->comboBoxTopic->setFocus();
+        return;
+    }
+    setTopic(name);
+    QDialog::accept();
+}
+
 void TaskDialog::setDueDate(const QDateTime &dateTime) { ui->dateTimeEditDue->setDateTime(dateTime); }
 
 void TaskDialog::setNotifyEnabled(bool enabled) { ui->checkBoxNotify->setChecked(enabled); }
 
 void TaskDialog::setDescription(const QString &desc) { ui->textEditDescription->setPlainText(desc); }
+
+
+void TaskDialog::setRecurrence(const QString &rule)
+{
+    Recurrence recurrence = Recurrence::fromRule(rule);
+    ui->comboBoxRepeat->setCurrentIndex(recurrence.frequency());
+    ui->spinBoxInterval->setValue(recurrence.interval());
+    for (int day = 0; day < dayBoxes.size(); ++day) dayBoxes.at(day)->setChecked(recurrence.weekdays() & (1 << day));
+    if (recurrence.count() > 0) {
+        ui->comboBoxEnds->setCurrentIndex(EndAfterCount);
+        ui->spinBoxCount->setValue(recurrence.count());
+    } else if (recurrence.until().isValid()) {
+        ui->comboBoxEnds->setCurrentIndex(EndOnDate);
+        ui->dateEditUntil->setDate(recurrence.until());
+    } else {
+        ui->comboBoxEnds->setCurrentIndex(EndNever);
+    }
+}
+
+Recurrence TaskDialog::currentRule() const
+{
+    Recurrence rule;
+    rule.setFrequency(static_cast<Recurrence::Frequency>(ui->comboBoxRepeat->currentIndex()));
+    rule.setInterval(ui->spinBoxInterval->value());
+    int days = 0;
+    for (int day = 0; day < dayBoxes.size(); ++day) {
+        if (dayBoxes.at(day)->isChecked()) days |= 1 << day;
+    }
+    rule.setWeekdays(days);
+    if (ui->comboBoxEnds->currentIndex() == EndAfterCount) rule.setCount(ui->spinBoxCount->value());
+    if (ui->comboBoxEnds->currentIndex() == EndOnDate) rule.setUntil(ui->dateEditUntil->date());
+    return rule;
+}
+
+// Only the next few occurrences are computed, however long the series runs.
+void TaskDialog::updateRecurrenceControls()
+{
+    Recurrence rule = currentRule();
+    bool repeats = rule.isRecurring();
+    int ends = ui->comboBoxEnds->currentIndex();
+    ui->labelEvery->setEnabled(repeats);
+    ui->spinBoxInterval->setEnabled(repeats);
+    for (QCheckBox *box : std::as_const(dayBoxes)) box->setVisible(rule.frequency() == Recurrence::Weekly);
+    ui->labelEnds->setVisible(repeats);
+    ui->comboBoxEnds->setVisible(repeats);
+    ui->spinBoxCount->setVisible(repeats && ends == EndAfterCount);
+    ui->dateEditUntil->setVisible(repeats && ends == EndOnDate);
+    if (!repeats) {
+        ui->labelOccurrences->clear();
+        return;
+    }
+    QDateTime now = QDateTime::currentDateTime();
+    const QVector<QDateTime> upcoming = rule.between(dueDate(), now, now.addYears(100), PreviewCount);
+    QStringList dates;
+    for (const QDateTime &occurrence : upcoming) dates << QLocale().toString(occurrence, QLocale::ShortFormat);
+    ui->labelOccurrences->setText(rule.describe() + "\n"
+                                  + (dates.isEmpty() ? QString("No further occurrences") : "Next: " + dates.join(", ")));
+}
@@ -1,24 +1,38 @@
 #ifndef TASKDIALOG_H
 #define TASKDIALOG_H
 #include <QDialog>
+#include "recurrence.h"
+class QCheckBox;
+class TopicIndex;
+class TopicListModel;
 namespace Ui { class TaskDialog; }
 class TaskDialog : public QDialog
 {
     Q_OBJECT
 public:
-    explicit TaskDialog(const QStringList &topics, QWidget *parent = nullptr);
+    explicit TaskDialog(TopicIndex *topics, QWidget *parent = nullptr);
     ~TaskDialog();
     QString taskName() const;
     QString topic() const;
     QDateTime dueDate() const;
     bool notifyEnabled() const;
     QString description() const;
+    QString recurrence() const;
     void setTaskName(const QString &name);
     void setTopic(const QString &topic);
     void setDueDate(const QDateTime &dateTime);
     void setNotifyEnabled(bool enabled);
     void setDescription(const QString &desc);
+    void setRecurrence(const QString &rule);
+    void accept() override;
 private:
+    Recurrence currentRule() const;
+    QString resolveTopic(const QString &text) const;
+    void updateRecurrenceControls();
     Ui::TaskDialog *ui;
+    TopicIndex *topics;
+    TopicListModel *topicModel;
+    TopicListModel *completionModel;
+    QList<QCheckBox *> dayBoxes;
 };
 #endif
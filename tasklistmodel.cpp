@@ -0,0 +1,294 @@
+#include "tasklistmodel.h"
+#include "databaseworker.h"
+#include <algorithm>
+
+namespace {
+const int PageSize = 256;
+const int PrefetchPages = 2;
+
+TaskListModel::TaskPage fetchPage(TaskRepository &tasks, int topicId, int afterId)
+{
+    TaskListModel::TaskPage page;
+    page.topicId = topicId;
+    const QVector<TaskRecord> records = tasks.page(topicId, afterId, PageSize);
+    for (const TaskRecord &task : records) {
+        page.rows.append({task.id, task.done, task.name, true});
+    }
+    return page;
+}
+}
+
+TaskListModel::TaskListModel(DatabaseWorker *worker, QObject *parent)
+    : QAbstractListModel(parent), worker(worker)
+{
+}
+
+void TaskListModel::setTopic(const QString &topic)
+{
+    beginResetModel();
+    ++generation;
+    currentTopic = topic;
+    topicId = -1;
+    exhausted = true;
+    fetching = false;
+    firstVisiblePage = 0;
+    lastVisiblePage = 0;
+    rows.clear();
+    loadedPages.clear();
+    pendingPages.clear();
+    endResetModel();
+    worker->cancel("tasks.fetch");
+    if (topic.isEmpty()) {
+        worker->cancel("tasks.topic");
+        emit topicLoaded();
+        return;
+    }
+    fetching = true;
+    int requestGeneration = generation;
+    worker->post("tasks.topic", [topic](DatabaseSession &session) {
+        int topicId = session.topics().idForName(topic);
+        if (topicId < 0) return TaskPage();
+        return fetchPage(session.tasks(), topicId, 0);
+    }, this, [this, requestGeneration](const TaskPage &page) {
+        if (requestGeneration != generation) return;
+        fetching = false;
+        topicId = page.topicId;
+        exhausted = topicId < 0;
+        appendPage(page);
+        emit topicLoaded();
+    });
+}
+
+int TaskListModel::taskId(int row) const
+{
+    if (row < 0 || row >= rows.size()) return -1;
+    return rows.at(row).id;
+}
+
+int TaskListModel::lowerBound(int taskId) const
+{
+    auto it = std::lower_bound(rows.cbegin(), rows.cend(), taskId, [](const TaskRow &row, int id) {
+        return row.id < id;
+    });
+    return int(it - rows.cbegin());
+}
+
+int TaskListModel::rowForTask(int taskId) const
+{
+    int row = lowerBound(taskId);
+    return (row < rows.size() && rows.at(row).id == taskId) ? row : -1;
+}
+
+void TaskListModel::insertTask(int taskId, const QString &name, bool done)
+{
+    if (topicId < 0) return;
+    // Rows beyond the loaded range arrive with the next fetchMore.
+    if (!exhausted && (rows.isEmpty() || taskId > rows.last().id)) return;
+    int row = lowerBound(taskId);
+    if (row < rows.size() && rows.at(row).id == taskId) {
+        updateTask(taskId, name);
+        setTaskDone(taskId, done);
+        return;
+    }
+    beginInsertRows(QModelIndex(), row, row);
+    rows.insert(row, {taskId, done, name, true});
+    endInsertRows();
+}
+
+void TaskListModel::updateTask(int taskId, const QString &name)
+{
+    int row = rowForTask(taskId);
+    if (row < 0) return;
+    TaskRow &task = rows[row];
+    task.name = name;
+    task.named = true;
+    emit dataChanged(index(row), index(row), {Qt::DisplayRole});
+}
+
+void TaskListModel::setTaskDone(int taskId, bool done)
+{
+    int row = rowForTask(taskId);
+    if (row < 0 || rows.at(row).done == done) return;
+    rows[row].done = done;
+    emit dataChanged(index(row), index(row), {Qt::CheckStateRole});
+}
+
+void TaskListModel::removeTask(int taskId)
+{
+    int row = rowForTask(taskId);
+    if (row < 0) return;
+    beginRemoveRows(QModelIndex(), row, row);
+    rows.remove(row);
+    endRemoveRows();
+}
+
+void TaskListModel::renameTopic(const QString &topic)
+{
+    currentTopic = topic;
+    if (!rows.isEmpty()) emit dataChanged(index(0), index(rows.size() - 1), {TopicNameRole});
+}
+
+void TaskListModel::setVisibleRange(int first, int last)
+{
+    if (rows.isEmpty()) return;
+    first = qBound(0, first, rows.size() - 1);
+    last = qBound(first, last, rows.size() - 1);
+    firstVisiblePage = first / PageSize;
+    lastVisiblePage = last / PageSize;
+    evictPages();
+    int lastPage = (rows.size() - 1) / PageSize;
+    int from = qMax(0, firstVisiblePage - PrefetchPages);
+    int to = qMin(lastPage, lastVisiblePage + PrefetchPages);
+    for (int page = from; page <= to; ++page) {
+        if (!loadedPages.contains(page)) requestPage(page);
+    }
+}
+
+int TaskListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows.size();
+}
+
+QVariant TaskListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size()) return QVariant();
+    const TaskRow &row = rows.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return taskName(index.row());
+    case Qt::CheckStateRole:
+        return row.done ? Qt::Checked : Qt::Unchecked;
+    case TaskIdRole:
+        return row.id;
+    case TopicNameRole:
+        return currentTopic;
+    default:
+        return QVariant();
+    }
+}
+
+bool TaskListModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::CheckStateRole || !index.isValid() || index.row() >= rows.size()) return false;
+    bool done = static_cast<Qt::CheckState>(value.toInt()) == Qt::Checked;
+    TaskRow &row = rows[index.row()];
+    if (row.done == done) return true;
+    row.done = done;
+    emit dataChanged(index, index, {Qt::CheckStateRole});
+    emit taskCheckStateChanged(row.id, done);
+    return true;
+}
+
+Qt::ItemFlags TaskListModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+    return QAbstractListModel::flags(index) | Qt::ItemIsUserCheckable;
+}
+
+bool TaskListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !exhausted && !fetching;
+}
+
+void TaskListModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || exhausted || fetching) return;
+    fetching = true;
+    int requestGeneration = generation;
+    int topic = topicId;
+    int afterId = rows.isEmpty() ? 0 : rows.last().id;
+    worker->post("tasks.fetch", [topic, afterId](DatabaseSession &session) {
+        return fetchPage(session.tasks(), topic, afterId);
+    }, this, [this, requestGeneration](const TaskPage &page) {
+        if (requestGeneration != generation) return;
+        fetching = false;
+        appendPage(page);
+    });
+}
+
+void TaskListModel::appendPage(const TaskPage &page)
+{
+    if (page.rows.size() < PageSize) exhausted = true;
+    if (page.rows.isEmpty()) return;
+    int first = rows.size();
+    int last = first + page.rows.size() - 1;
+    // Tasks inserted locally may already be present at the tail.
+    int skip = 0;
+    while (skip < page.rows.size() && !rows.isEmpty() && page.rows.at(skip).id <= rows.last().id) ++skip;
+    if (skip == page.rows.size()) return;
+    last -= skip;
+    beginInsertRows(QModelIndex(), first, last);
+    rows += page.rows.mid(skip);
+    for (int p = first / PageSize; p <= last / PageSize; ++p) loadedPages.insert(p);
+    endInsertRows();
+}
+
+QString TaskListModel::taskName(int row) const
+{
+    const TaskRow &task = rows.at(row);
+    if (!task.named) requestPage(row / PageSize);
+    return task.name;
+}
+
+void TaskListModel::requestPage(int page) const
+{
+    if (pendingPages.contains(page)) return;
+    int first = page * PageSize;
+    int last = qMin(first + PageSize, rows.size()) - 1;
+    if (first > last) return;
+    QVector<int> ids;
+    ids.reserve(last - first + 1);
+    for (int row = first; row <= last; ++row) ids.append(rows.at(row).id);
+    pendingPages.insert(page);
+    TaskListModel *self = const_cast<TaskListModel *>(this);
+    int requestGeneration = generation;
+    int topic = topicId;
+    worker->post(QString(), [topic, ids](DatabaseSession &session) {
+        return session.tasks().names(topic, ids);
+    }, self, [self, requestGeneration, page, ids](const QStringList &names) {
+        if (requestGeneration != self->generation) return;
+        self->pendingPages.remove(page);
+        self->loadedPages.insert(page);
+        self->applyNames(ids, names);
+    });
+}
+
+void TaskListModel::applyNames(const QVector<int> &ids, const QStringList &names)
+{
+    // Rows may have shifted since the request, so names are matched by id.
+    int row = lowerBound(ids.value(0));
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < ids.size() && row < rows.size(); ++i) {
+        while (row < rows.size() && rows.at(row).id < ids.at(i)) ++row;
+        if (row >= rows.size() || rows.at(row).id != ids.at(i)) continue;
+        TaskRow &task = rows[row];
+        if (!task.named) {
+            task.name = names.value(i);
+            task.named = true;
+            if (first < 0) first = row;
+            last = row;
+        }
+        ++row;
+    }
+    if (first >= 0) emit dataChanged(index(first), index(last), {Qt::DisplayRole});
+}
+
+void TaskListModel::evictPages()
+{
+    int from = firstVisiblePage - PrefetchPages;
+    int to = lastVisiblePage + PrefetchPages;
+    for (auto it = loadedPages.begin(); it != loadedPages.end();) {
+        int page = *it;
+        if (page >= from && page <= to) {
+            ++it;
+            continue;
+        }
+        int last = qMin((page + 1) * PageSize, rows.size());
+        for (int row = page * PageSize; row < last; ++row) {
+            rows[row].name = QString();
+            rows[row].named = false;
+        }
+        it = loadedPages.erase(it);
+    }
+}
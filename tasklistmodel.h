@@ -0,0 +1,66 @@
+#ifndef TASKLISTMODEL_H
+#define TASKLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+class DatabaseWorker;
+
+class TaskListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles { TaskIdRole = Qt::UserRole, TopicNameRole };
+    struct TaskRow {
+        int id;
+        bool done;
+        QString name;
+        bool named;
+    };
+    struct TaskPage {
+        int topicId = -1;
+        QVector<TaskRow> rows;
+    };
+    explicit TaskListModel(DatabaseWorker *worker, QObject *parent = nullptr);
+    void setTopic(const QString &topic);
+    QString topic() const { return currentTopic; }
+    int taskId(int row) const;
+    int rowForTask(int taskId) const;
+    void insertTask(int taskId, const QString &name, bool done);
+    void updateTask(int taskId, const QString &name);
+    void setTaskDone(int taskId, bool done);
+    void removeTask(int taskId);
+    void renameTopic(const QString &topic);
+    void setVisibleRange(int first, int last);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+signals:
+    void taskCheckStateChanged(int taskId, bool done);
+    void topicLoaded();
+private:
+    QString taskName(int row) const;
+    int lowerBound(int taskId) const;
+    void requestPage(int page) const;
+    void applyNames(const QVector<int> &ids, const QStringList &names);
+    void appendPage(const TaskPage &page);
+    void evictPages();
+    DatabaseWorker *worker;
+    QString currentTopic;
+    int topicId = -1;
+    int generation = 0;
+    bool exhausted = true;
+    bool fetching = false;
+    int firstVisiblePage = 0;
+    int lastVisiblePage = 0;
+    QVector<TaskRow> rows;
+    QSet<int> loadedPages;
+    mutable QSet<int> pendingPages;
+};
+
+#endif // TASKLISTMODEL_H
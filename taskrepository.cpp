@@ -0,0 +1,644 @@
+#include "taskrepository.h"
+#include "querytrace.h"
+#include "recurrence.h"
+#include <QSqlError>
+#include <algorithm>
+
+namespace {
+QVariant dateValue(const QDateTime &date)
+{
+    return date.isValid() ? QVariant(date.toString(Qt::ISODate)) : QVariant();
+}
+}
+
+TaskRepository::TaskRepository(const QSqlDatabase &db)
+    : db(db), pageQuery(db), namesQuery(db), findQuery(db), descriptionQuery(db), insertQuery(db),
+      updateQuery(db), deleteQuery(db), deadlinesQuery(db),
+      dueQuery(db), dueBetweenQuery(db), markNotifiedQuery(db), markDueNotifiedQuery(db), searchQuery(db), exportQuery(db), clearSelectionQuery(db), selectQuery(db), bulkDoneQuery(db), bulkDeleteQuery(db),
+      bulkMoveQuery(db), bulkRescheduleQuery(db), removeBatchQuery(db), countQuery(db),
+      recurrenceQuery(db), seriesQuery(db), seriesBetweenQuery(db), occurrencesQuery(db), recordOccurrenceQuery(db),
+      advanceQuery(db), scanQuery(db), briefsQuery(db), hasFullText(false)
+{
+    pageQuery.prepare("SELECT id, name, done FROM tasks "
+                      "WHERE topic_id = :topic_id AND id > :after "
+                      "ORDER BY id LIMIT :limit");
+    namesQuery.prepare("SELECT id, name FROM tasks "
+                       "WHERE topic_id = :topic_id AND id BETWEEN :first AND :last "
+                       "ORDER BY id");
+    findQuery.prepare("SELECT t.topic_id, tp.name, t.name, t.description, t.due_date, t.notify, t.notified, t.done, "
+                      "t.recurrence "
+                      "FROM tasks t JOIN topics tp ON t.topic_id = tp.id "
+                      "WHERE t.id = :task_id");
+    descriptionQuery.prepare("SELECT description FROM tasks WHERE id = :task_id");
+    insertQuery.prepare("INSERT INTO tasks (topic_id, name, description, due_date, due_at, notify, notified, done, recurrence) "
+                        "VALUES (:topic_id, :name, :description, :due_date, :due_at, :notify, :notified, :done, :recurrence)");
+    updateQuery.prepare("UPDATE tasks SET "
+                        "name = :name, "
+                        "topic_id = :topic_id, "
+                        "description = :description, "
+                        "due_date = :due_date, "
+                        "notified = CASE WHEN due_at = :new_due_at THEN notified ELSE 0 END, "
+                        "due_at = :due_at, "
+                        "notify = :notify, "
+                        "recurrence = :recurrence "
+                        "WHERE id = :task_id");
+    deleteQuery.prepare("DELETE FROM tasks WHERE id = :task_id");
+    // Tasks behind a topic tombstone are neither scheduled nor marked, the
+    // same as dueQuery leaves them out.
+    deadlinesQuery.prepare("SELECT t.id, t.due_at FROM tasks t "
+                           "JOIN topics tp ON t.topic_id = tp.id AND tp.deleted = 0 "
+                           "WHERE t.notify = 1 AND t.notified = 0 AND t.due_at IS NOT NULL "
+                           "ORDER BY t.due_at, t.id LIMIT :limit");
+    dueQuery.prepare("SELECT t.id, t.name, tp.name, t.due_date, t.due_at, t.recurrence FROM tasks t "
+                     "JOIN topics tp ON t.topic_id = tp.id AND tp.deleted = 0 "
+                     "WHERE t.notify = 1 AND t.notified = 0 AND t.due_at <= :now");
+    dueBetweenQuery.prepare("SELECT t.id, t.topic_id, tp.name, t.name, t.due_date, t.notify, t.notified FROM tasks t "
+                            "JOIN topics tp ON t.topic_id = tp.id AND tp.deleted = 0 "
+                            "WHERE t.done = 0 AND t.recurrence IS NULL AND t.due_at >= :from AND t.due_at < :to "
+                            "ORDER BY t.due_at, t.id LIMIT :limit");
+    seriesBetweenQuery.prepare("SELECT t.id, t.topic_id, tp.name, t.name, t.due_date, t.notify, t.notified, "
+                               "t.recurrence, t.due_at FROM tasks t "
+                               "JOIN topics tp ON t.topic_id = tp.id AND tp.deleted = 0 "
+                               "WHERE t.done = 0 AND t.recurrence IS NOT NULL AND t.due_at < :to");
+    markNotifiedQuery.prepare("UPDATE tasks SET notified = 1 WHERE id = :task_id");
+    markDueNotifiedQuery.prepare("UPDATE tasks SET notified = 1 "
+                                 "WHERE notify = 1 AND notified = 0 AND due_at <= :now "
+                                 "AND topic_id IN (SELECT id FROM topics WHERE deleted = 0)");
+    exportQuery.setForwardOnly(true);
+    exportQuery.prepare("SELECT tp.id, tp.name, t.id, t.name, t.description, t.due_date, t.notify, t.notified, t.done, "
+                        "t.recurrence "
+                        "FROM topics tp LEFT JOIN tasks t ON t.topic_id = tp.id "
+                        "WHERE tp.deleted = 0 "
+                        "ORDER BY tp.id, t.id");
+    scanQuery.setForwardOnly(true);
+    scanQuery.prepare("SELECT t.id, t.topic_id, t.name, t.due_at, t.done FROM tasks t "
+                      "JOIN topics tp ON tp.id = t.topic_id AND tp.deleted = 0 "
+                      "ORDER BY t.id");
+    removeBatchQuery.prepare("DELETE FROM tasks WHERE id IN "
+                             "(SELECT id FROM tasks WHERE topic_id = :topic_id LIMIT :limit)");
+    countQuery.prepare("SELECT COUNT(*) FROM tasks WHERE topic_id = :topic_id");
+    recurrenceQuery.prepare("SELECT due_date, recurrence, due_at FROM tasks WHERE id = :task_id");
+    occurrencesQuery.prepare("SELECT occurs_at FROM task_occurrences "
+                             "WHERE task_id = :task_id AND occurs_at >= :from AND occurs_at < :to");
+    recordOccurrenceQuery.prepare("INSERT OR REPLACE INTO task_occurrences (task_id, occurs_at, state) "
+                                  "VALUES (:task_id, :occurs_at, :state)");
+    advanceQuery.prepare("UPDATE tasks SET due_at = :due_at, notified = 0, done = :done WHERE id = :task_id");
+    // Bulk operations stage their ids in a per-connection temp table so each
+    // one runs as a single set-based statement.
+    QSqlQuery setupQuery(db);
+    setupQuery.exec("CREATE TEMP TABLE IF NOT EXISTS selected_tasks (id INTEGER PRIMARY KEY)");
+    clearSelectionQuery.prepare("DELETE FROM temp.selected_tasks");
+    selectQuery.prepare("INSERT OR IGNORE INTO temp.selected_tasks (id) VALUES (:task_id)");
+    // Completing a recurring task completes its current occurrence instead.
+    bulkDoneQuery.prepare("UPDATE tasks SET done = :done WHERE id IN (SELECT id FROM temp.selected_tasks) "
+                          "AND (recurrence IS NULL OR :reopen = 1)");
+    briefsQuery.prepare("SELECT t.id, t.topic_id, tp.name, t.name, t.due_at, t.done FROM tasks t "
+                        "JOIN topics tp ON tp.id = t.topic_id AND tp.deleted = 0 "
+                        "WHERE t.id IN (SELECT id FROM temp.selected_tasks) ORDER BY t.id");
+    seriesQuery.prepare("SELECT id, due_date, recurrence, due_at FROM tasks "
+                        "WHERE id IN (SELECT id FROM temp.selected_tasks) "
+                        "AND recurrence IS NOT NULL AND done = 0 AND due_at IS NOT NULL");
+    bulkDeleteQuery.prepare("DELETE FROM tasks WHERE id IN (SELECT id FROM temp.selected_tasks)");
+    bulkMoveQuery.prepare("UPDATE tasks SET topic_id = :topic_id WHERE id IN (SELECT id FROM temp.selected_tasks)");
+    bulkRescheduleQuery.prepare("UPDATE tasks SET due_date = :due_date, due_at = :due_at, notified = 0 "
+                                "WHERE id IN (SELECT id FROM temp.selected_tasks)");
+    QSqlQuery ftsQuery(db);
+    hasFullText = ftsQuery.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'tasks_fts'")
+                  && ftsQuery.next();
+    if (hasFullText) {
+        searchQuery.prepare("SELECT t.id, t.name, tp.name, t.done FROM "
+                            "(SELECT rowid, rank FROM tasks_fts WHERE tasks_fts MATCH :match "
+                            "ORDER BY rank LIMIT :limit OFFSET :offset) f "
+                            "JOIN tasks t ON t.id = f.rowid "
+                            "JOIN topics tp ON tp.id = t.topic_id AND tp.deleted = 0 "
+                            "ORDER BY f.rank");
+    } else {
+        searchQuery.prepare("SELECT t.id, t.name, tp.name, t.done FROM tasks t "
+                            "JOIN topics tp ON tp.id = t.topic_id AND tp.deleted = 0 "
+                            "WHERE t.name LIKE :match OR t.description LIKE :description_match "
+                            "ORDER BY t.id LIMIT :limit OFFSET :offset");
+    }
+}
+
+bool TaskRepository::exec(QSqlQuery &query)
+{
+    if (query.exec()) {
+        error.clear();
+        return true;
+    }
+    error = query.lastError().text();
+    return false;
+}
+
+QVector<TaskRecord> TaskRepository::page(int topicId, int afterId, int limit)
+{
+    QVector<TaskRecord> tasks;
+    QuerySpan span(pageQuery);
+    pageQuery.bindValue(":topic_id", topicId);
+    pageQuery.bindValue(":after", afterId);
+    pageQuery.bindValue(":limit", limit);
+    if (!exec(pageQuery)) return tasks;
+    while (pageQuery.next()) {
+        TaskRecord task;
+        task.id = pageQuery.value(0).toInt();
+        task.topicId = topicId;
+        task.name = pageQuery.value(1).toString();
+        task.done = pageQuery.value(2).toInt() == 1;
+        tasks.append(task);
+    }
+    span.setRows(tasks.size());
+    pageQuery.finish();
+    return tasks;
+}
+
+QStringList TaskRepository::names(int topicId, const QVector<int> &ids)
+{
+    QStringList names;
+    if (ids.isEmpty()) return names;
+    QuerySpan span(namesQuery);
+    namesQuery.bindValue(":topic_id", topicId);
+    namesQuery.bindValue(":first", ids.first());
+    namesQuery.bindValue(":last", ids.last());
+    if (!exec(namesQuery)) return names;
+    bool hasRow = namesQuery.next();
+    for (int id : ids) {
+        while (hasRow && namesQuery.value(0).toInt() < id) hasRow = namesQuery.next();
+        names << ((hasRow && namesQuery.value(0).toInt() == id) ? namesQuery.value(1).toString() : QString());
+    }
+    span.setRows(names.size());
+    namesQuery.finish();
+    return names;
+}
+
+bool TaskRepository::find(int taskId, TaskRecord &task)
+{
+    QuerySpan span(findQuery);
+    findQuery.bindValue(":task_id", taskId);
+    bool found = exec(findQuery) && findQuery.next();
+    if (found) {
+        task.id = taskId;
+        task.topicId = findQuery.value(0).toInt();
+        task.topicName = findQuery.value(1).toString();
+        task.name = findQuery.value(2).toString();
+        task.description = findQuery.value(3).toString();
+        task.dueDate = QDateTime::fromString(findQuery.value(4).toString(), Qt::ISODate);
+        task.notify = findQuery.value(5).toBool();
+        task.notified = findQuery.value(6).toBool();
+        task.done = findQuery.value(7).toInt() == 1;
+        task.recurrence = findQuery.value(8).toString();
+    }
+    span.setRows(found ? 1 : 0);
+    findQuery.finish();
+    return found;
+}
+
+QString TaskRepository::description(int taskId)
+{
+    QuerySpan span(descriptionQuery);
+    descriptionQuery.bindValue(":task_id", taskId);
+    QString description;
+    if (exec(descriptionQuery) && descriptionQuery.next()) {
+        description = descriptionQuery.value(0).toString();
+        span.setRows(1);
+    }
+    descriptionQuery.finish();
+    return description;
+}
+
+int TaskRepository::insert(const TaskRecord &task)
+{
+    QuerySpan span(insertQuery);
+    insertQuery.bindValue(":topic_id", task.topicId);
+    insertQuery.bindValue(":name", task.name);
+    insertQuery.bindValue(":description", task.description);
+    insertQuery.bindValue(":due_date", dateValue(task.dueDate));
+    insertQuery.bindValue(":due_at", dueAtFor(task));
+    insertQuery.bindValue(":notify", task.notify ? 1 : 0);
+    insertQuery.bindValue(":notified", task.notified ? 1 : 0);
+    insertQuery.bindValue(":done", task.done ? 1 : 0);
+    insertQuery.bindValue(":recurrence", task.recurrence.isEmpty() ? QVariant() : QVariant(task.recurrence));
+    if (!exec(insertQuery)) return -1;
+    return insertQuery.lastInsertId().toInt();
+}
+
+bool TaskRepository::update(const TaskRecord &task)
+{
+    QVariant dueAt = dueAtFor(task);
+    QuerySpan span(updateQuery);
+    updateQuery.bindValue(":name", task.name);
+    updateQuery.bindValue(":topic_id", task.topicId);
+    updateQuery.bindValue(":description", task.description);
+    updateQuery.bindValue(":due_date", dateValue(task.dueDate));
+    updateQuery.bindValue(":new_due_at", dueAt);
+    updateQuery.bindValue(":due_at", dueAt);
+    updateQuery.bindValue(":notify", task.notify ? 1 : 0);
+    updateQuery.bindValue(":recurrence", task.recurrence.isEmpty() ? QVariant() : QVariant(task.recurrence));
+    updateQuery.bindValue(":task_id", task.id);
+    return exec(updateQuery);
+}
+
+bool TaskRepository::setDone(int taskId, bool done)
+{
+    return setDone(QVector<int>{taskId}, done);
+}
+
+// A recurring task is due at its first occurrence from now on that has not
+// been completed or skipped; a one-off task simply at its due date. A task
+// without a due date is never due.
+QVariant TaskRepository::dueAtFor(const TaskRecord &task)
+{
+    if (!task.dueDate.isValid()) return QVariant();
+    if (task.recurrence.isEmpty()) return task.dueDate.toSecsSinceEpoch();
+    if (task.id >= 0) {
+        QuerySpan span(recurrenceQuery);
+        recurrenceQuery.bindValue(":task_id", task.id);
+        if (exec(recurrenceQuery) && recurrenceQuery.next()
+            && recurrenceQuery.value(0).toString() == task.dueDate.toString(Qt::ISODate)
+            && recurrenceQuery.value(1).toString() == task.recurrence) {
+            QVariant dueAt = recurrenceQuery.value(2);
+            recurrenceQuery.finish();
+            return dueAt;
+        }
+        recurrenceQuery.finish();
+    }
+    QDateTime next = nextPending(task.id, task.dueDate, Recurrence::fromRule(task.recurrence),
+                                 QDateTime::currentDateTime());
+    return next.isValid() ? QVariant(next.toSecsSinceEpoch()) : QVariant();
+}
+
+QDateTime TaskRepository::nextPending(int taskId, const QDateTime &start, const Recurrence &rule, const QDateTime &from)
+{
+    QDateTime next = rule.next(start, from);
+    while (next.isValid() && taskId >= 0) {
+        qint64 at = next.toSecsSinceEpoch();
+        if (!storedOccurrences(taskId, at, at + 1).contains(at)) break;
+        next = rule.next(start, next.addSecs(1));
+    }
+    return next;
+}
+
+QSet<qint64> TaskRepository::storedOccurrences(int taskId, qint64 from, qint64 to)
+{
+    QSet<qint64> occurrences;
+    QuerySpan span(occurrencesQuery);
+    occurrencesQuery.bindValue(":task_id", taskId);
+    occurrencesQuery.bindValue(":from", from);
+    occurrencesQuery.bindValue(":to", to);
+    if (!exec(occurrencesQuery)) return occurrences;
+    while (occurrencesQuery.next()) occurrences.insert(occurrencesQuery.value(0).toLongLong());
+    span.setRows(occurrences.size());
+    occurrencesQuery.finish();
+    return occurrences;
+}
+
+// Records the current occurrence of each selected series and moves the series
+// to its next pending occurrence, or marks it done when none is left.
+bool TaskRepository::advanceSelectedSeries(OccurrenceState state)
+{
+    struct Series {
+        int id;
+        QDateTime start;
+        QString rule;
+        qint64 dueAt;
+    };
+    QVector<Series> series;
+    {
+        QuerySpan span(seriesQuery);
+        if (!exec(seriesQuery)) return false;
+        while (seriesQuery.next()) {
+            series.append({seriesQuery.value(0).toInt(),
+                           QDateTime::fromString(seriesQuery.value(1).toString(), Qt::ISODate),
+                           seriesQuery.value(2).toString(), seriesQuery.value(3).toLongLong()});
+        }
+        span.setRows(series.size());
+        seriesQuery.finish();
+    }
+    QDateTime now = QDateTime::currentDateTime();
+    for (const Series &task : series) {
+        QuerySpan span(recordOccurrenceQuery);
+        recordOccurrenceQuery.bindValue(":task_id", task.id);
+        recordOccurrenceQuery.bindValue(":occurs_at", task.dueAt);
+        recordOccurrenceQuery.bindValue(":state", int(state));
+        if (!exec(recordOccurrenceQuery)) return false;
+        QDateTime from = qMax(QDateTime::fromSecsSinceEpoch(task.dueAt + 1), now);
+        QDateTime next = nextPending(task.id, task.start, Recurrence::fromRule(task.rule), from);
+        QuerySpan advanceSpan(advanceQuery);
+        advanceQuery.bindValue(":due_at", next.isValid() ? next.toSecsSinceEpoch() : task.dueAt);
+        advanceQuery.bindValue(":done", next.isValid() ? 0 : 1);
+        advanceQuery.bindValue(":task_id", task.id);
+        if (!exec(advanceQuery)) return false;
+        if (next.isValid()) advanced.append(task.id);
+    }
+    return true;
+}
+
+bool TaskRepository::selectTasks(const QVector<int> &taskIds)
+{
+    if (!exec(clearSelectionQuery)) return false;
+    for (int taskId : taskIds) {
+        selectQuery.bindValue(":task_id", taskId);
+        if (!exec(selectQuery)) return false;
+    }
+    return true;
+}
+
+bool TaskRepository::setDone(const QVector<int> &taskIds, bool done)
+{
+    if (!selectTasks(taskIds)) return false;
+    advanced.clear();
+    {
+        QuerySpan span(bulkDoneQuery);
+        bulkDoneQuery.bindValue(":done", done ? 1 : 0);
+        bulkDoneQuery.bindValue(":reopen", done ? 0 : 1);
+        if (!exec(bulkDoneQuery)) return false;
+    }
+    return !done || advanceSelectedSeries(OccurrenceCompleted);
+}
+
+bool TaskRepository::skipOccurrence(const QVector<int> &taskIds)
+{
+    advanced.clear();
+    return selectTasks(taskIds) && advanceSelectedSeries(OccurrenceSkipped);
+}
+
+bool TaskRepository::remove(const QVector<int> &taskIds)
+{
+    if (!selectTasks(taskIds)) return false;
+    QuerySpan span(bulkDeleteQuery);
+    return exec(bulkDeleteQuery);
+}
+
+bool TaskRepository::moveToTopic(const QVector<int> &taskIds, int topicId)
+{
+    if (!selectTasks(taskIds)) return false;
+    QuerySpan span(bulkMoveQuery);
+    bulkMoveQuery.bindValue(":topic_id", topicId);
+    return exec(bulkMoveQuery);
+}
+
+bool TaskRepository::reschedule(const QVector<int> &taskIds, const QDateTime &dueDate)
+{
+    if (!selectTasks(taskIds)) return false;
+    QuerySpan span(bulkRescheduleQuery);
+    bulkRescheduleQuery.bindValue(":due_date", dateValue(dueDate));
+    bulkRescheduleQuery.bindValue(":due_at", dueDate.isValid() ? QVariant(dueDate.toSecsSinceEpoch()) : QVariant());
+    return exec(bulkRescheduleQuery);
+}
+
+int TaskRepository::removeBatch(int topicId, int limit)
+{
+    QuerySpan span(removeBatchQuery);
+    removeBatchQuery.bindValue(":topic_id", topicId);
+    removeBatchQuery.bindValue(":limit", limit);
+    if (!exec(removeBatchQuery)) return -1;
+    return removeBatchQuery.numRowsAffected();
+}
+
+qint64 TaskRepository::countByTopic(int topicId)
+{
+    QuerySpan span(countQuery);
+    countQuery.bindValue(":topic_id", topicId);
+    qint64 count = 0;
+    if (exec(countQuery) && countQuery.next()) count = countQuery.value(0).toLongLong();
+    countQuery.finish();
+    return count;
+}
+
+bool TaskRepository::remove(int taskId)
+{
+    QuerySpan span(deleteQuery);
+    deleteQuery.bindValue(":task_id", taskId);
+    return exec(deleteQuery);
+}
+
+QVector<TaskDeadline> TaskRepository::pendingDeadlines(int limit)
+{
+    QVector<TaskDeadline> deadlines;
+    QuerySpan span(deadlinesQuery);
+    deadlinesQuery.bindValue(":limit", limit);
+    if (!exec(deadlinesQuery)) return deadlines;
+    while (deadlinesQuery.next()) {
+        deadlines.append({deadlinesQuery.value(0).toInt(), deadlinesQuery.value(1).toLongLong()});
+    }
+    span.setRows(deadlines.size());
+    deadlinesQuery.finish();
+    return deadlines;
+}
+
+QVector<TaskRecord> TaskRepository::dueTasks(qint64 now)
+{
+    QVector<TaskRecord> tasks;
+    QuerySpan span(dueQuery);
+    dueQuery.bindValue(":now", now);
+    if (!exec(dueQuery)) return tasks;
+    while (dueQuery.next()) {
+        TaskRecord task;
+        task.id = dueQuery.value(0).toInt();
+        task.name = dueQuery.value(1).toString();
+        task.topicName = dueQuery.value(2).toString();
+        task.recurrence = dueQuery.value(5).toString();
+        task.dueDate = task.recurrence.isEmpty()
+                           ? QDateTime::fromString(dueQuery.value(3).toString(), Qt::ISODate)
+                           : QDateTime::fromSecsSinceEpoch(dueQuery.value(4).toLongLong());
+        task.notify = true;
+        tasks.append(task);
+    }
+    span.setRows(tasks.size());
+    dueQuery.finish();
+    return tasks;
+}
+
+QVector<TaskRecord> TaskRepository::openTasksDueBetween(qint64 from, qint64 to, int limit)
+{
+    QVector<TaskRecord> tasks;
+    QuerySpan span(dueBetweenQuery);
+    dueBetweenQuery.bindValue(":from", from);
+    dueBetweenQuery.bindValue(":to", to);
+    dueBetweenQuery.bindValue(":limit", limit);
+    if (!exec(dueBetweenQuery)) return tasks;
+    while (dueBetweenQuery.next()) {
+        TaskRecord task;
+        task.id = dueBetweenQuery.value(0).toInt();
+        task.topicId = dueBetweenQuery.value(1).toInt();
+        task.topicName = dueBetweenQuery.value(2).toString();
+        task.name = dueBetweenQuery.value(3).toString();
+        task.dueDate = QDateTime::fromString(dueBetweenQuery.value(4).toString(), Qt::ISODate);
+        task.notify = dueBetweenQuery.value(5).toBool();
+        task.notified = dueBetweenQuery.value(6).toBool();
+        tasks.append(task);
+    }
+    span.setRows(tasks.size());
+    dueBetweenQuery.finish();
+    if (!appendOccurrences(tasks, from, to, limit)) return tasks;
+    std::stable_sort(tasks.begin(), tasks.end(), [](const TaskRecord &a, const TaskRecord &b) {
+        return a.dueDate < b.dueDate;
+    });
+    if (tasks.size() > limit) tasks.resize(limit);
+    return tasks;
+}
+
+// Expands every open series that has a pending occurrence before the end of
+// the range into one record per occurrence inside it.
+bool TaskRepository::appendOccurrences(QVector<TaskRecord> &tasks, qint64 from, qint64 to, int limit)
+{
+    QVector<TaskRecord> series;
+    QVector<qint64> dueAts;
+    {
+        QuerySpan span(seriesBetweenQuery);
+        seriesBetweenQuery.bindValue(":to", to);
+        if (!exec(seriesBetweenQuery)) return false;
+        while (seriesBetweenQuery.next()) {
+            TaskRecord task;
+            task.id = seriesBetweenQuery.value(0).toInt();
+            task.topicId = seriesBetweenQuery.value(1).toInt();
+            task.topicName = seriesBetweenQuery.value(2).toString();
+            task.name = seriesBetweenQuery.value(3).toString();
+            task.dueDate = QDateTime::fromString(seriesBetweenQuery.value(4).toString(), Qt::ISODate);
+            task.notify = seriesBetweenQuery.value(5).toBool();
+            task.notified = seriesBetweenQuery.value(6).toBool();
+            task.recurrence = seriesBetweenQuery.value(7).toString();
+            series.append(task);
+            dueAts.append(seriesBetweenQuery.value(8).toLongLong());
+        }
+        span.setRows(series.size());
+        seriesBetweenQuery.finish();
+    }
+    for (int i = 0; i < series.size(); ++i) {
+        const TaskRecord &task = series.at(i);
+        qint64 first = qMax(from, dueAts.at(i));
+        const QSet<qint64> stored = storedOccurrences(task.id, first, to);
+        const QVector<QDateTime> occurrences = Recurrence::fromRule(task.recurrence).between(
+            task.dueDate, QDateTime::fromSecsSinceEpoch(first), QDateTime::fromSecsSinceEpoch(to), limit + stored.size());
+        for (const QDateTime &occurrence : occurrences) {
+            if (stored.contains(occurrence.toSecsSinceEpoch())) continue;
+            TaskRecord record = task;
+            record.dueDate = occurrence;
+            record.notified = record.notified && occurrence.toSecsSinceEpoch() == dueAts.at(i);
+            tasks.append(record);
+        }
+    }
+    return true;
+}
+
+bool TaskRepository::markNotified(int taskId)
+{
+    QuerySpan span(markNotifiedQuery);
+    markNotifiedQuery.bindValue(":task_id", taskId);
+    return exec(markNotifiedQuery);
+}
+
+bool TaskRepository::markDueNotified(qint64 now)
+{
+    QuerySpan span(markDueNotifiedQuery);
+    markDueNotifiedQuery.bindValue(":now", now);
+    return exec(markDueNotifiedQuery);
+}
+
+QVector<TaskRecord> TaskRepository::search(const QString &text, int limit, int offset)
+{
+    QVector<TaskRecord> tasks;
+    QString match = hasFullText ? matchExpression(text) : "%" + text.simplified() + "%";
+    if (match.isEmpty()) return tasks;
+    QuerySpan span(searchQuery);
+    searchQuery.bindValue(":match", match);
+    if (!hasFullText) searchQuery.bindValue(":description_match", match);
+    searchQuery.bindValue(":limit", limit);
+    searchQuery.bindValue(":offset", offset);
+    if (!exec(searchQuery)) return tasks;
+    while (searchQuery.next()) {
+        TaskRecord task;
+        task.id = searchQuery.value(0).toInt();
+        task.name = searchQuery.value(1).toString();
+        task.topicName = searchQuery.value(2).toString();
+        task.done = searchQuery.value(3).toInt() == 1;
+        tasks.append(task);
+    }
+    span.setRows(tasks.size());
+    searchQuery.finish();
+    return tasks;
+}
+
+QString TaskRepository::matchExpression(const QString &text)
+{
+    QStringList terms;
+    const QStringList words = text.simplified().split(' ');
+    for (QString word : words) {
+        word.remove('"');
+        if (!word.isEmpty()) terms << "\"" + word + "\"*";
+    }
+    return terms.join(' ');
+}
+
+bool TaskRepository::forEach(const std::function<bool(const TaskRecord &)> &visit)
+{
+    QuerySpan span(exportQuery);
+    if (!exec(exportQuery)) return false;
+    bool completed = true;
+    qint64 rows = 0;
+    while (exportQuery.next()) {
+        TaskRecord task;
+        task.topicId = exportQuery.value(0).toInt();
+        task.topicName = exportQuery.value(1).toString();
+        if (!exportQuery.value(2).isNull()) {
+            task.id = exportQuery.value(2).toInt();
+            task.name = exportQuery.value(3).toString();
+            task.description = exportQuery.value(4).toString();
+            task.dueDate = QDateTime::fromString(exportQuery.value(5).toString(), Qt::ISODate);
+            task.notify = exportQuery.value(6).toBool();
+            task.notified = exportQuery.value(7).toBool();
+            task.done = exportQuery.value(8).toInt() == 1;
+            task.recurrence = exportQuery.value(9).toString();
+        }
+        ++rows;
+        if (!visit(task)) {
+            completed = false;
+            break;
+        }
+    }
+    span.setRows(rows);
+    exportQuery.finish();
+    return completed;
+}
+
+bool TaskRepository::scan(const std::function<void(const TaskBrief &)> &visit)
+{
+    QuerySpan span(scanQuery);
+    if (!exec(scanQuery)) return false;
+    qint64 rows = 0;
+    TaskBrief task;
+    while (scanQuery.next()) {
+        task.id = scanQuery.value(0).toInt();
+        task.topicId = scanQuery.value(1).toInt();
+        task.name = scanQuery.value(2).toString();
+        QVariant dueAt = scanQuery.value(3);
+        task.dueAt = dueAt.isNull() ? TaskBrief::NoDue : dueAt.toLongLong();
+        task.done = scanQuery.value(4).toInt() == 1;
+        visit(task);
+        ++rows;
+    }
+    span.setRows(rows);
+    scanQuery.finish();
+    return true;
+}
+
+QVector<TaskBrief> TaskRepository::briefs(const QVector<int> &taskIds)
+{
+    QVector<TaskBrief> tasks;
+    if (taskIds.isEmpty() || !selectTasks(taskIds)) return tasks;
+    QuerySpan span(briefsQuery);
+    if (!exec(briefsQuery)) return tasks;
+    while (briefsQuery.next()) {
+        TaskBrief task;
+        task.id = briefsQuery.value(0).toInt();
+        task.topicId = briefsQuery.value(1).toInt();
+        task.topicName = briefsQuery.value(2).toString();
+        task.name = briefsQuery.value(3).toString();
+        QVariant dueAt = briefsQuery.value(4);
+        task.dueAt = dueAt.isNull() ? TaskBrief::NoDue : dueAt.toLongLong();
+        task.done = briefsQuery.value(5).toInt() == 1;
+        tasks.append(task);
+    }
+    span.setRows(tasks.size());
+    briefsQuery.finish();
+    return tasks;
+}
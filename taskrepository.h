@@ -0,0 +1,123 @@
+#ifndef TASKREPOSITORY_H
+#define TASKREPOSITORY_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QDateTime>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <limits>
+
+struct TaskRecord
+{
+    int id = -1;
+    int topicId = -1;
+    QString topicName;
+    QString name;
+    QString description;
+    QDateTime dueDate;
+    bool notify = false;
+    bool notified = false;
+    bool done = false;
+    QString recurrence;
+};
+
+// The columns the cross-topic view needs; dueAt is NoDue for undated tasks.
+struct TaskBrief
+{
+    static constexpr qint64 NoDue = std::numeric_limits<qint64>::max();
+    int id = -1;
+    int topicId = -1;
+    QString topicName;
+    QString name;
+    qint64 dueAt = NoDue;
+    bool done = false;
+};
+
+struct TaskDeadline
+{
+    int taskId;
+    qint64 dueAt;
+};
+
+class Recurrence;
+
+class TaskRepository
+{
+public:
+    enum OccurrenceState { OccurrenceCompleted = 1, OccurrenceSkipped = 2 };
+    explicit TaskRepository(const QSqlDatabase &db);
+    QVector<TaskRecord> page(int topicId, int afterId, int limit);
+    QStringList names(int topicId, const QVector<int> &ids);
+    bool find(int taskId, TaskRecord &task);
+    QString description(int taskId);
+    int insert(const TaskRecord &task);
+    bool update(const TaskRecord &task);
+    bool setDone(int taskId, bool done);
+    bool setDone(const QVector<int> &taskIds, bool done);
+    bool skipOccurrence(const QVector<int> &taskIds);
+    QVector<int> advancedSeries() const { return advanced; }
+    bool remove(int taskId);
+    bool remove(const QVector<int> &taskIds);
+    bool moveToTopic(const QVector<int> &taskIds, int topicId);
+    bool reschedule(const QVector<int> &taskIds, const QDateTime &dueDate);
+    int removeBatch(int topicId, int limit);
+    qint64 countByTopic(int topicId);
+    QVector<TaskDeadline> pendingDeadlines(int limit);
+    QVector<TaskRecord> dueTasks(qint64 now);
+    QVector<TaskRecord> openTasksDueBetween(qint64 from, qint64 to, int limit);
+    bool markNotified(int taskId);
+    bool markDueNotified(qint64 now);
+    QVector<TaskRecord> search(const QString &text, int limit, int offset);
+    static QString matchExpression(const QString &text);
+    bool forEach(const std::function<bool(const TaskRecord &)> &visit);
+    bool scan(const std::function<void(const TaskBrief &)> &visit);
+    QVector<TaskBrief> briefs(const QVector<int> &taskIds);
+    QString lastError() const { return error; }
+private:
+    QSqlDatabase db;
+    QSqlQuery pageQuery;
+    QSqlQuery namesQuery;
+    QSqlQuery findQuery;
+    QSqlQuery descriptionQuery;
+    QSqlQuery insertQuery;
+    QSqlQuery updateQuery;
+    QSqlQuery deleteQuery;
+    QSqlQuery deadlinesQuery;
+    QSqlQuery dueQuery;
+    QSqlQuery dueBetweenQuery;
+    QSqlQuery markNotifiedQuery;
+    QSqlQuery markDueNotifiedQuery;
+    QSqlQuery searchQuery;
+    QSqlQuery exportQuery;
+    QSqlQuery clearSelectionQuery;
+    QSqlQuery selectQuery;
+    QSqlQuery bulkDoneQuery;
+    QSqlQuery bulkDeleteQuery;
+    QSqlQuery bulkMoveQuery;
+    QSqlQuery bulkRescheduleQuery;
+    QSqlQuery removeBatchQuery;
+    QSqlQuery countQuery;
+    QSqlQuery recurrenceQuery;
+    QSqlQuery seriesQuery;
+    QSqlQuery seriesBetweenQuery;
+    QSqlQuery occurrencesQuery;
+    QSqlQuery recordOccurrenceQuery;
+    QSqlQuery advanceQuery;
+    QSqlQuery scanQuery;
+    QSqlQuery briefsQuery;
+    bool hasFullText;
+    QString error;
+    QVector<int> advanced;
+    bool exec(QSqlQuery &query);
+    bool selectTasks(const QVector<int> &taskIds);
+    QVariant dueAtFor(const TaskRecord &task);
+    QDateTime nextPending(int taskId, const QDateTime &start, const Recurrence &rule, const QDateTime &from);
+    QSet<qint64> storedOccurrences(int taskId, qint64 from, qint64 to);
+    bool advanceSelectedSeries(OccurrenceState state);
+    bool appendOccurrences(QVector<TaskRecord> &tasks, qint64 from, qint64 to, int limit);
+};
+
+#endif // TASKREPOSITORY_H
@@ -0,0 +1,281 @@
+#include "tasksnapshot.h"
+#include "databaseworker.h"
+#include <algorithm>
+#include <thread>
+
+namespace {
+const int MinRowsPerWorker = 16384;
+const int MinArenaCompaction = 1 << 20;
+
+int workerCount(int rows)
+{
+    int hardware = int(std::max(1u, std::thread::hardware_concurrency()));
+    return qBound(1, rows / MinRowsPerWorker, hardware);
+}
+
+template <typename Fn>
+void runParallel(int count, Fn fn)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for (int i = 1; i < count; ++i) threads.emplace_back(fn, i);
+    fn(0);
+    for (std::thread &thread : threads) thread.join();
+}
+
+template <typename T>
+qint64 capacityBytes(const std::vector<T> &column)
+{
+    return qint64(column.capacity() * sizeof(T));
+}
+}
+
+bool TaskSnapshot::load(DatabaseSession &session)
+{
+    *this = TaskSnapshot();
+    QHash<int, int> topicIds;
+    const QVector<TopicRecord> records = session.topics().all();
+    for (const TopicRecord &topic : records) topicIds.insert(topic.id, internTopic(topic.name));
+    bool ok = session.tasks().scan([this, &topicIds](const TaskBrief &task) {
+        auto topic = topicIds.constFind(task.topicId);
+        if (topic == topicIds.constEnd()) return;
+        ids.push_back(task.id);
+        topicOf.push_back(topic.value());
+        due.push_back(task.dueAt);
+        flags.push_back(task.done ? Done : 0);
+        nameOffsets.push_back(0);
+        nameLengths.push_back(0);
+        setName(int(ids.size()) - 1, task.name);
+    });
+    ids.shrink_to_fit();
+    topicOf.shrink_to_fit();
+    due.shrink_to_fit();
+    flags.shrink_to_fit();
+    nameOffsets.shrink_to_fit();
+    nameLengths.shrink_to_fit();
+    arena.squeeze();
+    return ok;
+}
+
+int TaskSnapshot::rowForTask(int taskId) const
+{
+    auto it = std::lower_bound(ids.cbegin(), ids.cend(), taskId);
+    return (it != ids.cend() && *it == taskId) ? int(it - ids.cbegin()) : -1;
+}
+
+QString TaskSnapshot::name(int row) const
+{
+    return QString::fromUtf8(arena.constData() + nameOffsets[row], int(nameLengths[row]));
+}
+
+QStringList TaskSnapshot::topicNames() const
+{
+    QStringList names = topicByName.keys();
+    std::sort(names.begin(), names.end(), [](const QString &a, const QString &b) {
+        return a.compare(b, Qt::CaseInsensitive) < 0;
+    });
+    return names;
+}
+
+int TaskSnapshot::upsert(const TaskBrief &task)
+{
+    auto it = std::lower_bound(ids.begin(), ids.end(), task.id);
+    int row = int(it - ids.begin());
+    if (it == ids.end() || *it != task.id) {
+        ids.insert(it, task.id);
+        topicOf.insert(topicOf.begin() + row, -1);
+        due.insert(due.begin() + row, TaskBrief::NoDue);
+        flags.insert(flags.begin() + row, quint8(0));
+        nameOffsets.insert(nameOffsets.begin() + row, 0u);
+        nameLengths.insert(nameLengths.begin() + row, 0u);
+    } else if (flags[row] & Removed) {
+        --removedRows;
+    }
+    topicOf[row] = internTopic(task.topicName);
+    due[row] = task.dueAt;
+    flags[row] = task.done ? Done : 0;
+    setName(row, task.name);
+    return row;
+}
+
+int TaskSnapshot::remove(int taskId)
+{
+    int row = rowForTask(taskId);
+    if (row < 0 || (flags[row] & Removed)) return -1;
+    flags[row] |= Removed;
+    ++removedRows;
+    arenaGarbage += nameLengths[row];
+    nameLengths[row] = 0;
+    return row;
+}
+
+int TaskSnapshot::setDone(int taskId, bool done)
+{
+    int row = rowForTask(taskId);
+    if (row < 0 || (flags[row] & Removed)) return -1;
+    flags[row] = done ? quint8(flags[row] | Done) : quint8(flags[row] & ~Done);
+    return row;
+}
+
+void TaskSnapshot::renameTopic(const QString &oldName, const QString &newName)
+{
+    auto found = topicByName.find(oldName);
+    if (found == topicByName.end()) return;
+    int topic = found.value();
+    topicByName.erase(found);
+    topics[topic] = newName;
+    topicByName.insert(newName, topic);
+}
+
+void TaskSnapshot::removeTopic(const QString &name)
+{
+    auto found = topicByName.constFind(name);
+    if (found == topicByName.constEnd()) return;
+    int topic = found.value();
+    topicByName.erase(found);
+    for (int row = 0; row < rowCount(); ++row) {
+        if (topicOf[row] == topic && !(flags[row] & Removed)) remove(ids[row]);
+    }
+}
+
+bool TaskSnapshot::needsCompaction() const
+{
+    return removedRows > rowCount() / 4 || (arenaGarbage > MinArenaCompaction && arenaGarbage > arena.size() / 2);
+}
+
+// Drops tombstones and rewrites the arena; row numbers change.
+void TaskSnapshot::compact()
+{
+    TaskSnapshot compacted;
+    compacted.topics = topics;
+    compacted.topicByName = topicByName;
+    int live = liveCount();
+    compacted.ids.reserve(live);
+    compacted.topicOf.reserve(live);
+    compacted.due.reserve(live);
+    compacted.flags.reserve(live);
+    compacted.nameOffsets.reserve(live);
+    compacted.nameLengths.reserve(live);
+    compacted.arena.reserve(int(arena.size() - arenaGarbage));
+    for (int row = 0; row < rowCount(); ++row) {
+        if (flags[row] & Removed) continue;
+        compacted.ids.push_back(ids[row]);
+        compacted.topicOf.push_back(topicOf[row]);
+        compacted.due.push_back(due[row]);
+        compacted.flags.push_back(flags[row]);
+        compacted.nameOffsets.push_back(quint32(compacted.arena.size()));
+        compacted.nameLengths.push_back(nameLengths[row]);
+        compacted.arena.append(arena.constData() + nameOffsets[row], int(nameLengths[row]));
+    }
+    *this = std::move(compacted);
+}
+
+bool TaskSnapshot::matches(int row, const Filter &filter) const
+{
+    quint8 state = flags[row];
+    if (state & Removed) return false;
+    if (filter.done == OpenOnly && (state & Done)) return false;
+    if (filter.done == DoneOnly && !(state & Done)) return false;
+    if (filter.topic >= 0 && topicOf[row] != filter.topic) return false;
+    return due[row] >= filter.dueFrom && due[row] <= filter.dueTo;
+}
+
+bool TaskSnapshot::lessThan(int a, int b, const Order &order) const
+{
+    if (order.key == ByTopic && topicOf[a] != topicOf[b]) {
+        bool before = topicBefore(topicOf[a], topicOf[b]);
+        return order.descending ? !before : before;
+    }
+    if (order.key == ByState && (flags[a] & Done) != (flags[b] & Done)) {
+        bool aFirst = !(flags[a] & Done);
+        return order.descending ? !aFirst : aFirst;
+    }
+    if (due[a] != due[b]) return order.descending ? due[a] > due[b] : due[a] < due[b];
+    return a < b;
+}
+
+// Each worker filters and sorts one slice of the rows; sorted slices are then
+// merged pairwise, also in parallel.
+std::vector<int> TaskSnapshot::select(const Filter &filter, const Order &order) const
+{
+    const int rows = rowCount();
+    const int workers = workerCount(rows);
+    std::vector<int> ranks = topicRanks();
+    auto less = [this, &order, &ranks](int a, int b) {
+        if (order.key == ByTopic && topicOf[a] != topicOf[b]) {
+            return order.descending ? ranks[topicOf[a]] > ranks[topicOf[b]] : ranks[topicOf[a]] < ranks[topicOf[b]];
+        }
+        return lessThan(a, b, order);
+    };
+    std::vector<std::vector<int>> parts(workers);
+    runParallel(workers, [&](int worker) {
+        int first = int(qint64(rows) * worker / workers);
+        int last = int(qint64(rows) * (worker + 1) / workers);
+        std::vector<int> &part = parts[worker];
+        part.reserve(last - first);
+        for (int row = first; row < last; ++row) {
+            if (matches(row, filter)) part.push_back(row);
+        }
+        std::sort(part.begin(), part.end(), less);
+    });
+    while (parts.size() > 1) {
+        std::vector<std::vector<int>> merged((parts.size() + 1) / 2);
+        runParallel(int(merged.size()), [&](int i) {
+            if (2 * size_t(i) + 1 == parts.size()) {
+                merged[i] = std::move(parts[2 * i]);
+                return;
+            }
+            const std::vector<int> &left = parts[2 * i];
+            const std::vector<int> &right = parts[2 * i + 1];
+            merged[i].resize(left.size() + right.size());
+            std::merge(left.begin(), left.end(), right.begin(), right.end(), merged[i].begin(), less);
+        });
+        parts = std::move(merged);
+    }
+    return std::move(parts.front());
+}
+
+qint64 TaskSnapshot::memoryUsage() const
+{
+    return capacityBytes(ids) + capacityBytes(topicOf) + capacityBytes(due) + capacityBytes(flags)
+           + capacityBytes(nameOffsets) + capacityBytes(nameLengths) + arena.capacity();
+}
+
+int TaskSnapshot::internTopic(const QString &name)
+{
+    auto found = topicByName.constFind(name);
+    if (found != topicByName.constEnd()) return found.value();
+    topics.append(name);
+    topicByName.insert(name, topics.size() - 1);
+    return topics.size() - 1;
+}
+
+void TaskSnapshot::setName(int row, const QString &name)
+{
+    QByteArray bytes = name.toUtf8();
+    if (nameLengths[row] == quint32(bytes.size())
+        && std::equal(bytes.cbegin(), bytes.cend(), arena.constData() + nameOffsets[row])) {
+        return;
+    }
+    arenaGarbage += nameLengths[row];
+    nameOffsets[row] = quint32(arena.size());
+    nameLengths[row] = quint32(bytes.size());
+    arena += bytes;
+}
+
+bool TaskSnapshot::topicBefore(int a, int b) const
+{
+    int compared = topics.at(a).compare(topics.at(b), Qt::CaseInsensitive);
+    if (compared == 0) compared = topics.at(a).compare(topics.at(b));
+    return compared != 0 ? compared < 0 : a < b;
+}
+
+std::vector<int> TaskSnapshot::topicRanks() const
+{
+    std::vector<int> order(topics.size());
+    for (int i = 0; i < topics.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [this](int a, int b) { return topicBefore(a, b); });
+    std::vector<int> ranks(topics.size());
+    for (int i = 0; i < int(order.size()); ++i) ranks[order[i]] = i;
+    return ranks;
+}
@@ -0,0 +1,76 @@
+#ifndef TASKSNAPSHOT_H
+#define TASKSNAPSHOT_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <limits>
+#include <vector>
+
+class DatabaseSession;
+struct TaskBrief;
+
+// In-memory copy of every visible task for the cross-topic view, stored as
+// struct-of-arrays ordered by task id. Topics are interned to small indexes
+// and names share one UTF-8 arena, so a million tasks take a few tens of
+// megabytes and sorting only touches the columns it compares. Removed rows
+// stay as tombstones until enough accumulate to compact.
+class TaskSnapshot
+{
+public:
+    enum SortKey { ByDueDate, ByTopic, ByState };
+    enum DoneFilter { AnyState, OpenOnly, DoneOnly };
+    struct Filter {
+        DoneFilter done = AnyState;
+        int topic = -1;
+        qint64 dueFrom = std::numeric_limits<qint64>::min();
+        qint64 dueTo = std::numeric_limits<qint64>::max();
+    };
+    struct Order {
+        SortKey key = ByDueDate;
+        bool descending = false;
+    };
+    bool load(DatabaseSession &session);
+    int rowCount() const { return int(ids.size()); }
+    int liveCount() const { return rowCount() - removedRows; }
+    int rowForTask(int taskId) const;
+    int taskId(int row) const { return ids[row]; }
+    QString name(int row) const;
+    QString topicName(int row) const { return topics.value(topicOf[row]); }
+    qint64 dueAt(int row) const { return due[row]; }
+    bool isDone(int row) const { return flags[row] & Done; }
+    bool isRemoved(int row) const { return flags[row] & Removed; }
+    QStringList topicNames() const;
+    int topicIndex(const QString &name) const { return topicByName.value(name, -1); }
+    // Returns the row that now holds the task.
+    int upsert(const TaskBrief &task);
+    int remove(int taskId);
+    int setDone(int taskId, bool done);
+    void renameTopic(const QString &oldName, const QString &newName);
+    void removeTopic(const QString &name);
+    bool needsCompaction() const;
+    void compact();
+    bool matches(int row, const Filter &filter) const;
+    bool lessThan(int a, int b, const Order &order) const;
+    std::vector<int> select(const Filter &filter, const Order &order) const;
+    qint64 memoryUsage() const;
+private:
+    enum Flag : quint8 { Done = 1, Removed = 2 };
+    int internTopic(const QString &name);
+    void setName(int row, const QString &name);
+    bool topicBefore(int a, int b) const;
+    std::vector<int> topicRanks() const;
+    std::vector<qint32> ids;
+    std::vector<qint32> topicOf;
+    std::vector<qint64> due;
+    std::vector<quint8> flags;
+    std::vector<quint32> nameOffsets;
+    std::vector<quint32> nameLengths;
+    QByteArray arena;
+    qint64 arenaGarbage = 0;
+    int removedRows = 0;
+    QStringList topics;
+    QHash<QString, int> topicByName;
+};
+
+#endif // TASKSNAPSHOT_H
@@ -0,0 +1,307 @@
+#include "tasktransfer.h"
+#include "databaseworker.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlError>
+
+namespace {
+const int BatchSize = 20000;
+const int BufferSize = 1 << 20;
+const qint64 ReportIntervalMs = 100;
+const char CsvHeader[] = "topic,name,description,due_date,notify,notified,done,recurrence\n";
+
+bool csvLineComplete(const QByteArray &line)
+{
+    return line.count('"') % 2 == 0;
+}
+
+QStringList parseCsvLine(const QByteArray &line)
+{
+    const QString text = QString::fromUtf8(line);
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    for (int i = 0; i < text.size(); ++i) {
+        QChar c = text.at(i);
+        if (quoted) {
+            if (c == '"') {
+                if (i + 1 < text.size() && text.at(i + 1) == '"') {
+                    field += '"';
+                    ++i;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields << field;
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    fields << field;
+    return fields;
+}
+
+bool parseFlag(const QString &value)
+{
+    return value == "1" || value.compare("true", Qt::CaseInsensitive) == 0;
+}
+
+TaskRecord recordFromCsv(const QStringList &fields)
+{
+    TaskRecord task;
+    task.topicName = fields.value(0);
+    task.name = fields.value(1);
+    task.description = fields.value(2);
+    task.dueDate = QDateTime::fromString(fields.value(3), Qt::ISODate);
+    task.notify = parseFlag(fields.value(4));
+    task.notified = parseFlag(fields.value(5));
+    task.done = parseFlag(fields.value(6));
+    task.recurrence = fields.value(7);
+    return task;
+}
+
+TaskRecord recordFromJson(const QJsonObject &object)
+{
+    TaskRecord task;
+    task.topicName = object.value("topic").toString();
+    task.name = object.value("name").toString();
+    task.description = object.value("description").toString();
+    task.dueDate = QDateTime::fromString(object.value("due_date").toString(), Qt::ISODate);
+    task.notify = object.value("notify").toBool();
+    task.notified = object.value("notified").toBool();
+    task.done = object.value("done").toBool();
+    task.recurrence = object.value("recurrence").toString();
+    return task;
+}
+
+void appendCsvField(QByteArray &out, const QString &value)
+{
+    QByteArray bytes = value.toUtf8();
+    if (bytes.contains(',') || bytes.contains('"') || bytes.contains('\n') || bytes.contains('\r')) {
+        bytes.replace("\"", "\"\"");
+        out += '"';
+        out += bytes;
+        out += '"';
+    } else {
+        out += bytes;
+    }
+}
+
+void appendCsv(QByteArray &out, const TaskRecord &task)
+{
+    appendCsvField(out, task.topicName);
+    out += ',';
+    if (task.id >= 0) {
+        appendCsvField(out, task.name);
+        out += ',';
+        appendCsvField(out, task.description);
+        out += ',';
+        out += task.dueDate.toString(Qt::ISODate).toUtf8();
+        out += task.notify ? ",1" : ",0";
+        out += task.notified ? ",1" : ",0";
+        out += task.done ? ",1" : ",0";
+        out += ',';
+        appendCsvField(out, task.recurrence);
+    } else {
+        out += ",,,,,,";
+    }
+    out += '\n';
+}
+
+void appendJson(QByteArray &out, const TaskRecord &task)
+{
+    QJsonObject object;
+    object.insert("topic", task.topicName);
+    if (task.id >= 0) {
+        object.insert("name", task.name);
+        object.insert("description", task.description);
+        object.insert("due_date", task.dueDate.toString(Qt::ISODate));
+        object.insert("notify", task.notify);
+        object.insert("notified", task.notified);
+        object.insert("done", task.done);
+        if (!task.recurrence.isEmpty()) object.insert("recurrence", task.recurrence);
+    }
+    out += QJsonDocument(object).toJson(QJsonDocument::Compact);
+    out += '\n';
+}
+}
+
+TaskTransfer::TaskTransfer(DatabaseSession &session)
+    : session(session)
+{
+}
+
+TaskTransfer::Format TaskTransfer::formatForFile(const QString &fileName)
+{
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    return (suffix == "jsonl" || suffix == "json" || suffix == "ndjson") ? JsonLines : Csv;
+}
+
+void TaskTransfer::report(TransferProgress &progress, bool force)
+{
+    if (!progressCallback) return;
+    if (!force && progress.elapsedMs - lastReportMs < ReportIntervalMs) return;
+    lastReportMs = progress.elapsedMs;
+    progressCallback(progress);
+}
+
+bool TaskTransfer::storeRecord(const TaskRecord &task, QString &error)
+{
+    if (task.topicName.isEmpty()) {
+        error = "missing topic";
+        return false;
+    }
+    TopicRepository &topics = session.topics();
+    int topicId = topics.idForName(task.topicName);
+    if (topicId < 0) topicId = topics.insert(task.topicName);
+    if (topicId < 0) {
+        error = topics.lastError();
+        return false;
+    }
+    if (task.name.isEmpty()) return true;
+    TaskRecord record = task;
+    record.topicId = topicId;
+    if (session.tasks().insert(record) < 0) {
+        error = session.tasks().lastError();
+        return false;
+    }
+    return true;
+}
+
+TransferProgress TaskTransfer::importFile(const QString &fileName, Format format)
+{
+    TransferProgress progress;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        progress.ok = false;
+        progress.finished = true;
+        progress.error = file.errorString();
+        return progress;
+    }
+    progress.totalBytes = file.size();
+    lastReportMs = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QSqlDatabase db = session.database();
+    db.transaction();
+    int batchRows = 0;
+    qint64 lineNumber = 0;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        ++lineNumber;
+        if (format == Csv) {
+            while (!csvLineComplete(line) && !file.atEnd()) line += file.readLine();
+        }
+        while (line.endsWith('\n') || line.endsWith('\r')) line.chop(1);
+        if (line.trimmed().isEmpty()) continue;
+        TaskRecord task;
+        if (format == Csv) {
+            QStringList fields = parseCsvLine(line);
+            if (lineNumber == 1 && fields.value(0) == "topic") continue;
+            task = recordFromCsv(fields);
+        } else {
+            QJsonParseError parseError;
+            QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+            if (!document.isObject()) {
+                progress.ok = false;
+                progress.error = parseError.errorString();
+            } else {
+                task = recordFromJson(document.object());
+            }
+        }
+        QString error;
+        if (!progress.ok || !storeRecord(task, error)) {
+            progress.ok = false;
+            progress.error = QString("Line %1: %2").arg(lineNumber).arg(progress.error.isEmpty() ? error : progress.error);
+            break;
+        }
+        ++progress.rows;
+        if (++batchRows >= BatchSize) {
+            if (!db.commit()) {
+                progress.ok = false;
+                progress.error = db.lastError().text();
+                break;
+            }
+            db.transaction();
+            batchRows = 0;
+            progress.bytes = file.pos();
+            progress.elapsedMs = timer.elapsed();
+            report(progress, false);
+        }
+    }
+    if (progress.ok && !db.commit()) {
+        progress.ok = false;
+        progress.error = db.lastError().text();
+    }
+    if (!progress.ok) {
+        db.rollback();
+        session.topics().clearCache();
+        progress.rows -= batchRows;
+    }
+    progress.bytes = file.pos();
+    progress.elapsedMs = timer.elapsed();
+    progress.finished = true;
+    report(progress, true);
+    return progress;
+}
+
+TransferProgress TaskTransfer::exportFile(const QString &fileName, Format format)
+{
+    TransferProgress progress;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        progress.ok = false;
+        progress.finished = true;
+        progress.error = file.errorString();
+        return progress;
+    }
+    lastReportMs = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray buffer;
+    buffer.reserve(BufferSize + 4096);
+    if (format == Csv) buffer += CsvHeader;
+    auto flush = [&]() {
+        if (file.write(buffer) != buffer.size()) {
+            progress.ok = false;
+            progress.error = file.errorString();
+            return false;
+        }
+        progress.bytes += buffer.size();
+        buffer.clear();
+        return true;
+    };
+    bool ok = session.tasks().forEach([&](const TaskRecord &task) {
+        if (format == Csv) {
+            appendCsv(buffer, task);
+        } else {
+            appendJson(buffer, task);
+        }
+        ++progress.rows;
+        if (buffer.size() < BufferSize) return true;
+        if (!flush()) return false;
+        progress.elapsedMs = timer.elapsed();
+        report(progress, false);
+        return true;
+    });
+    if (!ok && progress.ok) {
+        progress.ok = false;
+        progress.error = session.tasks().lastError();
+    }
+    if (progress.ok) flush();
+    file.close();
+    progress.totalBytes = progress.bytes;
+    progress.elapsedMs = timer.elapsed();
+    progress.finished = true;
+    report(progress, true);
+    return progress;
+}
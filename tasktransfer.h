@@ -0,0 +1,43 @@
+#ifndef TASKTRANSFER_H
+#define TASKTRANSFER_H
+
+#include <QString>
+#include <functional>
+
+class DatabaseSession;
+struct TaskRecord;
+
+struct TransferProgress
+{
+    qint64 rows = 0;
+    qint64 bytes = 0;
+    qint64 totalBytes = 0;
+    qint64 elapsedMs = 0;
+    bool finished = false;
+    bool ok = true;
+    QString error;
+    double rowsPerSecond() const { return elapsedMs > 0 ? rows * 1000.0 / elapsedMs : 0.0; }
+};
+
+// Streams tasks between the database and CSV or JSON Lines files one record
+// at a time. Imports commit in large batches through the repositories'
+// prepared statements and create missing topics as they go.
+class TaskTransfer
+{
+public:
+    enum Format { Csv, JsonLines };
+    using ProgressCallback = std::function<void(const TransferProgress &)>;
+    explicit TaskTransfer(DatabaseSession &session);
+    static Format formatForFile(const QString &fileName);
+    void setProgressCallback(const ProgressCallback &callback) { progressCallback = callback; }
+    TransferProgress importFile(const QString &fileName, Format format);
+    TransferProgress exportFile(const QString &fileName, Format format);
+private:
+    bool storeRecord(const TaskRecord &task, QString &error);
+    void report(TransferProgress &progress, bool force);
+    DatabaseSession &session;
+    ProgressCallback progressCallback;
+    qint64 lastReportMs = 0;
+};
+
+#endif // TASKTRANSFER_H
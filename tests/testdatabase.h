@@ -0,0 +1,48 @@
+#ifndef TESTDATABASE_H
+#define TESTDATABASE_H
+
+#include "schemamigrator.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVariant>
+
+// A uniquely named connection, migrated unless asked not to. Declare it
+// before any session or query that uses it so it is closed last.
+class TestDatabase
+{
+public:
+    explicit TestDatabase(const QString &fileName = QStringLiteral(":memory:"), bool migrate = true)
+        : name(QStringLiteral("test-%1").arg(++counter()))
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+        db.setDatabaseName(fileName);
+        if (!db.open()) return;
+        SchemaMigrator::configureConnection(db);
+        if (!migrate) return;
+        SchemaMigrator migrator(db);
+        migrated = migrator.migrate();
+        error = migrator.lastError();
+    }
+    ~TestDatabase()
+    {
+        QSqlDatabase::database(name, false).close();
+        QSqlDatabase::removeDatabase(name);
+    }
+    QSqlDatabase database() const { return QSqlDatabase::database(name, false); }
+    QVariant value(const QString &statement) const
+    {
+        QSqlQuery query(database());
+        return query.exec(statement) && query.next() ? query.value(0) : QVariant();
+    }
+    bool migrated = false;
+    QString error;
+private:
+    static int &counter()
+    {
+        static int count = 0;
+        return count;
+    }
+    QString name;
+};
+
+#endif // TESTDATABASE_H
@@ -0,0 +1,93 @@
+#include "recurrence.h"
+#include <QtTest>
+
+class TestRecurrence : public QObject
+{
+    Q_OBJECT
+private slots:
+    void roundTripsRules();
+    void weeklyByDay();
+    void countLimitsSeries();
+    void untilLimitsSeries();
+    void monthlyClampsToMonthEnd();
+    void nextFromFarFuture();
+};
+
+namespace {
+QDateTime at(int year, int month, int day)
+{
+    return QDateTime(QDate(year, month, day), QTime(9, 0));
+}
+}
+
+void TestRecurrence::roundTripsRules()
+{
+    const QString rule = "FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,TH;COUNT=4";
+    QCOMPARE(Recurrence::fromRule(rule).toRule(), rule);
+    QCOMPARE(Recurrence::fromRule("freq=daily;until=20240105").toRule(), QString("FREQ=DAILY;UNTIL=20240105"));
+    QVERIFY(!Recurrence::fromRule("FREQ=HOURLY").isRecurring());
+    QVERIFY(Recurrence::fromRule(QString()).toRule().isEmpty());
+}
+
+void TestRecurrence::weeklyByDay()
+{
+    // 2024-01-01 is a Monday.
+    Recurrence rule = Recurrence::fromRule("FREQ=WEEKLY;BYDAY=MO,TH");
+    QDateTime start = at(2024, 1, 1);
+    QCOMPARE(rule.next(start, start), start);
+    QCOMPARE(rule.next(start, start.addSecs(1)), at(2024, 1, 4));
+    QCOMPARE(rule.next(start, at(2024, 1, 5)), at(2024, 1, 8));
+    const QVector<QDateTime> occurrences = rule.between(start, start, at(2024, 1, 15), 10);
+    QCOMPARE(occurrences, QVector<QDateTime>({at(2024, 1, 1), at(2024, 1, 4), at(2024, 1, 8), at(2024, 1, 11)}));
+
+    // A series starting mid-week does not go back to earlier weekdays.
+    QDateTime wednesday = at(2024, 1, 3);
+    QCOMPARE(rule.next(wednesday, wednesday), at(2024, 1, 4));
+}
+
+void TestRecurrence::countLimitsSeries()
+{
+    QDateTime start = at(2024, 1, 1);
+    Recurrence daily = Recurrence::fromRule("FREQ=DAILY;COUNT=3");
+    QCOMPARE(daily.between(start, start, start.addDays(10), 10).size(), 3);
+    QVERIFY(!daily.next(start, at(2024, 1, 4)).isValid());
+
+    Recurrence weekly = Recurrence::fromRule("FREQ=WEEKLY;BYDAY=MO,TH;COUNT=3");
+    QCOMPARE(weekly.between(start, start, start.addDays(30), 10),
+             QVector<QDateTime>({at(2024, 1, 1), at(2024, 1, 4), at(2024, 1, 8)}));
+    QDateTime thursday = at(2024, 1, 4);
+    QCOMPARE(weekly.between(thursday, thursday, thursday.addDays(30), 10),
+             QVector<QDateTime>({at(2024, 1, 4), at(2024, 1, 8), at(2024, 1, 11)}));
+}
+
+void TestRecurrence::untilLimitsSeries()
+{
+    QDateTime start = at(2024, 1, 1);
+    Recurrence rule = Recurrence::fromRule("FREQ=DAILY;UNTIL=20240105");
+    const QVector<QDateTime> occurrences = rule.between(start, start, start.addDays(30), 30);
+    QCOMPARE(occurrences.size(), 5);
+    QCOMPARE(occurrences.last(), at(2024, 1, 5));
+    QVERIFY(!rule.next(start, at(2024, 1, 6)).isValid());
+}
+
+void TestRecurrence::monthlyClampsToMonthEnd()
+{
+    Recurrence rule = Recurrence::fromRule("FREQ=MONTHLY");
+    QDateTime start = at(2024, 1, 31);
+    QCOMPARE(rule.next(start, at(2024, 2, 1)), at(2024, 2, 29));
+    QCOMPARE(rule.next(start, at(2024, 3, 1)), at(2024, 3, 31));
+}
+
+void TestRecurrence::nextFromFarFuture()
+{
+    Recurrence rule = Recurrence::fromRule("FREQ=DAILY;INTERVAL=3");
+    QDateTime start = at(2024, 1, 1);
+    QDateTime from = at(2124, 1, 1);
+    QDateTime next = rule.next(start, from);
+    QVERIFY(next >= from);
+    QCOMPARE(start.date().daysTo(next.date()) % 3, qint64(0));
+    QVERIFY(start.date().daysTo(next.date()) - start.date().daysTo(from.date()) < 3);
+}
+
+QTEST_GUILESS_MAIN(TestRecurrence)
+#include "tst_recurrence.moc"
@@ -0,0 +1,269 @@
+#include "databaseworker.h"
+#include "tasktransfer.h"
+#include "testdatabase.h"
+#include <QtTest>
+
+class TestRepositories : public QObject
+{
+    Q_OBJECT
+private slots:
+    void migratesEmptyDatabase();
+    void migratesBaselineDatabase();
+    void insertsFindsAndUpdatesTasks();
+    void pagesTasksById();
+    void updatesTasksInBulk();
+    void renamesTopics();
+    void reportsTopicsBeingDeleted();
+    void skipsDeadlinesOfDeletedTopics();
+    void summarizesTopics();
+    void importsUndatedTasks();
+};
+
+namespace {
+int addTask(DatabaseSession &session, int topicId, const QString &name, const QDateTime &due, bool done = false)
+{
+    TaskRecord task;
+    task.topicId = topicId;
+    task.name = name;
+    task.description = name + " description";
+    task.dueDate = due;
+    task.done = done;
+    return session.tasks().insert(task);
+}
+}
+
+void TestRepositories::migratesEmptyDatabase()
+{
+    TestDatabase test;
+    QVERIFY2(test.migrated, qPrintable(test.error));
+    QCOMPARE(SchemaMigrator(test.database()).currentVersion(), SchemaMigrator::latestVersion());
+    QCOMPARE(SchemaMigrator::latestVersion(), 8);
+    for (const char *table : {"topics", "tasks", "task_occurrences", "topic_stats", "change_log", "sync_state",
+                              "sync_journal", "sync_peers"}) {
+        QVERIFY2(test.value(QString("SELECT COUNT(*) FROM sqlite_master WHERE name = '%1'").arg(table)).toInt() == 1,
+                 table);
+    }
+    SchemaMigrator again(test.database());
+    QVERIFY(again.migrate());
+    QVERIFY(again.reports().isEmpty());
+}
+
+void TestRepositories::migratesBaselineDatabase()
+{
+    TestDatabase test(":memory:", false);
+    QSqlQuery query(test.database());
+    QVERIFY(query.exec("CREATE TABLE topics (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT UNIQUE)"));
+    QVERIFY(query.exec("CREATE TABLE tasks (id INTEGER PRIMARY KEY AUTOINCREMENT, topic_id INTEGER, name TEXT, "
+                       "due_date TEXT, notify INTEGER, notified INTEGER DEFAULT 0, "
+                       "FOREIGN KEY(topic_id) REFERENCES topics(id) ON DELETE CASCADE)"));
+    QVERIFY(query.exec("INSERT INTO topics (name) VALUES ('Old')"));
+    QVERIFY(query.exec("INSERT INTO tasks (topic_id, name, due_date, notify) VALUES (1, 'kept', '2030-01-02T03:04:05', 1)"));
+    query.finish();
+
+    SchemaMigrator migrator(test.database());
+    QVERIFY2(migrator.migrate(), qPrintable(migrator.lastError()));
+    QCOMPARE(migrator.reports().size(), SchemaMigrator::latestVersion());
+    QCOMPARE(test.value("SELECT done FROM tasks").toInt(), 0);
+    QVERIFY(!test.value("SELECT due_at FROM tasks").isNull());
+    QVERIFY(!test.value("SELECT uuid FROM tasks").isNull());
+    QCOMPARE(test.value("SELECT deleted FROM topics").toInt(), 0);
+    QCOMPARE(test.value("SELECT total FROM topic_stats").toInt(), 1);
+    QCOMPARE(test.value("SELECT COUNT(*) FROM sync_journal").toInt(), 2);
+
+    DatabaseSession session(test.database());
+    TaskRecord task;
+    QVERIFY(session.tasks().find(1, task));
+    QCOMPARE(task.name, QString("kept"));
+    QCOMPARE(task.topicName, QString("Old"));
+}
+
+void TestRepositories::insertsFindsAndUpdatesTasks()
+{
+    TestDatabase test;
+    DatabaseSession session(test.database());
+    int topicId = session.topics().insert("Work");
+    QVERIFY(topicId > 0);
+    QCOMPARE(session.topics().insert("Work"), topicId);
+    QDateTime due(QDate(2030, 5, 6), QTime(7, 8, 9));
+    int taskId = addTask(session, topicId, "Report", due);
+    QVERIFY2(taskId > 0, qPrintable(session.tasks().lastError()));
+
+    TaskRecord task;
+    QVERIFY(session.tasks().find(taskId, task));
+    QCOMPARE(task.name, QString("Report"));
+    QCOMPARE(task.topicName, QString("Work"));
+    QCOMPARE(task.dueDate, due);
+    QCOMPARE(session.tasks().description(taskId), QString("Report description"));
+
+    task.id = taskId;
+    task.name = "Final report";
+    task.dueDate = due.addDays(1);
+    QVERIFY(session.tasks().update(task));
+    QVERIFY(session.tasks().setDone(taskId, true));
+    TaskRecord updated;
+    QVERIFY(session.tasks().find(taskId, updated));
+    QCOMPARE(updated.name, QString("Final report"));
+    QCOMPARE(updated.dueDate, due.addDays(1));
+    QVERIFY(updated.done);
+    QCOMPARE(test.value(QString("SELECT due_at FROM tasks WHERE id = %1").arg(taskId)).toLongLong(),
+             due.addDays(1).toSecsSinceEpoch());
+
+    QVERIFY(session.tasks().remove(taskId));
+    QVERIFY(!session.tasks().find(taskId, updated));
+}
+
+void TestRepositories::pagesTasksById()
+{
+    TestDatabase test;
+    DatabaseSession session(test.database());
+    int topicId = session.topics().insert("Work");
+    int otherId = session.topics().insert("Home");
+    QDateTime due = QDateTime::currentDateTime().addDays(1);
+    QVector<int> ids;
+    for (int i = 0; i < 5; ++i) {
+        ids.append(addTask(session, topicId, QString("task %1").arg(i), due));
+        addTask(session, otherId, QString("other %1").arg(i), due);
+    }
+    const QVector<TaskRecord> first = session.tasks().page(topicId, 0, 2);
+    QCOMPARE(first.size(), 2);
+    QCOMPARE(first.at(0).id, ids.at(0));
+    QCOMPARE(first.at(1).id, ids.at(1));
+    const QVector<TaskRecord> rest = session.tasks().page(topicId, first.last().id, 10);
+    QCOMPARE(rest.size(), 3);
+    QCOMPARE(rest.last().id, ids.last());
+    QCOMPARE(session.tasks().names(topicId, {ids.at(1), ids.at(3)}),
+             QStringList({"task 1", "task 3"}));
+    QCOMPARE(session.tasks().countByTopic(topicId), qint64(5));
+}
+
+void TestRepositories::updatesTasksInBulk()
+{
+    TestDatabase test;
+    DatabaseSession session(test.database());
+    int topicId = session.topics().insert("Work");
+    int otherId = session.topics().insert("Home");
+    QDateTime due = QDateTime::currentDateTime().addDays(1);
+    QVector<int> ids;
+    for (int i = 0; i < 4; ++i) ids.append(addTask(session, topicId, QString("task %1").arg(i), due));
+
+    QVERIFY(session.tasks().setDone({ids.at(0), ids.at(1)}, true));
+    QCOMPARE(test.value("SELECT COUNT(*) FROM tasks WHERE done = 1").toInt(), 2);
+    QVERIFY(session.tasks().moveToTopic({ids.at(2)}, otherId));
+    QCOMPARE(session.tasks().countByTopic(otherId), qint64(1));
+    QDateTime later = due.addDays(3);
+    QVERIFY(session.tasks().reschedule({ids.at(0), ids.at(3)}, later));
+    QCOMPARE(test.value(QString("SELECT due_at FROM tasks WHERE id = %1").arg(ids.at(3))).toLongLong(),
+             later.toSecsSinceEpoch());
+    QVERIFY(session.tasks().remove(QVector<int>{ids.at(0), ids.at(1)}));
+    QCOMPARE(session.tasks().countByTopic(topicId), qint64(1));
+}
+
+void TestRepositories::renamesTopics()
+{
+    TestDatabase test;
+    DatabaseSession session(test.database());
+    int topicId = session.topics().insert("Work");
+    QVERIFY(session.topics().rename("Work", "Office"));
+    QCOMPARE(session.topics().idForName("Office"), topicId);
+    QCOMPARE(session.topics().idForName("Work"), -1);
+    const QVector<TopicRecord> topics = session.topics().all();
+    QCOMPARE(topics.size(), 1);
+    QCOMPARE(topics.first().name, QString("Office"));
+}
+
+void TestRepositories::reportsTopicsBeingDeleted()
+{
+    TestDatabase test;
+    DatabaseSession session(test.database());
+    int topicId = session.topics().insert("Work");
+    session.topics().insert("Home");
+    QVERIFY(session.topics().setDeleted(topicId, true));
+    QCOMPARE(session.topics().insert("Work"), -1);
+    QVERIFY(session.topics().lastError().contains("being deleted"));
+    QVERIFY(!session.topics().rename("Home", "Work"));
+    QVERIFY(session.topics().lastError().contains("being deleted"));
+    QVERIFY(session.topics().purge(topicId));
+    QVERIFY(session.topics().insert("Work") > 0);
+}
+
+void TestRepositories::skipsDeadlinesOfDeletedTopics()
+{
+    TestDatabase test;
+    DatabaseSession session(test.database());
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    int keptId = session.topics().insert("Work");
+    int deletedId = session.topics().insert("Old");
+    for (int topicId : {keptId, deletedId}) {
+        TaskRecord task;
+        task.topicId = topicId;
+        task.name = "late";
+        task.dueDate = QDateTime::fromSecsSinceEpoch(now - 60);
+        task.notify = true;
+        QVERIFY(session.tasks().insert(task) > 0);
+    }
+    QVERIFY(session.topics().setDeleted(deletedId, true));
+    const QVector<TaskDeadline> deadlines = session.tasks().pendingDeadlines(10);
+    QCOMPARE(deadlines.size(), 1);
+    QCOMPARE(session.tasks().dueTasks(now).size(), 1);
+    QVERIFY(session.tasks().markDueNotified(now));
+    QCOMPARE(test.value("SELECT COUNT(*) FROM tasks WHERE notified = 0").toInt(), 1);
+    QVERIFY(session.tasks().pendingDeadlines(10).isEmpty());
+}
+
+void TestRepositories::summarizesTopics()
+{
+    TestDatabase test;
+    DatabaseSession session(test.database());
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    int topicId = session.topics().insert("Work");
+    addTask(session, topicId, "late", QDateTime::fromSecsSinceEpoch(now - 3600));
+    addTask(session, topicId, "finished", QDateTime::fromSecsSinceEpoch(now - 3600), true);
+    addTask(session, topicId, "soon", QDateTime::fromSecsSinceEpoch(now + 3600));
+    QVector<TopicSummary> summaries = session.topics().summaries();
+    QCOMPARE(summaries.size(), 1);
+    QCOMPARE(summaries.first().total, 3);
+    QCOMPARE(summaries.first().done, 1);
+    QCOMPARE(summaries.first().overdue, 1);
+    QCOMPARE(summaries.first().nextDue, now + 3600);
+
+    // Nothing falls due before the next task, so the clock is left alone.
+    qint64 clock = test.value("SELECT now FROM stats_clock").toLongLong();
+    QVERIFY(session.topics().advanceClock(now + 60));
+    QCOMPARE(test.value("SELECT now FROM stats_clock").toLongLong(), clock);
+    QVERIFY(session.topics().advanceClock(now + 7200));
+    QCOMPARE(test.value("SELECT now FROM stats_clock").toLongLong(), now + 7200);
+    summaries = session.topics().summaries();
+    QCOMPARE(summaries.first().overdue, 2);
+    QCOMPARE(summaries.first().nextDue, qint64(0));
+}
+
+void TestRepositories::importsUndatedTasks()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath("tasks.csv"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("topic,name,description,due_date,notify,notified,done,recurrence\n"
+               "Work,someday,,,0,0,0,\n"
+               "Work,dated,,2030-01-02T03:04:05,1,0,0,\n");
+    file.close();
+
+    TestDatabase test;
+    DatabaseSession session(test.database());
+    TaskTransfer transfer(session);
+    TransferProgress progress = transfer.importFile(file.fileName(), TaskTransfer::Csv);
+    QVERIFY2(progress.ok, qPrintable(progress.error));
+    QCOMPARE(progress.rows, qint64(2));
+    QVERIFY(test.value("SELECT due_at FROM tasks WHERE name = 'someday'").isNull());
+    QVERIFY(test.value("SELECT due_date FROM tasks WHERE name = 'someday'").isNull());
+    QVERIFY(!test.value("SELECT due_at FROM tasks WHERE name = 'dated'").isNull());
+
+    TaskRecord task;
+    QVERIFY(session.tasks().find(test.value("SELECT id FROM tasks WHERE name = 'someday'").toInt(), task));
+    QVERIFY(!task.dueDate.isValid());
+    QVERIFY(session.tasks().update(task));
+    QVERIFY(test.value("SELECT due_at FROM tasks WHERE name = 'someday'").isNull());
+}
+
+QTEST_GUILESS_MAIN(TestRepositories)
+#include "tst_repositories.moc"
@@ -0,0 +1,246 @@
+#include "databaseworker.h"
+#include "syncprotocol.h"
+#include "testdatabase.h"
+#include <QtTest>
+
+class TestSync : public QObject
+{
+    Q_OBJECT
+private slots:
+    void encodesMessages();
+    void roundTripsBetweenReplicas();
+    void resolvesConflictsDeterministically();
+    void separatesTopicsWithTheSameName();
+    void refusesCopiedReplica();
+    void sendsTopicsWithTheirTasks();
+};
+
+namespace {
+SyncStats sync(const TestDatabase &client, const TestDatabase &server)
+{
+    SyncServer peer(server.database());
+    return SyncClient(client.database()).run([&peer](const QByteArray &request, QByteArray &reply) {
+        reply = peer.handle(request);
+        return true;
+    });
+}
+
+int addTask(const TestDatabase &test, const QString &topic, const QString &name)
+{
+    DatabaseSession session(test.database());
+    TaskRecord task;
+    task.topicId = session.topics().insert(topic);
+    task.name = name;
+    task.dueDate = QDateTime::currentDateTime().addDays(1);
+    return session.tasks().insert(task);
+}
+
+QStringList column(const TestDatabase &test, const QString &statement)
+{
+    QStringList values;
+    QSqlQuery query(test.database());
+    if (query.exec(statement)) {
+        while (query.next()) values.append(query.value(0).toString());
+    }
+    return values;
+}
+
+QStringList taskNames(const TestDatabase &test)
+{
+    return column(test, "SELECT t.name || '@' || tp.name FROM tasks t JOIN topics tp ON tp.id = t.topic_id "
+                        "ORDER BY t.name");
+}
+
+QStringList topicNames(const TestDatabase &test)
+{
+    return column(test, "SELECT name FROM topics WHERE deleted = 0 ORDER BY name");
+}
+}
+
+void TestSync::encodesMessages()
+{
+    SyncMessage message;
+    message.type = SyncMessage::Batch;
+    message.batch.replica = "replica-a";
+    message.batch.lastSequence = 42;
+    message.batch.more = true;
+    SyncRecord task;
+    task.uuid = QByteArray(16, '\x01');
+    task.clock = 7;
+    task.origin = "replica-b";
+    task.topicUuid = QByteArray(16, '\x02');
+    task.name = QString::fromUtf8("Zürich");
+    task.dueAt = 1700000000;
+    task.done = true;
+    SyncRecord removed;
+    removed.entity = ChangeLog::TopicEntity;
+    removed.uuid = QByteArray(16, '\x03');
+    removed.clock = 9;
+    removed.origin = "replica-a";
+    removed.removed = true;
+    message.batch.records = {task, removed};
+
+    SyncMessage decoded;
+    QVERIFY(SyncProtocol::decode(SyncProtocol::encode(message), decoded));
+    QCOMPARE(decoded.type, SyncMessage::Batch);
+    QCOMPARE(decoded.batch.replica, QString("replica-a"));
+    QCOMPARE(decoded.batch.lastSequence, qint64(42));
+    QVERIFY(decoded.batch.more);
+    QCOMPARE(decoded.batch.records.size(), 2);
+    const SyncRecord &first = decoded.batch.records.at(0);
+    QCOMPARE(first.uuid, task.uuid);
+    QCOMPARE(first.topicUuid, task.topicUuid);
+    QCOMPARE(first.origin, task.origin);
+    QCOMPARE(first.name, task.name);
+    QCOMPARE(first.dueAt, task.dueAt);
+    QCOMPARE(first.dueDate, TaskBrief::NoDue);
+    QVERIFY(first.done);
+    QVERIFY(!first.notify);
+    const SyncRecord &second = decoded.batch.records.at(1);
+    QCOMPARE(second.entity, int(ChangeLog::TopicEntity));
+    QVERIFY(second.removed);
+    QCOMPARE(second.origin, QString("replica-a"));
+
+    QByteArray frame = SyncProtocol::encode(message);
+    frame.chop(1);
+    QVERIFY(!SyncProtocol::decode(frame, decoded));
+}
+
+void TestSync::roundTripsBetweenReplicas()
+{
+    TestDatabase a;
+    TestDatabase b;
+    QVERIFY(addTask(a, "Work", "report") > 0);
+    QVERIFY(addTask(b, "Home", "laundry") > 0);
+
+    SyncStats stats = sync(a, b);
+    QVERIFY2(stats.ok, qPrintable(stats.error));
+    QCOMPARE(stats.pulled, 2);
+    QCOMPARE(stats.pushed, 2);
+    QCOMPARE(taskNames(a), QStringList({"laundry@Home", "report@Work"}));
+    QCOMPARE(taskNames(b), taskNames(a));
+    QCOMPARE(column(a, "SELECT hex(uuid) FROM tasks ORDER BY hex(uuid)"),
+             column(b, "SELECT hex(uuid) FROM tasks ORDER BY hex(uuid)"));
+
+    // Nothing changed, so nothing moves but the handshake.
+    stats = sync(a, b);
+    QVERIFY2(stats.ok, qPrintable(stats.error));
+    QCOMPARE(stats.pulled, 0);
+    QCOMPARE(stats.pushed, 0);
+
+    {
+        DatabaseSession session(b.database());
+        QVERIFY(session.tasks().remove(session.tasks().page(session.topics().idForName("Work"), 0, 10).first().id));
+        QVERIFY(session.topics().rename("Home", "House"));
+    }
+    QVERIFY(addTask(a, "Work", "slides") > 0);
+    stats = sync(a, b);
+    QVERIFY2(stats.ok, qPrintable(stats.error));
+    QCOMPARE(taskNames(a), QStringList({"laundry@House", "slides@Work"}));
+    QCOMPARE(taskNames(b), taskNames(a));
+}
+
+void TestSync::resolvesConflictsDeterministically()
+{
+    TestDatabase a;
+    TestDatabase b;
+    TestDatabase c;
+    addTask(a, "Work", "draft");
+    QVERIFY(sync(a, b).ok);
+    QVERIFY(sync(c, b).ok);
+    QCOMPARE(taskNames(c), QStringList({"draft@Work"}));
+
+    // Each replica renames the same task without seeing the others.
+    const QStringList names = {"from a", "from b", "from c"};
+    const TestDatabase *replicas[] = {&a, &b, &c};
+    for (int i = 0; i < 3; ++i) {
+        QSqlQuery query(replicas[i]->database());
+        QVERIFY(query.exec(QString("UPDATE tasks SET name = '%1'").arg(names.at(i))));
+    }
+    QVERIFY(sync(a, b).ok);
+    QVERIFY(sync(c, b).ok);
+    QVERIFY(sync(a, b).ok);
+    QCOMPARE(taskNames(a).size(), 1);
+    QCOMPARE(taskNames(b), taskNames(a));
+    QCOMPARE(taskNames(c), taskNames(a));
+}
+
+void TestSync::separatesTopicsWithTheSameName()
+{
+    TestDatabase a;
+    TestDatabase b;
+    addTask(a, "Shared", "from a");
+    addTask(b, "Shared", "from b");
+    SyncStats stats = sync(a, b);
+    QVERIFY2(stats.ok, qPrintable(stats.error));
+    QCOMPARE(topicNames(a).size(), 2);
+    QCOMPARE(topicNames(a).first(), QString("Shared"));
+    QVERIFY(topicNames(a).last().startsWith("Shared ("));
+    QCOMPARE(topicNames(b), topicNames(a));
+    QCOMPARE(taskNames(b), taskNames(a));
+}
+
+void TestSync::refusesCopiedReplica()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString original = dir.filePath("original.db");
+    QString copy = dir.filePath("copy.db");
+    {
+        TestDatabase a(original);
+        addTask(a, "Work", "report");
+        QSqlQuery query(a.database());
+        QVERIFY(query.exec("PRAGMA wal_checkpoint(TRUNCATE)"));
+    }
+    QVERIFY(QFile::copy(original, copy));
+    TestDatabase a(original);
+    TestDatabase b(copy);
+    SyncStats stats = sync(b, a);
+    QVERIFY(!stats.ok);
+    QVERIFY(stats.error.contains("--new-replica"));
+
+    QVERIFY(SyncJournal(b.database()).resetReplica());
+    addTask(b, "Work", "copy only");
+    stats = sync(b, a);
+    QVERIFY2(stats.ok, qPrintable(stats.error));
+    QCOMPARE(stats.local.applied, 0);
+    QCOMPARE(stats.remote.applied, 1);
+    QCOMPARE(taskNames(a), QStringList({"copy only@Work", "report@Work"}));
+}
+
+void TestSync::sendsTopicsWithTheirTasks()
+{
+    TestDatabase a;
+    TestDatabase b;
+    QVERIFY(addTask(a, "Old", "first") > 0);
+    {
+        // More entries than one batch holds between the task and its topic,
+        // whose entry moves to the end of the journal when it is renamed.
+        DatabaseSession session(a.database());
+        QVERIFY(a.database().transaction());
+        int topicId = session.topics().insert("Bulk");
+        for (int i = 0; i < 2100; ++i) {
+            TaskRecord task;
+            task.topicId = topicId;
+            task.name = QString("bulk %1").arg(i, 4, 10, QChar('0'));
+            QVERIFY(session.tasks().insert(task) > 0);
+        }
+        QVERIFY(a.database().commit());
+        QVERIFY(session.topics().rename("Old", "New"));
+    }
+    SyncStats stats = sync(b, a);
+    QVERIFY2(stats.ok, qPrintable(stats.error));
+    QCOMPARE(stats.local.applied, 2103);
+    QCOMPARE(column(b, "SELECT COUNT(*) FROM tasks").first(), QString("2101"));
+    QCOMPARE(taskNames(b).first(), QString("bulk 0000@Bulk"));
+    QCOMPARE(taskNames(b).last(), QString("first@New"));
+    QCOMPARE(topicNames(b), QStringList({"Bulk", "New"}));
+
+    stats = sync(b, a);
+    QVERIFY2(stats.ok, qPrintable(stats.error));
+    QCOMPARE(stats.local.applied, 0);
+    QCOMPARE(stats.pushed, 0);
+}
+
+QTEST_GUILESS_MAIN(TestSync)
+#include "tst_sync.moc"
@@ -0,0 +1,126 @@
+#include "tasksnapshot.h"
+#include "taskrepository.h"
+#include <QtTest>
+
+class TestTaskSnapshot : public QObject
+{
+    Q_OBJECT
+private slots:
+    void upsertKeepsRowsById();
+    void selectSortsAndFilters();
+    void removedRowsLeaveSelection();
+    void selectsLargeSnapshotInOrder();
+};
+
+namespace {
+TaskBrief brief(int id, const QString &topic, const QString &name, qint64 dueAt, bool done = false)
+{
+    TaskBrief task;
+    task.id = id;
+    task.topicName = topic;
+    task.name = name;
+    task.dueAt = dueAt;
+    task.done = done;
+    return task;
+}
+
+QVector<int> taskIds(const TaskSnapshot &snapshot, const std::vector<int> &rows)
+{
+    QVector<int> ids;
+    for (int row : rows) ids.append(snapshot.taskId(row));
+    return ids;
+}
+
+void fill(TaskSnapshot &snapshot)
+{
+    snapshot.upsert(brief(3, "B", "third", 300));
+    snapshot.upsert(brief(1, "a", "first", 100, true));
+    snapshot.upsert(brief(2, "A", "second", 200));
+    snapshot.upsert(brief(4, "B", "undated", TaskBrief::NoDue));
+}
+}
+
+void TestTaskSnapshot::upsertKeepsRowsById()
+{
+    TaskSnapshot snapshot;
+    fill(snapshot);
+    QCOMPARE(snapshot.rowCount(), 4);
+    QCOMPARE(snapshot.rowForTask(1), 0);
+    QCOMPARE(snapshot.rowForTask(4), 3);
+    QCOMPARE(snapshot.rowForTask(5), -1);
+    QCOMPARE(snapshot.name(snapshot.rowForTask(2)), QString("second"));
+    QCOMPARE(snapshot.topicName(snapshot.rowForTask(3)), QString("B"));
+
+    int row = snapshot.upsert(brief(2, "B", "renamed", 250, true));
+    QCOMPARE(row, 1);
+    QCOMPARE(snapshot.rowCount(), 4);
+    QCOMPARE(snapshot.name(row), QString("renamed"));
+    QCOMPARE(snapshot.topicName(row), QString("B"));
+    QCOMPARE(snapshot.dueAt(row), qint64(250));
+    QVERIFY(snapshot.isDone(row));
+    QCOMPARE(snapshot.setDone(2, false), row);
+    QVERIFY(!snapshot.isDone(row));
+}
+
+void TestTaskSnapshot::selectSortsAndFilters()
+{
+    TaskSnapshot snapshot;
+    fill(snapshot);
+    TaskSnapshot::Order order;
+    QCOMPARE(taskIds(snapshot, snapshot.select(TaskSnapshot::Filter(), order)), QVector<int>({1, 2, 3, 4}));
+    order.descending = true;
+    QCOMPARE(taskIds(snapshot, snapshot.select(TaskSnapshot::Filter(), order)), QVector<int>({4, 3, 2, 1}));
+
+    // Topics compare case-insensitively first, so "A" and "a" sort together.
+    order.key = TaskSnapshot::ByTopic;
+    order.descending = false;
+    QCOMPARE(taskIds(snapshot, snapshot.select(TaskSnapshot::Filter(), order)), QVector<int>({2, 1, 3, 4}));
+    order.key = TaskSnapshot::ByState;
+    QCOMPARE(taskIds(snapshot, snapshot.select(TaskSnapshot::Filter(), order)), QVector<int>({2, 3, 4, 1}));
+
+    TaskSnapshot::Filter filter;
+    filter.done = TaskSnapshot::OpenOnly;
+    QCOMPARE(taskIds(snapshot, snapshot.select(filter, TaskSnapshot::Order())), QVector<int>({2, 3, 4}));
+    filter.topic = snapshot.topicIndex("B");
+    QCOMPARE(taskIds(snapshot, snapshot.select(filter, TaskSnapshot::Order())), QVector<int>({3, 4}));
+    filter = TaskSnapshot::Filter();
+    filter.dueFrom = 150;
+    filter.dueTo = 300;
+    QCOMPARE(taskIds(snapshot, snapshot.select(filter, TaskSnapshot::Order())), QVector<int>({2, 3}));
+}
+
+void TestTaskSnapshot::removedRowsLeaveSelection()
+{
+    TaskSnapshot snapshot;
+    fill(snapshot);
+    QCOMPARE(snapshot.remove(2), 1);
+    QCOMPARE(snapshot.remove(2), -1);
+    QCOMPARE(snapshot.liveCount(), 3);
+    QCOMPARE(taskIds(snapshot, snapshot.select(TaskSnapshot::Filter(), TaskSnapshot::Order())),
+             QVector<int>({1, 3, 4}));
+    snapshot.removeTopic("B");
+    QCOMPARE(taskIds(snapshot, snapshot.select(TaskSnapshot::Filter(), TaskSnapshot::Order())), QVector<int>({1}));
+    snapshot.compact();
+    QCOMPARE(snapshot.rowCount(), 1);
+    QCOMPARE(snapshot.name(0), QString("first"));
+}
+
+void TestTaskSnapshot::selectsLargeSnapshotInOrder()
+{
+    // Enough rows for select() to split the work across threads.
+    TaskSnapshot snapshot;
+    const int count = 200000;
+    for (int id = 1; id <= count; ++id) {
+        snapshot.upsert(brief(id, QString("topic %1").arg(id % 7), "task", qint64((id * 7919) % 1000), id % 3 == 0));
+    }
+    TaskSnapshot::Order order;
+    const std::vector<int> rows = snapshot.select(TaskSnapshot::Filter(), order);
+    QCOMPARE(int(rows.size()), count);
+    for (size_t i = 1; i < rows.size(); ++i) QVERIFY(!snapshot.lessThan(rows[i], rows[i - 1], order));
+    TaskSnapshot::Filter filter;
+    filter.done = TaskSnapshot::DoneOnly;
+    QCOMPARE(int(snapshot.select(filter, order).size()), count / 3);
+}
+
+QTEST_GUILESS_MAIN(TestTaskSnapshot)
+#include "tst_tasksnapshot.moc"
@@ -0,0 +1,91 @@
+#include "topicindex.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+class TestTopicIndex : public QObject
+{
+    Q_OBJECT
+private slots:
+    void sortsByFoldedName();
+    void prefixRange();
+    void insertsRenamesAndRemoves();
+};
+
+namespace {
+QVector<TopicSummary> summaries(const QStringList &names)
+{
+    QVector<TopicSummary> topics;
+    for (int i = 0; i < names.size(); ++i) {
+        TopicSummary topic;
+        topic.id = i + 1;
+        topic.name = names.at(i);
+        topics.append(topic);
+    }
+    return topics;
+}
+
+QStringList namesIn(const TopicIndex &index, std::pair<int, int> range)
+{
+    QStringList names;
+    for (int position = range.first; position < range.second; ++position) names.append(index.at(position).name);
+    return names;
+}
+}
+
+void TestTopicIndex::sortsByFoldedName()
+{
+    TopicIndex index;
+    index.reset(summaries({"beta", "Alpha", "alpine", "Gamma", "alp"}));
+    QCOMPARE(index.names(), QStringList({"alp", "Alpha", "alpine", "beta", "Gamma"}));
+    QCOMPARE(index.find("Alpha"), 1);
+    QCOMPARE(index.find("alpha"), -1);
+    QCOMPARE(index.at(index.find("Gamma")).id, 4);
+}
+
+void TestTopicIndex::prefixRange()
+{
+    TopicIndex index;
+    index.reset(summaries({"beta", "Alpha", "alpine", "Gamma", "alp", "Beta"}));
+    QCOMPARE(namesIn(index, index.prefixRange("al")), QStringList({"alp", "Alpha", "alpine"}));
+    QCOMPARE(index.prefixRange("AL"), index.prefixRange("al"));
+    QCOMPARE(namesIn(index, index.prefixRange("alph")), QStringList({"Alpha"}));
+    QCOMPARE(namesIn(index, index.prefixRange("b")), QStringList({"Beta", "beta"}));
+    std::pair<int, int> none = index.prefixRange("z");
+    QCOMPARE(none.first, none.second);
+    QCOMPARE(index.prefixRange("alpz").first, index.prefixRange("alpz").second);
+    QCOMPARE(index.prefixRange(QString()), std::make_pair(0, index.size()));
+    QVERIFY(index.matches(0, "AL"));
+    QVERIFY(!index.matches(3, "al"));
+}
+
+void TestTopicIndex::insertsRenamesAndRemoves()
+{
+    TopicIndex index;
+    index.reset(summaries({"beta", "alpha"}));
+    QSignalSpy inserted(&index, &TopicIndex::inserted);
+    QSignalSpy moved(&index, &TopicIndex::moved);
+    QSignalSpy removed(&index, &TopicIndex::removed);
+
+    TopicSummary topic;
+    topic.id = 10;
+    topic.name = "Alps";
+    QCOMPARE(index.insert(topic), 1);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(index.insert(topic), 1);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(namesIn(index, index.prefixRange("alp")), QStringList({"alpha", "Alps"}));
+
+    QVERIFY(index.rename("alpha", "zeta"));
+    QVERIFY(!index.rename("beta", "Alps"));
+    QCOMPARE(moved.count(), 1);
+    QCOMPARE(index.names(), QStringList({"Alps", "beta", "zeta"}));
+
+    QVERIFY(index.remove("beta"));
+    QVERIFY(!index.remove("beta"));
+    QCOMPARE(removed.count(), 1);
+    QCOMPARE(removed.first().first().toInt(), 1);
+    QCOMPARE(index.names(), QStringList({"Alps", "zeta"}));
+}
+
+QTEST_GUILESS_MAIN(TestTopicIndex)
+#include "tst_topicindex.moc"
@@ -0,0 +1,54 @@
+#include "topicbadgedelegate.h"
+#include <QApplication>
+#include <QPainter>
+
+namespace {
+const int BadgeMargin = 4;
+const int BadgePadding = 6;
+}
+
+TopicBadgeDelegate::TopicBadgeDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+void TopicBadgeDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    int open = index.data(OpenCountRole).toInt();
+    int overdue = index.data(OverdueCountRole).toInt();
+    QStyleOptionViewItem background = option;
+    initStyleOption(&background, index);
+    QStyle *style = background.widget ? background.widget->style() : QApplication::style();
+    style->drawPrimitive(QStyle::PE_PanelItemViewItem, &background, painter, background.widget);
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    QFont font = option.font;
+    font.setPointSizeF(font.pointSizeF() * 0.85);
+    font.setBold(true);
+    painter->setFont(font);
+    QStyleOptionViewItem badges = option;
+    badges.font = font;
+    int right = option.rect.right() - BadgeMargin;
+    if (overdue > 0) right = paintBadge(painter, badges, right, QString::number(overdue), QColor(0xc0, 0x39, 0x2b));
+    if (open > 0) right = paintBadge(painter, badges, right, QString::number(open), option.palette.color(QPalette::Mid));
+    painter->restore();
+
+    QStyleOptionViewItem text = option;
+    text.rect.setRight(right);
+    QStyledItemDelegate::paint(painter, text, index);
+}
+
+int TopicBadgeDelegate::paintBadge(QPainter *painter, const QStyleOptionViewItem &option, int right,
+                                   const QString &text, const QColor &color) const
+{
+    QFontMetrics metrics(option.font);
+    int height = metrics.height() + 2;
+    int width = qMax(height, metrics.horizontalAdvance(text) + 2 * BadgePadding);
+    QRect rect(right - width, option.rect.center().y() - height / 2, width, height);
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(color);
+    painter->drawRoundedRect(rect, height / 2.0, height / 2.0);
+    painter->setPen(Qt::white);
+    painter->drawText(rect, Qt::AlignCenter, text);
+    return rect.left() - BadgeMargin;
+}
@@ -0,0 +1,20 @@
+#ifndef TOPICBADGEDELEGATE_H
+#define TOPICBADGEDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+// Draws a topic's open and overdue task counts as badges at the right edge
+// of its row in the topic list.
+class TopicBadgeDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    enum Roles { OpenCountRole = Qt::UserRole + 1, OverdueCountRole };
+    explicit TopicBadgeDelegate(QObject *parent = nullptr);
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+private:
+    int paintBadge(QPainter *painter, const QStyleOptionViewItem &option, int right, const QString &text,
+                   const QColor &color) const;
+};
+
+#endif // TOPICBADGEDELEGATE_H
@@ -0,0 +1,63 @@
+#include "topicdashboard.h"
+#include "topicrepository.h"
+#include <QDateTime>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+namespace {
+QTableWidgetItem *countItem(qint64 value)
+{
+    QTableWidgetItem *item = new QTableWidgetItem();
+    item->setData(Qt::DisplayRole, value);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+}
+
+TopicDashboard::TopicDashboard(QWidget *parent)
+    : QDockWidget("Topic Summary", parent)
+{
+    setObjectName("topicDashboard");
+    QWidget *content = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(content);
+    totalsLabel = new QLabel(content);
+    layout->addWidget(totalsLabel);
+    table = new QTableWidget(0, 5, content);
+    table->setHorizontalHeaderLabels({"Topic", "Open", "Done", "Overdue", "Next Due"});
+    table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    table->verticalHeader()->hide();
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    layout->addWidget(table);
+    setWidget(content);
+    connect(table, &QTableWidget::cellDoubleClicked, this, [this](int row) {
+        emit topicActivated(table->item(row, 0)->text());
+    });
+}
+
+void TopicDashboard::setSummaries(const QVector<TopicSummary> &summaries)
+{
+    qint64 open = 0;
+    qint64 done = 0;
+    qint64 overdue = 0;
+    table->setSortingEnabled(false);
+    table->setRowCount(summaries.size());
+    for (int row = 0; row < summaries.size(); ++row) {
+        const TopicSummary &summary = summaries.at(row);
+        table->setItem(row, 0, new QTableWidgetItem(summary.name));
+        table->setItem(row, 1, countItem(summary.total - summary.done));
+        table->setItem(row, 2, countItem(summary.done));
+        table->setItem(row, 3, countItem(summary.overdue));
+        QTableWidgetItem *nextDue = new QTableWidgetItem();
+        if (summary.nextDue > 0) nextDue->setData(Qt::DisplayRole, QDateTime::fromSecsSinceEpoch(summary.nextDue));
+        table->setItem(row, 4, nextDue);
+        open += summary.total - summary.done;
+        done += summary.done;
+        overdue += summary.overdue;
+    }
+    table->setSortingEnabled(true);
+    totalsLabel->setText(QString("%1 topics: %2 open, %3 done, %4 overdue")
+                             .arg(summaries.size()).arg(open).arg(done).arg(overdue));
+}
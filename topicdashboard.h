@@ -0,0 +1,24 @@
+#ifndef TOPICDASHBOARD_H
+#define TOPICDASHBOARD_H
+
+#include <QDockWidget>
+#include <QVector>
+
+struct TopicSummary;
+class QLabel;
+class QTableWidget;
+
+class TopicDashboard : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit TopicDashboard(QWidget *parent = nullptr);
+    void setSummaries(const QVector<TopicSummary> &summaries);
+signals:
+    void topicActivated(const QString &topic);
+private:
+    QLabel *totalsLabel;
+    QTableWidget *table;
+};
+
+#endif // TOPICDASHBOARD_H
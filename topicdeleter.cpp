@@ -0,0 +1,199 @@
+#include "topicdeleter.h"
+#include "databaseworker.h"
+#include <QDebug>
+#include <QSqlQuery>
+#include <utility>
+
+namespace {
+const int BatchSize = 5000;
+const int VacuumPages = 4096;
+
+struct HiddenTopic
+{
+    int topicId = -1;
+    QString name;
+    qint64 total = 0;
+    QString error;
+};
+
+TopicDeleter::Step deleteBatch(DatabaseSession &session, int topicId)
+{
+    TopicDeleter::Step step;
+    QSqlDatabase db = session.database();
+    if (!db.transaction()) {
+        step.error = "Could not start a transaction";
+        return step;
+    }
+    int removed = session.tasks().removeBatch(topicId, BatchSize);
+    if (removed < 0) {
+        step.error = session.tasks().lastError();
+    } else if (removed == 0 && !session.topics().purge(topicId)) {
+        step.error = session.topics().lastError();
+    } else {
+        step.ok = db.commit();
+        step.count = removed;
+        if (step.ok) return step;
+        step.error = "Could not commit the deletion";
+    }
+    db.rollback();
+    return step;
+}
+
+TopicDeleter::Step vacuumStep(DatabaseSession &session)
+{
+    TopicDeleter::Step step;
+    QSqlQuery query(session.database());
+    // Files created before incremental vacuum keep their free pages for reuse.
+    if (query.exec("PRAGMA auto_vacuum") && query.next() && query.value(0).toInt() != 2) {
+        step.ok = true;
+        return step;
+    }
+    query.finish();
+    step.ok = query.exec(QString("PRAGMA incremental_vacuum(%1)").arg(VacuumPages));
+    while (query.next()) {}
+    if (step.ok && query.exec("PRAGMA freelist_count") && query.next()) step.count = query.value(0).toLongLong();
+    return step;
+}
+}
+
+TopicDeleter::TopicDeleter(DatabaseWorker *worker, QObject *parent)
+    : QObject(parent), worker(worker)
+{
+}
+
+void TopicDeleter::remove(const QString &topicName)
+{
+    worker->post(QString(), [topicName](DatabaseSession &session) {
+        HiddenTopic topic;
+        topic.name = topicName;
+        int topicId = session.topics().idForName(topicName);
+        if (topicId < 0) {
+            topic.error = "Topic not found: " + topicName;
+        } else if (!session.topics().setDeleted(topicId, true)) {
+            topic.error = session.topics().lastError();
+        } else {
+            topic.topicId = topicId;
+            topic.total = session.tasks().countByTopic(topicId);
+        }
+        return topic;
+    }, this, [this](const HiddenTopic &topic) {
+        emit topicHidden(topic.name, topic.topicId >= 0, topic.error);
+        if (topic.topicId >= 0) enqueue(topic.topicId, topic.name, topic.total);
+    });
+}
+
+void TopicDeleter::resume()
+{
+    worker->post(QString(), [](DatabaseSession &session) {
+        QVector<HiddenTopic> topics;
+        const QVector<TopicRecord> records = session.topics().deletedTopics();
+        for (const TopicRecord &record : records) {
+            HiddenTopic topic;
+            topic.topicId = record.id;
+            topic.name = record.name;
+            topic.total = session.tasks().countByTopic(record.id);
+            topics.append(topic);
+        }
+        return topics;
+    }, this, [this](const QVector<HiddenTopic> &topics) {
+        for (const HiddenTopic &topic : topics) {
+            bool queued = false;
+            for (const Job &job : std::as_const(jobs)) queued = queued || job.topicId == topic.topicId;
+            if (!queued) enqueue(topic.topicId, topic.name, topic.total);
+        }
+    });
+}
+
+void TopicDeleter::cancel()
+{
+    if (!jobs.isEmpty() && jobs.head().phase == DeleteTasks && jobs.head().removed == 0) cancelRequested = true;
+}
+
+void TopicDeleter::enqueue(int topicId, const QString &name, qint64 total)
+{
+    jobs.enqueue({topicId, name, total, 0, DeleteTasks});
+    emit progress(name, 0, total);
+    if (!running) runStep();
+}
+
+void TopicDeleter::runStep()
+{
+    if (jobs.isEmpty()) {
+        running = false;
+        return;
+    }
+    running = true;
+    const Job &job = jobs.head();
+    if (cancelRequested && job.phase == DeleteTasks) {
+        cancelRequested = false;
+        // A batch that was already running when cancel came in wins.
+        if (job.removed == 0) {
+            restoreTopic();
+            return;
+        }
+    }
+    int topicId = job.topicId;
+    if (job.phase == DeleteTasks) {
+        worker->post(QString(), [topicId](DatabaseSession &session) {
+            return deleteBatch(session, topicId);
+        }, this, [this](const Step &step) { stepDone(step); });
+    } else {
+        worker->post(QString(), [](DatabaseSession &session) {
+            return vacuumStep(session);
+        }, this, [this](const Step &step) { stepDone(step); });
+    }
+}
+
+void TopicDeleter::stepDone(const Step &step)
+{
+    Job &job = jobs.head();
+    if (job.phase == Vacuum) {
+        // Vacuum failures leave the space in the free list for later reuse.
+        if (!step.ok || step.count == 0) {
+            QString name = job.name;
+            jobs.dequeue();
+            emit finished(name, false);
+        }
+        runStep();
+        return;
+    }
+    if (!step.ok) {
+        qWarning() << "Deleting topic" << job.name << "failed:" << step.error;
+        if (job.removed == 0) {
+            restoreTopic();
+            return;
+        }
+        // Some tasks are already gone, so the topic stays tombstoned and
+        // resume() finishes it on the next start.
+        QString name = job.name;
+        jobs.dequeue();
+        emit failed(name, step.error);
+        runStep();
+        return;
+    }
+    job.removed += step.count;
+    job.total = qMax(job.total, job.removed);
+    emit progress(job.name, job.removed, job.total);
+    if (step.count == 0) {
+        cancelRequested = false;
+        job.phase = Vacuum;
+    }
+    runStep();
+}
+
+void TopicDeleter::restoreTopic()
+{
+    cancelRequested = false;
+    int topicId = jobs.head().topicId;
+    worker->post(QString(), [topicId](DatabaseSession &session) {
+        Step step;
+        step.ok = session.topics().setDeleted(topicId, false);
+        step.error = session.topics().lastError();
+        return step;
+    }, this, [this](const Step &step) {
+        Job job = jobs.dequeue();
+        if (!step.ok) qWarning() << "Restoring topic" << job.name << "failed:" << step.error;
+        emit finished(job.name, true);
+        runStep();
+    });
+}
@@ -0,0 +1,55 @@
+#ifndef TOPICDELETER_H
+#define TOPICDELETER_H
+
+#include <QObject>
+#include <QQueue>
+#include <QString>
+
+class DatabaseWorker;
+
+// Deletes topics without holding the database for long. The topic is
+// tombstoned first so it disappears at once; its tasks are then removed in
+// bounded batches, each posted as a separate worker job so that requests
+// from the rest of the UI run in between. Freed pages are handed back to the
+// file system with incremental vacuum once the topic row is gone. Removed
+// tasks are not logged or journaled, so a deletion can only be cancelled
+// before its first batch; after that it always runs to the end.
+class TopicDeleter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TopicDeleter(DatabaseWorker *worker, QObject *parent = nullptr);
+    void remove(const QString &topicName);
+    void resume();
+    void cancel();
+    bool isBusy() const { return !jobs.isEmpty(); }
+    struct Step {
+        bool ok = false;
+        qint64 count = 0;
+        QString error;
+    };
+signals:
+    void topicHidden(const QString &topicName, bool ok, const QString &error);
+    void progress(const QString &topicName, qint64 removed, qint64 total);
+    void finished(const QString &topicName, bool cancelled);
+    void failed(const QString &topicName, const QString &error);
+private:
+    enum Phase { DeleteTasks, Vacuum };
+    struct Job {
+        int topicId;
+        QString name;
+        qint64 total;
+        qint64 removed;
+        Phase phase;
+    };
+    void enqueue(int topicId, const QString &name, qint64 total);
+    void runStep();
+    void stepDone(const Step &step);
+    void restoreTopic();
+    DatabaseWorker *worker;
+    QQueue<Job> jobs;
+    bool running = false;
+    bool cancelRequested = false;
+};
+
+#endif // TOPICDELETER_H
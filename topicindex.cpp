@@ -0,0 +1,115 @@
+#include "topicindex.h"
+#include <algorithm>
+
+namespace {
+bool entryLess(const QString &leftKey, const QString &leftName, const QString &rightKey, const QString &rightName)
+{
+    int compared = leftKey.compare(rightKey);
+    return compared != 0 ? compared < 0 : leftName < rightName;
+}
+}
+
+TopicIndex::TopicIndex(QObject *parent)
+    : QObject(parent)
+{
+}
+
+int TopicIndex::lowerBound(const QString &key, const QString &name) const
+{
+    auto it = std::lower_bound(entries.cbegin(), entries.cend(), key, [&name](const Entry &entry, const QString &key) {
+        return entryLess(entry.key, entry.topic.name, key, name);
+    });
+    return int(it - entries.cbegin());
+}
+
+int TopicIndex::find(const QString &name) const
+{
+    int position = lowerBound(keyFor(name), name);
+    return (position < size() && entries[position].topic.name == name) ? position : -1;
+}
+
+// Names sharing a case-folded prefix are adjacent, so the matches are the
+// run starting at the prefix's lower bound.
+std::pair<int, int> TopicIndex::prefixRange(const QString &prefix) const
+{
+    if (prefix.isEmpty()) return {0, size()};
+    QString key = keyFor(prefix);
+    auto first = std::lower_bound(entries.cbegin(), entries.cend(), key, [](const Entry &entry, const QString &key) {
+        return entry.key < key;
+    });
+    auto last = std::partition_point(first, entries.cend(), [&key](const Entry &entry) {
+        return entry.key.startsWith(key);
+    });
+    return {int(first - entries.cbegin()), int(last - entries.cbegin())};
+}
+
+bool TopicIndex::matches(int position, const QString &prefix) const
+{
+    return prefix.isEmpty() || entries[position].key.startsWith(keyFor(prefix));
+}
+
+QStringList TopicIndex::names() const
+{
+    QStringList names;
+    names.reserve(size());
+    for (const Entry &entry : entries) names.append(entry.topic.name);
+    return names;
+}
+
+void TopicIndex::reset(const QVector<TopicSummary> &topics)
+{
+    emit aboutToReset();
+    entries.clear();
+    entries.reserve(topics.size());
+    for (const TopicSummary &topic : topics) entries.push_back({keyFor(topic.name), topic});
+    std::sort(entries.begin(), entries.end(), [](const Entry &left, const Entry &right) {
+        return entryLess(left.key, left.topic.name, right.key, right.topic.name);
+    });
+    emit wasReset();
+}
+
+int TopicIndex::insert(const TopicSummary &topic)
+{
+    QString key = keyFor(topic.name);
+    int position = lowerBound(key, topic.name);
+    if (position < size() && entries[position].topic.name == topic.name) {
+        entries[position].topic.id = topic.id;
+        return position;
+    }
+    entries.insert(entries.begin() + position, {key, topic});
+    emit inserted(position);
+    return position;
+}
+
+bool TopicIndex::rename(const QString &currentName, const QString &newName)
+{
+    int from = find(currentName);
+    if (from < 0 || find(newName) >= 0) return false;
+    Entry entry = std::move(entries[from]);
+    entries.erase(entries.begin() + from);
+    entry.key = keyFor(newName);
+    entry.topic.name = newName;
+    int to = lowerBound(entry.key, newName);
+    entries.insert(entries.begin() + to, std::move(entry));
+    emit moved(from, to);
+    return true;
+}
+
+bool TopicIndex::remove(const QString &name)
+{
+    int position = find(name);
+    if (position < 0) return false;
+    entries.erase(entries.begin() + position);
+    emit removed(position);
+    return true;
+}
+
+void TopicIndex::updateCounters(const QVector<TopicSummary> &topics)
+{
+    if (entries.empty()) return;
+    for (const TopicSummary &topic : topics) {
+        int position = find(topic.name);
+        if (position >= 0) entries[position].topic = topic;
+    }
+    emit changed(0, size() - 1);
+}
@@ -0,0 +1,46 @@
+#ifndef TOPICINDEX_H
+#define TOPICINDEX_H
+
+#include <QObject>
+#include <QStringList>
+#include <utility>
+#include <vector>
+#include "topicrepository.h"
+
+// Every topic sorted by case-folded name, shared by the topic list and the
+// task dialog. Lookups and prefix filtering are binary searches, and edits
+// move single entries instead of rebuilding the array.
+class TopicIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TopicIndex(QObject *parent = nullptr);
+    int size() const { return int(entries.size()); }
+    const TopicSummary &at(int position) const { return entries[position].topic; }
+    int find(const QString &name) const;
+    std::pair<int, int> prefixRange(const QString &prefix) const;
+    bool matches(int position, const QString &prefix) const;
+    QStringList names() const;
+    void reset(const QVector<TopicSummary> &topics);
+    int insert(const TopicSummary &topic);
+    bool rename(const QString &currentName, const QString &newName);
+    bool remove(const QString &name);
+    void updateCounters(const QVector<TopicSummary> &topics);
+signals:
+    void aboutToReset();
+    void wasReset();
+    void inserted(int position);
+    void removed(int position);
+    void moved(int from, int to);
+    void changed(int first, int last);
+private:
+    struct Entry {
+        QString key;
+        TopicSummary topic;
+    };
+    static QString keyFor(const QString &name) { return name.toCaseFolded(); }
+    int lowerBound(const QString &key, const QString &name) const;
+    std::vector<Entry> entries;
+};
+
+#endif // TOPICINDEX_H
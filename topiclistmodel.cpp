@@ -0,0 +1,135 @@
+#include "topiclistmodel.h"
+#include "topicindex.h"
+#include "topicbadgedelegate.h"
+#include <QDateTime>
+#include <QLocale>
+#include <tuple>
+
+TopicListModel::TopicListModel(TopicIndex *index, QObject *parent)
+    : QAbstractListModel(parent), topics(index)
+{
+    last = topics->size();
+    connect(topics, &TopicIndex::aboutToReset, this, &TopicListModel::beginResetModel);
+    connect(topics, &TopicIndex::wasReset, this, [this] {
+        std::tie(first, last) = topics->prefixRange(currentPrefix);
+        endResetModel();
+    });
+    connect(topics, &TopicIndex::inserted, this, &TopicListModel::onInserted);
+    connect(topics, &TopicIndex::removed, this, &TopicListModel::onRemoved);
+    connect(topics, &TopicIndex::moved, this, &TopicListModel::onMoved);
+    connect(topics, &TopicIndex::changed, this, &TopicListModel::onChanged);
+}
+
+void TopicListModel::setPrefix(const QString &prefix)
+{
+    if (prefix == currentPrefix) return;
+    beginResetModel();
+    currentPrefix = prefix;
+    std::tie(first, last) = topics->prefixRange(currentPrefix);
+    endResetModel();
+}
+
+QString TopicListModel::topicName(int row) const
+{
+    if (row < 0 || row >= rowCount()) return QString();
+    return topics->at(first + row).name;
+}
+
+int TopicListModel::rowForName(const QString &name) const
+{
+    int position = topics->find(name);
+    return (position >= first && position < last) ? position - first : -1;
+}
+
+int TopicListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : last - first;
+}
+
+QVariant TopicListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) return QVariant();
+    const TopicSummary &topic = topics->at(first + index.row());
+    int open = topic.total - topic.done;
+    switch (role) {
+    case Qt::DisplayRole:
+        return topic.name;
+    case Qt::ToolTipRole: {
+        QString tip = QString("%1 open, %2 done, %3 overdue").arg(open).arg(topic.done).arg(topic.overdue);
+        if (topic.nextDue > 0) {
+            tip += "\nNext due " + QLocale().toString(QDateTime::fromSecsSinceEpoch(topic.nextDue), QLocale::ShortFormat);
+        }
+        return tip;
+    }
+    case TopicIdRole:
+        return topic.id;
+    case TopicBadgeDelegate::OpenCountRole:
+        return open;
+    case TopicBadgeDelegate::OverdueCountRole:
+        return topic.overdue;
+    default:
+        return QVariant();
+    }
+}
+
+// The index has already changed when these run; first and last still
+// describe the old layout until they are adjusted here.
+void TopicListModel::onInserted(int position)
+{
+    if (!topics->matches(position, currentPrefix)) {
+        if (position <= first) {
+            ++first;
+            ++last;
+        }
+        return;
+    }
+    // An empty range only knows roughly where matches would go.
+    if (first == last) first = last = position;
+    beginInsertRows(QModelIndex(), position - first, position - first);
+    ++last;
+    endInsertRows();
+}
+
+void TopicListModel::onRemoved(int position)
+{
+    if (position < first) {
+        --first;
+        --last;
+    } else if (position < last) {
+        beginRemoveRows(QModelIndex(), position - first, position - first);
+        --last;
+        endRemoveRows();
+    }
+}
+
+void TopicListModel::onMoved(int from, int to)
+{
+    bool wasVisible = from >= first && from < last;
+    if (!wasVisible || !topics->matches(to, currentPrefix)) {
+        // Treat it as a removal followed by an insertion.
+        if (wasVisible) {
+            beginRemoveRows(QModelIndex(), from - first, from - first);
+            --last;
+            endRemoveRows();
+        } else if (from < first) {
+            --first;
+            --last;
+        }
+        onInserted(to);
+        return;
+    }
+    if (from == to) {
+        emit dataChanged(index(to - first), index(to - first));
+        return;
+    }
+    beginMoveRows(QModelIndex(), from - first, from - first, QModelIndex(), to > from ? to - first + 1 : to - first);
+    endMoveRows();
+    emit dataChanged(index(to - first), index(to - first));
+}
+
+void TopicListModel::onChanged(int changedFirst, int changedLast)
+{
+    int from = qMax(changedFirst, first);
+    int to = qMin(changedLast, last - 1);
+    if (from <= to) emit dataChanged(index(from - first), index(to - first));
+}
@@ -0,0 +1,33 @@
+#ifndef TOPICLISTMODEL_H
+#define TOPICLISTMODEL_H
+
+#include <QAbstractListModel>
+
+class TopicIndex;
+
+// Rows of a TopicIndex whose names start with a prefix. The matches are one
+// contiguous run of the index, so the model only keeps its bounds.
+class TopicListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles { TopicIdRole = Qt::UserRole };
+    explicit TopicListModel(TopicIndex *index, QObject *parent = nullptr);
+    void setPrefix(const QString &prefix);
+    QString prefix() const { return currentPrefix; }
+    QString topicName(int row) const;
+    int rowForName(const QString &name) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+private:
+    void onInserted(int position);
+    void onRemoved(int position);
+    void onMoved(int from, int to);
+    void onChanged(int first, int last);
+    TopicIndex *topics;
+    QString currentPrefix;
+    int first = 0;
+    int last = 0;
+};
+
+#endif // TOPICLISTMODEL_H
@@ -0,0 +1,236 @@
+#include "topicrepository.h"
+#include "querytrace.h"
+#include <QSqlError>
+
+TopicRepository::TopicRepository(const QSqlDatabase &db)
+    : db(db), selectAllQuery(db), selectIdQuery(db), insertQuery(db), renameQuery(db), deleteQuery(db), summaryQuery(db), clockQuery(db), crossedQuery(db),
+      overdueQuery(db), nextDueQuery(db), setClockQuery(db), setDeletedQuery(db),
+      deletedQuery(db), deletingQuery(db), purgeQuery(db)
+{
+    selectAllQuery.prepare("SELECT id, name FROM topics WHERE deleted = 0");
+    selectIdQuery.prepare("SELECT id FROM topics WHERE name = :name AND deleted = 0");
+    insertQuery.prepare("INSERT OR IGNORE INTO topics (name) VALUES (:name)");
+    renameQuery.prepare("UPDATE topics SET name = :newName WHERE name = :currentName AND deleted = 0");
+    deleteQuery.prepare("DELETE FROM topics WHERE name = :name AND deleted = 0");
+    summaryQuery.prepare("SELECT tp.id, tp.name, s.total, s.done, s.overdue, s.next_due "
+                         "FROM topics tp JOIN topic_stats s ON s.topic_id = tp.id "
+                         "WHERE tp.deleted = 0 ORDER BY tp.id");
+    clockQuery.prepare("SELECT now FROM stats_clock");
+    crossedQuery.prepare("SELECT 1 FROM topic_stats WHERE next_due <= :now LIMIT 1");
+    overdueQuery.prepare("UPDATE topic_stats SET overdue = overdue + "
+                         "(SELECT COUNT(*) FROM tasks t WHERE t.topic_id = topic_stats.topic_id "
+                         "AND t.done = 0 AND t.due_at > :from AND t.due_at <= :to) "
+                         "WHERE topic_id IN (SELECT topic_id FROM tasks "
+                         "WHERE done = 0 AND due_at > :scan_from AND due_at <= :scan_to)");
+    nextDueQuery.prepare("UPDATE topic_stats SET next_due = "
+                         "(SELECT MIN(due_at) FROM tasks WHERE topic_id = topic_stats.topic_id "
+                         "AND done = 0 AND due_at > :to) "
+                         "WHERE next_due <= :due_to");
+    setClockQuery.prepare("UPDATE stats_clock SET now = :to");
+    setDeletedQuery.prepare("UPDATE topics SET deleted = :deleted WHERE id = :topic_id");
+    deletedQuery.prepare("SELECT id, name FROM topics WHERE deleted = 1");
+    deletingQuery.prepare("SELECT 1 FROM topics WHERE name = :name AND deleted = 1");
+    purgeQuery.prepare("DELETE FROM topics WHERE id = :topic_id AND deleted = 1");
+}
+
+bool TopicRepository::exec(QSqlQuery &query)
+{
+    if (query.exec()) {
+        error.clear();
+        return true;
+    }
+    error = query.lastError().text();
+    return false;
+}
+
+QVector<TopicRecord> TopicRepository::all()
+{
+    QVector<TopicRecord> topics;
+    QuerySpan span(selectAllQuery);
+    if (!exec(selectAllQuery)) return topics;
+    ids.clear();
+    while (selectAllQuery.next()) {
+        TopicRecord topic;
+        topic.id = selectAllQuery.value(0).toInt();
+        topic.name = selectAllQuery.value(1).toString();
+        ids.insert(topic.name, topic.id);
+        topics.append(topic);
+    }
+    span.setRows(topics.size());
+    selectAllQuery.finish();
+    return topics;
+}
+
+int TopicRepository::idForName(const QString &name)
+{
+    auto it = ids.constFind(name);
+    if (it != ids.constEnd()) return it.value();
+    QuerySpan span(selectIdQuery);
+    selectIdQuery.bindValue(":name", name);
+    int id = -1;
+    if (exec(selectIdQuery) && selectIdQuery.next()) {
+        id = selectIdQuery.value(0).toInt();
+        ids.insert(name, id);
+        span.setRows(1);
+    }
+    selectIdQuery.finish();
+    return id;
+}
+
+int TopicRepository::insert(const QString &name)
+{
+    {
+        QuerySpan span(insertQuery);
+        insertQuery.bindValue(":name", name);
+        if (!exec(insertQuery)) return -1;
+    }
+    int id = idForName(name);
+    if (id < 0 && error.isEmpty() && beingDeleted(name)) return -1;
+    return id;
+}
+
+bool TopicRepository::rename(const QString &currentName, const QString &newName)
+{
+    if (beingDeleted(newName)) return false;
+    QuerySpan span(renameQuery);
+    renameQuery.bindValue(":newName", newName);
+    renameQuery.bindValue(":currentName", currentName);
+    if (!exec(renameQuery)) return false;
+    auto it = ids.find(currentName);
+    if (it != ids.end()) {
+        int id = it.value();
+        ids.erase(it);
+        ids.insert(newName, id);
+    }
+    return true;
+}
+
+// A tombstoned topic keeps its name until its tasks are gone, so the name
+// cannot be reused in the meantime; says so instead of failing silently.
+bool TopicRepository::beingDeleted(const QString &name)
+{
+    QuerySpan span(deletingQuery);
+    deletingQuery.bindValue(":name", name);
+    bool found = exec(deletingQuery) && deletingQuery.next();
+    deletingQuery.finish();
+    span.setRows(found ? 1 : 0);
+    if (found) error = QString("Topic \"%1\" is still being deleted; try again once it is gone.").arg(name);
+    return found;
+}
+
+bool TopicRepository::remove(const QString &name)
+{
+    QuerySpan span(deleteQuery);
+    deleteQuery.bindValue(":name", name);
+    if (!exec(deleteQuery)) return false;
+    ids.remove(name);
+    return true;
+}
+
+// Counts the tasks that fell due since the last call as overdue. Only the
+// tasks due in between are read, through the due date index. The counters
+// stay consistent with an old watermark, so while no topic's next due time
+// has passed the database is left untouched.
+bool TopicRepository::advanceClock(qint64 now)
+{
+    qint64 clock = now;
+    {
+        QuerySpan span(clockQuery);
+        if (exec(clockQuery) && clockQuery.next()) clock = clockQuery.value(0).toLongLong();
+        clockQuery.finish();
+    }
+    if (now <= clock) return error.isEmpty();
+    {
+        QuerySpan span(crossedQuery);
+        crossedQuery.bindValue(":now", now);
+        bool crossed = exec(crossedQuery) && crossedQuery.next();
+        crossedQuery.finish();
+        span.setRows(crossed ? 1 : 0);
+        if (!crossed) return error.isEmpty();
+    }
+    bool ownTransaction = db.transaction();
+    bool ok;
+    {
+        QuerySpan span(overdueQuery);
+        overdueQuery.bindValue(":from", clock);
+        overdueQuery.bindValue(":to", now);
+        overdueQuery.bindValue(":scan_from", clock);
+        overdueQuery.bindValue(":scan_to", now);
+        ok = exec(overdueQuery);
+    }
+    if (ok) {
+        QuerySpan span(nextDueQuery);
+        nextDueQuery.bindValue(":to", now);
+        nextDueQuery.bindValue(":due_to", now);
+        ok = exec(nextDueQuery);
+    }
+    if (ok) {
+        QuerySpan span(setClockQuery);
+        setClockQuery.bindValue(":to", now);
+        ok = exec(setClockQuery);
+    }
+    if (!ownTransaction) return ok;
+    if (ok && db.commit()) return true;
+    db.rollback();
+    return false;
+}
+
+QVector<TopicSummary> TopicRepository::summaries()
+{
+    QVector<TopicSummary> summaries;
+    QuerySpan span(summaryQuery);
+    if (!exec(summaryQuery)) return summaries;
+    while (summaryQuery.next()) {
+        TopicSummary summary;
+        summary.id = summaryQuery.value(0).toInt();
+        summary.name = summaryQuery.value(1).toString();
+        summary.total = summaryQuery.value(2).toInt();
+        summary.done = summaryQuery.value(3).toInt();
+        summary.overdue = summaryQuery.value(4).toInt();
+        summary.nextDue = summaryQuery.value(5).toLongLong();
+        summaries.append(summary);
+    }
+    span.setRows(summaries.size());
+    summaryQuery.finish();
+    return summaries;
+}
+
+bool TopicRepository::setDeleted(int topicId, bool deleted)
+{
+    QuerySpan span(setDeletedQuery);
+    setDeletedQuery.bindValue(":deleted", deleted ? 1 : 0);
+    setDeletedQuery.bindValue(":topic_id", topicId);
+    if (!exec(setDeletedQuery)) return false;
+    for (auto it = ids.begin(); it != ids.end();) {
+        it = it.value() == topicId ? ids.erase(it) : ++it;
+    }
+    return true;
+}
+
+QVector<TopicRecord> TopicRepository::deletedTopics()
+{
+    QVector<TopicRecord> topics;
+    QuerySpan span(deletedQuery);
+    if (!exec(deletedQuery)) return topics;
+    while (deletedQuery.next()) {
+        TopicRecord topic;
+        topic.id = deletedQuery.value(0).toInt();
+        topic.name = deletedQuery.value(1).toString();
+        topics.append(topic);
+    }
+    span.setRows(topics.size());
+    deletedQuery.finish();
+    return topics;
+}
+
+bool TopicRepository::purge(int topicId)
+{
+    QuerySpan span(purgeQuery);
+    purgeQuery.bindValue(":topic_id", topicId);
+    return exec(purgeQuery);
+}
+
+void TopicRepository::clearCache()
+{
+    ids.clear();
+}
@@ -0,0 +1,64 @@
+#ifndef TOPICREPOSITORY_H
+#define TOPICREPOSITORY_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QHash>
+#include <QVector>
+
+struct TopicRecord
+{
+    int id = -1;
+    QString name;
+};
+
+struct TopicSummary
+{
+    int id = -1;
+    QString name;
+    int total = 0;
+    int done = 0;
+    int overdue = 0;
+    qint64 nextDue = 0;
+};
+
+class TopicRepository
+{
+public:
+    explicit TopicRepository(const QSqlDatabase &db);
+    QVector<TopicRecord> all();
+    int idForName(const QString &name);
+    int insert(const QString &name);
+    bool rename(const QString &currentName, const QString &newName);
+    bool remove(const QString &name);
+    bool advanceClock(qint64 now);
+    QVector<TopicSummary> summaries();
+    bool setDeleted(int topicId, bool deleted);
+    QVector<TopicRecord> deletedTopics();
+    bool purge(int topicId);
+    void clearCache();
+    QString lastError() const { return error; }
+private:
+    QSqlDatabase db;
+    QSqlQuery selectAllQuery;
+    QSqlQuery selectIdQuery;
+    QSqlQuery insertQuery;
+    QSqlQuery renameQuery;
+    QSqlQuery deleteQuery;
+    QSqlQuery summaryQuery;
+    QSqlQuery clockQuery;
+    QSqlQuery crossedQuery;
+    QSqlQuery overdueQuery;
+    QSqlQuery nextDueQuery;
+    QSqlQuery setClockQuery;
+    QSqlQuery setDeletedQuery;
+    QSqlQuery deletedQuery;
+    QSqlQuery deletingQuery;
+    QSqlQuery purgeQuery;
+    QHash<QString, int> ids;
+    QString error;
+    bool exec(QSqlQuery &query);
+    bool beingDeleted(const QString &name);
+};
+
+#endif // TOPICREPOSITORY_H